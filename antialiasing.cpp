@@ -0,0 +1,212 @@
+/****************************************************************************
+**
+** Copyright (C) 2016 The Qt Company Ltd.
+** Contact: https://www.qt.io/licensing/
+**
+** This file is part of the examples of the Qt Toolkit.
+**
+** $QT_BEGIN_LICENSE:BSD$
+** Commercial License Usage
+** Licensees holding valid commercial Qt licenses may use this file in
+** accordance with the commercial license agreement provided with the
+** Software or, alternatively, in accordance with the terms contained in
+** a written agreement between you and The Qt Company. For licensing terms
+** and conditions see https://www.qt.io/terms-conditions. For further
+** information use the contact form at https://www.qt.io/contact-us.
+**
+** BSD License Usage
+** Alternatively, you may use this file under the terms of the BSD license
+** as follows:
+**
+** "Redistribution and use in source and binary forms, with or without
+** modification, are permitted provided that the following conditions are
+** met:
+**   * Redistributions of source code must retain the above copyright
+**     notice, this list of conditions and the following disclaimer.
+**   * Redistributions in binary form must reproduce the above copyright
+**     notice, this list of conditions and the following disclaimer in
+**     the documentation and/or other materials provided with the
+**     distribution.
+**   * Neither the name of The Qt Company Ltd nor the names of its
+**     contributors may be used to endorse or promote products derived
+**     from this software without specific prior written permission.
+**
+**
+** THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+** "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+** LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+** A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+** OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+** SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+** LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+** DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+** THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+** (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+** OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE."
+**
+** $QT_END_LICENSE$
+**
+****************************************************************************/
+
+#include "antialiasing.h"
+
+#include <QOpenGLShaderProgram>
+#include <QVector2D>
+#include <QDebug>
+
+#define PROGRAM_VERTEX_ATTRIBUTE 0
+
+static const char *vertexShaderFxaaSource =
+        "attribute highp vec2 vertex;\n"
+        "varying highp vec2 texCoord;\n"
+        "void main(void)\n"
+        "{\n"
+        "    texCoord = vertex * 0.5 + 0.5;\n"
+        "    gl_Position = vec4(vertex, 0.0, 1.0);\n"
+        "}\n";
+
+// The console variant of FXAA: blends along the local edge direction,
+// estimated from the luma of the four diagonal neighbours.
+static const char *fragmentShaderFxaaSource =
+        "uniform sampler2D source;\n"
+        "uniform highp vec2 texelSize;\n"
+        "varying highp vec2 texCoord;\n"
+        "const highp float reduceMin = 1.0 / 128.0;\n"
+        "const highp float reduceMul = 1.0 / 8.0;\n"
+        "const highp float spanMax = 8.0;\n"
+        "highp float luma(highp vec3 color) { return dot(color, vec3(0.299, 0.587, 0.114)); }\n"
+        "void main(void)\n"
+        "{\n"
+        "    highp vec4 center = texture2D(source, texCoord);\n"
+        "    highp float lumaNW = luma(texture2D(source, texCoord + vec2(-1.0, -1.0) * texelSize).rgb);\n"
+        "    highp float lumaNE = luma(texture2D(source, texCoord + vec2(1.0, -1.0) * texelSize).rgb);\n"
+        "    highp float lumaSW = luma(texture2D(source, texCoord + vec2(-1.0, 1.0) * texelSize).rgb);\n"
+        "    highp float lumaSE = luma(texture2D(source, texCoord + vec2(1.0, 1.0) * texelSize).rgb);\n"
+        "    highp float lumaM = luma(center.rgb);\n"
+        "    highp float lumaMin = min(lumaM, min(min(lumaNW, lumaNE), min(lumaSW, lumaSE)));\n"
+        "    highp float lumaMax = max(lumaM, max(max(lumaNW, lumaNE), max(lumaSW, lumaSE)));\n"
+        "    highp vec2 dir = vec2(-((lumaNW + lumaNE) - (lumaSW + lumaSE)), (lumaNW + lumaSW) - (lumaNE + lumaSE));\n"
+        "    highp float dirReduce = max((lumaNW + lumaNE + lumaSW + lumaSE) * 0.25 * reduceMul, reduceMin);\n"
+        "    highp float rcpDirMin = 1.0 / (min(abs(dir.x), abs(dir.y)) + dirReduce);\n"
+        "    dir = clamp(dir * rcpDirMin, vec2(-spanMax), vec2(spanMax)) * texelSize;\n"
+        "    highp vec3 rgbA = 0.5 * (texture2D(source, texCoord + dir * (1.0 / 3.0 - 0.5)).rgb\n"
+        "                             + texture2D(source, texCoord + dir * (2.0 / 3.0 - 0.5)).rgb);\n"
+        "    highp vec3 rgbB = rgbA * 0.5 + 0.25 * (texture2D(source, texCoord - dir * 0.5).rgb\n"
+        "                                           + texture2D(source, texCoord + dir * 0.5).rgb);\n"
+        "    highp float lumaB = luma(rgbB);\n"
+        "    gl_FragColor = vec4(lumaB < lumaMin || lumaB > lumaMax ? rgbA : rgbB, center.a);\n"
+        "}\n";
+
+int antialiasingSamples(AntialiasingMode mode)
+{
+    switch (mode) {
+    case AntialiasingMode::Msaa2:
+        return 2;
+    case AntialiasingMode::Msaa4:
+        return 4;
+    case AntialiasingMode::Msaa8:
+        return 8;
+    default:
+        return 0;
+    }
+}
+
+QString antialiasingModeName(AntialiasingMode mode)
+{
+    switch (mode) {
+    case AntialiasingMode::Msaa2:
+        return QStringLiteral("msaa2");
+    case AntialiasingMode::Msaa4:
+        return QStringLiteral("msaa4");
+    case AntialiasingMode::Msaa8:
+        return QStringLiteral("msaa8");
+    case AntialiasingMode::Fxaa:
+        return QStringLiteral("fxaa");
+    default:
+        return QStringLiteral("none");
+    }
+}
+
+bool parseAntialiasingMode(const QString &name, AntialiasingMode *mode)
+{
+    for (AntialiasingMode candidate : { AntialiasingMode::None, AntialiasingMode::Msaa2, AntialiasingMode::Msaa4,
+                                        AntialiasingMode::Msaa8, AntialiasingMode::Fxaa }) {
+        if (name.compare(antialiasingModeName(candidate), Qt::CaseInsensitive) == 0) {
+            *mode = candidate;
+            return true;
+        }
+    }
+    return false;
+}
+
+FxaaPass::FxaaPass()
+    : m_vertexBuffer(QOpenGLBuffer::VertexBuffer)
+{
+}
+
+FxaaPass::~FxaaPass()
+{
+    // Released through destroy() while the context is current.
+}
+
+void FxaaPass::create()
+{
+    initializeOpenGLFunctions();
+
+    m_program = new QOpenGLShaderProgram;
+    m_program->addCacheableShaderFromSourceCode(QOpenGLShader::Vertex, vertexShaderFxaaSource);
+    m_program->addCacheableShaderFromSourceCode(QOpenGLShader::Fragment, fragmentShaderFxaaSource);
+    m_program->bindAttributeLocation("vertex", PROGRAM_VERTEX_ATTRIBUTE);
+    if (!m_program->link())
+        qWarning() << "FxaaPass: could not link the program" << m_program->log();
+    m_program->bind();
+    m_program->setUniformValue("source", 0);
+    m_texelSizeLoc = m_program->uniformLocation("texelSize");
+    m_program->release();
+
+    // One quad covering the viewport, drawn as a triangle strip.
+    static const GLfloat quad[] = { -1.0f, -1.0f, 1.0f, -1.0f, -1.0f, 1.0f, 1.0f, 1.0f };
+    m_vertexBuffer.create();
+    m_vertexBuffer.bind();
+    m_vertexBuffer.allocate(quad, sizeof(quad));
+    m_vertexBuffer.release();
+}
+
+void FxaaPass::destroy()
+{
+    delete m_program;
+    m_program = nullptr;
+    m_vertexBuffer.destroy();
+}
+
+void FxaaPass::draw(GLuint texture, const QSize &size)
+{
+    const bool depthTest = glIsEnabled(GL_DEPTH_TEST);
+    const bool cullFace = glIsEnabled(GL_CULL_FACE);
+    glDisable(GL_DEPTH_TEST);
+    glDisable(GL_CULL_FACE);
+    glDisable(GL_BLEND);
+
+    glActiveTexture(GL_TEXTURE0);
+    glBindTexture(GL_TEXTURE_2D, texture);
+    // Framebuffer textures come with nearest filtering, the edge
+    // search samples between texels.
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+
+    m_program->bind();
+    m_program->setUniformValue(m_texelSizeLoc, QVector2D(1.0f / size.width(), 1.0f / size.height()));
+    m_vertexBuffer.bind();
+    glEnableVertexAttribArray(PROGRAM_VERTEX_ATTRIBUTE);
+    glVertexAttribPointer(PROGRAM_VERTEX_ATTRIBUTE, 2, GL_FLOAT, GL_FALSE, 0, nullptr);
+    glDrawArrays(GL_TRIANGLE_STRIP, 0, 4);
+    glDisableVertexAttribArray(PROGRAM_VERTEX_ATTRIBUTE);
+    m_vertexBuffer.release();
+    m_program->release();
+    glBindTexture(GL_TEXTURE_2D, 0);
+
+    if (depthTest)
+        glEnable(GL_DEPTH_TEST);
+    if (cullFace)
+        glEnable(GL_CULL_FACE);
+}
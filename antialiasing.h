@@ -0,0 +1,99 @@
+/****************************************************************************
+**
+** Copyright (C) 2016 The Qt Company Ltd.
+** Contact: https://www.qt.io/licensing/
+**
+** This file is part of the examples of the Qt Toolkit.
+**
+** $QT_BEGIN_LICENSE:BSD$
+** Commercial License Usage
+** Licensees holding valid commercial Qt licenses may use this file in
+** accordance with the commercial license agreement provided with the
+** Software or, alternatively, in accordance with the terms contained in
+** a written agreement between you and The Qt Company. For licensing terms
+** and conditions see https://www.qt.io/terms-conditions. For further
+** information use the contact form at https://www.qt.io/contact-us.
+**
+** BSD License Usage
+** Alternatively, you may use this file under the terms of the BSD license
+** as follows:
+**
+** "Redistribution and use in source and binary forms, with or without
+** modification, are permitted provided that the following conditions are
+** met:
+**   * Redistributions of source code must retain the above copyright
+**     notice, this list of conditions and the following disclaimer.
+**   * Redistributions in binary form must reproduce the above copyright
+**     notice, this list of conditions and the following disclaimer in
+**     the documentation and/or other materials provided with the
+**     distribution.
+**   * Neither the name of The Qt Company Ltd nor the names of its
+**     contributors may be used to endorse or promote products derived
+**     from this software without specific prior written permission.
+**
+**
+** THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+** "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+** LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+** A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+** OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+** SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+** LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+** DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+** THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+** (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+** OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE."
+**
+** $QT_END_LICENSE$
+**
+****************************************************************************/
+
+#ifndef ANTIALIASING_H
+#define ANTIALIASING_H
+
+#include <QOpenGLFunctions>
+#include <QOpenGLBuffer>
+#include <QSize>
+#include <QString>
+
+QT_FORWARD_DECLARE_CLASS(QOpenGLShaderProgram)
+
+// How color images are antialiased. MSAA renders into a multisampled
+// framebuffer object that is only resolved when the image is read back
+// or presented, FXAA filters edges of a single sampled image afterwards.
+enum class AntialiasingMode {
+    None,
+    Msaa2,
+    Msaa4,
+    Msaa8,
+    Fxaa
+};
+
+// Sample count of the framebuffer a mode renders into.
+int antialiasingSamples(AntialiasingMode mode);
+// Names as used on the command line: none, msaa2, msaa4, msaa8, fxaa.
+QString antialiasingModeName(AntialiasingMode mode);
+bool parseAntialiasingMode(const QString &name, AntialiasingMode *mode);
+
+// Lottes' FXAA as a full screen pass, from a texture into the currently
+// bound framebuffer. About the cost of one extra background pass.
+class FxaaPass : protected QOpenGLFunctions
+{
+public:
+    FxaaPass();
+    ~FxaaPass();
+
+    // Everything below needs the context of the pass to be current.
+    void create();
+    void destroy();
+    bool isCreated() const { return m_program != nullptr; }
+    // texture holds an image of size, the viewport has to match it.
+    void draw(GLuint texture, const QSize &size);
+
+private:
+    QOpenGLShaderProgram *m_program = nullptr;
+    int m_texelSizeLoc = -1;
+    QOpenGLBuffer m_vertexBuffer;
+};
+
+#endif // ANTIALIASING_H
@@ -0,0 +1,248 @@
+/****************************************************************************
+**
+** Copyright (C) 2016 The Qt Company Ltd.
+** Contact: https://www.qt.io/licensing/
+**
+** This file is part of the examples of the Qt Toolkit.
+**
+** $QT_BEGIN_LICENSE:BSD$
+** Commercial License Usage
+** Licensees holding valid commercial Qt licenses may use this file in
+** accordance with the commercial license agreement provided with the
+** Software or, alternatively, in accordance with the terms contained in
+** a written agreement between you and The Qt Company. For licensing terms
+** and conditions see https://www.qt.io/terms-conditions. For further
+** information use the contact form at https://www.qt.io/contact-us.
+**
+** BSD License Usage
+** Alternatively, you may use this file under the terms of the BSD license
+** as follows:
+**
+** "Redistribution and use in source and binary forms, with or without
+** modification, are permitted provided that the following conditions are
+** met:
+**   * Redistributions of source code must retain the above copyright
+**     notice, this list of conditions and the following disclaimer.
+**   * Redistributions in binary form must reproduce the above copyright
+**     notice, this list of conditions and the following disclaimer in
+**     the documentation and/or other materials provided with the
+**     distribution.
+**   * Neither the name of The Qt Company Ltd nor the names of its
+**     contributors may be used to endorse or promote products derived
+**     from this software without specific prior written permission.
+**
+**
+** THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+** "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+** LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+** A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+** OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+** SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+** LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+** DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+** THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+** (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+** OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE."
+**
+** $QT_END_LICENSE$
+**
+****************************************************************************/
+
+#include "backgroundbandreader.h"
+#include "profiler.h"
+
+#include <QImageReader>
+#include <QDebug>
+#include <limits>
+
+// Reads the next number of a PNM header, skipping whitespace and comments,
+// together with the single whitespace character that ends it.
+static bool readHeaderNumber(QFile *file, int *value)
+{
+    char c;
+    do {
+        if (!file->getChar(&c))
+            return false;
+        while (c == '#') {
+            if (!file->readLine().endsWith('\n') || !file->getChar(&c))
+                return false;
+        }
+    } while (c == ' ' || c == '\t' || c == '\r' || c == '\n');
+
+    qint64 number = 0;
+    if (c < '0' || c > '9')
+        return false;
+    while (c >= '0' && c <= '9') {
+        number = number * 10 + (c - '0');
+        if (number > std::numeric_limits<int>::max() || !file->getChar(&c))
+            return false;
+    }
+    *value = int(number);
+    return c == ' ' || c == '\t' || c == '\r' || c == '\n';
+}
+
+// Position of the center of output pixel i in the source, as the source
+// pixel before it and the weight of the one after it in 1/256.
+static void sourcePosition(int i, int outputLength, int sourceLength, int *index, int *weight)
+{
+    const double position = qBound(0.0, (i + 0.5) * sourceLength / outputLength - 0.5,
+                                   double(sourceLength - 1));
+    *index = int(position);
+    *weight = qRound((position - *index) * 256);
+}
+
+bool BackgroundBandReader::open(const QString &fileName, const QSize &outputSize)
+{
+    close();
+    m_file.setFileName(fileName);
+    if (!m_file.open(QIODevice::ReadOnly)) {
+        qWarning() << "BackgroundBandReader: could not open" << fileName;
+        return false;
+    }
+    if (readStreamHeader()) {
+        start(outputSize);
+        return true;
+    }
+    m_file.close();
+
+    qWarning() << "BackgroundBandReader:" << fileName
+               << "is no 8 bit binary PPM or PGM, holding all of it decoded";
+    QImage image;
+    {
+        ProfileScope profile("image decode");
+        QImageReader reader(fileName);
+        image = reader.read();
+        if (image.isNull()) {
+            qWarning() << "BackgroundBandReader: could not read" << fileName << reader.errorString();
+            return false;
+        }
+    }
+    return open(image, outputSize);
+}
+
+bool BackgroundBandReader::open(const QImage &image, const QSize &outputSize)
+{
+    close();
+    m_image = image.convertToFormat(QImage::Format_RGB888);
+    if (m_image.isNull())
+        return false;
+    m_sourceSize = m_image.size();
+    start(outputSize);
+    return true;
+}
+
+bool BackgroundBandReader::readStreamHeader()
+{
+    char magic[2];
+    int width, height, maxValue;
+    if (m_file.read(magic, 2) != 2 || magic[0] != 'P' || (magic[1] != '5' && magic[1] != '6')
+            || !readHeaderNumber(&m_file, &width) || !readHeaderNumber(&m_file, &height)
+            || !readHeaderNumber(&m_file, &maxValue) || width <= 0 || height <= 0 || maxValue != 255) {
+        return false;
+    }
+    m_channels = magic[1] == '6' ? 3 : 1;
+    m_sourceSize = QSize(width, height);
+    m_fileRow.resize(width * m_channels);
+    m_rows[0].resize(width * 3);
+    m_rows[1].resize(width * 3);
+    m_streamedRows = 0;
+    return true;
+}
+
+void BackgroundBandReader::start(const QSize &outputSize)
+{
+    m_outputSize = outputSize;
+    m_nextRow = 0;
+    m_columns.resize(outputSize.width());
+    for (int x = 0; x < outputSize.width(); ++x) {
+        Column &column = m_columns[x];
+        sourcePosition(x, outputSize.width(), m_sourceSize.width(), &column.left, &column.weight);
+        column.right = qMin(column.left + 1, m_sourceSize.width() - 1) * 3;
+        column.left *= 3;
+    }
+}
+
+bool BackgroundBandReader::readStreamedRow(QByteArray *rgb)
+{
+    if (m_channels == 3)
+        return m_file.read(rgb->data(), rgb->size()) == rgb->size();
+
+    if (m_file.read(m_fileRow.data(), m_fileRow.size()) != m_fileRow.size())
+        return false;
+    uchar *out = reinterpret_cast<uchar *>(rgb->data());
+    const uchar *gray = reinterpret_cast<const uchar *>(m_fileRow.constData());
+    for (int x = 0; x < m_fileRow.size(); ++x) {
+        out[3 * x] = gray[x];
+        out[3 * x + 1] = gray[x];
+        out[3 * x + 2] = gray[x];
+    }
+    return true;
+}
+
+const uchar *BackgroundBandReader::sourceRow(int row)
+{
+    if (!m_image.isNull())
+        return m_image.constScanLine(row);
+
+    // Rows are asked for top-down, two at a time, so everything before
+    // the row above can be skipped without decoding.
+    const qint64 fileRowBytes = m_fileRow.size();
+    if (row - 1 > m_streamedRows) {
+        const qint64 skipped = qint64(row - 1 - m_streamedRows) * fileRowBytes;
+        if (m_file.skip(skipped) != skipped)
+            return nullptr;
+        m_streamedRows = row - 1;
+    }
+    while (m_streamedRows <= row) {
+        if (!readStreamedRow(&m_rows[m_streamedRows & 1]))
+            return nullptr;
+        ++m_streamedRows;
+    }
+    return reinterpret_cast<const uchar *>(m_rows[row & 1].constData());
+}
+
+QImage BackgroundBandReader::readBand(int height)
+{
+    if (m_sourceSize.isEmpty() || height <= 0 || m_nextRow + height > m_outputSize.height())
+        return QImage();
+
+    ProfileScope profile("image decode");
+    QImage band(m_outputSize.width(), height, QImage::Format_RGB888);
+    for (int y = 0; y < height; ++y) {
+        int top, weight;
+        sourcePosition(m_nextRow + y, m_outputSize.height(), m_sourceSize.height(), &top, &weight);
+        const uchar *upper = sourceRow(top);
+        const uchar *lower = upper ? sourceRow(qMin(top + 1, m_sourceSize.height() - 1)) : nullptr;
+        if (!lower) {
+            qWarning() << "BackgroundBandReader:" << m_file.fileName() << "ends before row" << top + 1;
+            return QImage();
+        }
+
+        uchar *out = band.scanLine(y);
+        for (const Column &column : m_columns) {
+            for (int c = 0; c < 3; ++c) {
+                const int above = upper[column.left + c] * (256 - column.weight)
+                        + upper[column.right + c] * column.weight;
+                const int below = lower[column.left + c] * (256 - column.weight)
+                        + lower[column.right + c] * column.weight;
+                *out++ = uchar((above * (256 - weight) + below * weight + 32768) >> 16);
+            }
+        }
+    }
+    m_nextRow += height;
+    return band;
+}
+
+void BackgroundBandReader::close()
+{
+    m_file.close();
+    m_image = QImage();
+    m_sourceSize = QSize();
+    m_outputSize = QSize();
+    m_nextRow = 0;
+    m_columns.clear();
+    m_fileRow = QByteArray();
+    m_rows[0] = QByteArray();
+    m_rows[1] = QByteArray();
+    m_streamedRows = 0;
+}
@@ -0,0 +1,104 @@
+/****************************************************************************
+**
+** Copyright (C) 2016 The Qt Company Ltd.
+** Contact: https://www.qt.io/licensing/
+**
+** This file is part of the examples of the Qt Toolkit.
+**
+** $QT_BEGIN_LICENSE:BSD$
+** Commercial License Usage
+** Licensees holding valid commercial Qt licenses may use this file in
+** accordance with the commercial license agreement provided with the
+** Software or, alternatively, in accordance with the terms contained in
+** a written agreement between you and The Qt Company. For licensing terms
+** and conditions see https://www.qt.io/terms-conditions. For further
+** information use the contact form at https://www.qt.io/contact-us.
+**
+** BSD License Usage
+** Alternatively, you may use this file under the terms of the BSD license
+** as follows:
+**
+** "Redistribution and use in source and binary forms, with or without
+** modification, are permitted provided that the following conditions are
+** met:
+**   * Redistributions of source code must retain the above copyright
+**     notice, this list of conditions and the following disclaimer.
+**   * Redistributions in binary form must reproduce the above copyright
+**     notice, this list of conditions and the following disclaimer in
+**     the documentation and/or other materials provided with the
+**     distribution.
+**   * Neither the name of The Qt Company Ltd nor the names of its
+**     contributors may be used to endorse or promote products derived
+**     from this software without specific prior written permission.
+**
+**
+** THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+** "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+** LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+** A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+** OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+** SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+** LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+** DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+** THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+** (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+** OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE."
+**
+** $QT_END_LICENSE$
+**
+****************************************************************************/
+
+#ifndef BACKGROUNDBANDREADER_H
+#define BACKGROUNDBANDREADER_H
+
+#include <QByteArray>
+#include <QFile>
+#include <QImage>
+#include <QSize>
+#include <QVector>
+
+// Delivers a background image scaled to the size of a tiled render, one
+// band of rows at a time and top-down as OffscreenRenderer::renderTiled()
+// asks for them. Binary PPM and PGM files are streamed row by row, so only
+// two source rows are held whatever the size of the image. Other formats
+// cannot be decoded in parts and are held in full. Every output row is
+// interpolated from its exact source position, so bands meet seamlessly.
+class BackgroundBandReader
+{
+public:
+    bool open(const QString &fileName, const QSize &outputSize);
+    bool open(const QImage &image, const QSize &outputSize);
+    // The next height rows of outputSize.width() as RGB888, null on read
+    // errors and past the last row.
+    QImage readBand(int height);
+    void close();
+
+private:
+    bool readStreamHeader();
+    void start(const QSize &outputSize);
+    const uchar *sourceRow(int row);
+    bool readStreamedRow(QByteArray *rgb);
+
+    struct Column {
+        int left;
+        int right;
+        // Of the right source pixel, in 1/256.
+        int weight;
+    };
+
+    QFile m_file;
+    // Set instead of m_file for formats that are not streamed.
+    QImage m_image;
+    QSize m_sourceSize;
+    QSize m_outputSize;
+    int m_nextRow = 0;
+    QVector<Column> m_columns;
+    // Streaming state: bytes per pixel in the file, the raw file row and
+    // the last two RGB rows read, row n in m_rows[n & 1].
+    int m_channels = 3;
+    QByteArray m_fileRow;
+    QByteArray m_rows[2];
+    int m_streamedRows = 0;
+};
+
+#endif // BACKGROUNDBANDREADER_H
@@ -0,0 +1,191 @@
+/****************************************************************************
+**
+** Copyright (C) 2016 The Qt Company Ltd.
+** Contact: https://www.qt.io/licensing/
+**
+** This file is part of the examples of the Qt Toolkit.
+**
+** $QT_BEGIN_LICENSE:BSD$
+** Commercial License Usage
+** Licensees holding valid commercial Qt licenses may use this file in
+** accordance with the commercial license agreement provided with the
+** Software or, alternatively, in accordance with the terms contained in
+** a written agreement between you and The Qt Company. For licensing terms
+** and conditions see https://www.qt.io/terms-conditions. For further
+** information use the contact form at https://www.qt.io/contact-us.
+**
+** BSD License Usage
+** Alternatively, you may use this file under the terms of the BSD license
+** as follows:
+**
+** "Redistribution and use in source and binary forms, with or without
+** modification, are permitted provided that the following conditions are
+** met:
+**   * Redistributions of source code must retain the above copyright
+**     notice, this list of conditions and the following disclaimer.
+**   * Redistributions in binary form must reproduce the above copyright
+**     notice, this list of conditions and the following disclaimer in
+**     the documentation and/or other materials provided with the
+**     distribution.
+**   * Neither the name of The Qt Company Ltd nor the names of its
+**     contributors may be used to endorse or promote products derived
+**     from this software without specific prior written permission.
+**
+**
+** THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+** "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+** LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+** A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+** OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+** SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+** LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+** DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+** THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+** (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+** OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE."
+**
+** $QT_END_LICENSE$
+**
+****************************************************************************/
+
+#include "backgroundimagesource.h"
+#include "scenerenderer.h"
+#include "profiler.h"
+
+#include <QDir>
+#include <QHash>
+#include <QImageReader>
+#include <QMutex>
+#include <QRunnable>
+#include <QThreadPool>
+#include <QWaitCondition>
+
+struct BackgroundImageSourceState
+{
+    QMutex mutex;
+    QWaitCondition frameDecoded;
+    QStringList files;
+    int prefetchCount = 0;
+    int nextToTake = 0;
+    int nextToSchedule = 0;
+    bool cancelled = false;
+    QHash<int, QImage> decoded;
+};
+
+namespace {
+
+// Shares the state with the source, so a source that gets destroyed while
+// decodes are still running does not have to wait for them.
+class DecodeTask : public QRunnable
+{
+public:
+    DecodeTask(const QSharedPointer<BackgroundImageSourceState> &state, int index)
+        : m_state(state),
+          m_index(index),
+          m_file(state->files.at(index))
+    {
+    }
+
+    void run() override
+    {
+        QImage image;
+        {
+            ProfileScope profile("image decode");
+            image = QImageReader(m_file).read();
+            image = SceneRenderer::prepareBackgroundImage(image);
+        }
+
+        QMutexLocker locker(&m_state->mutex);
+        if (m_state->cancelled)
+            return;
+        m_state->decoded.insert(m_index, image);
+        m_state->frameDecoded.wakeAll();
+    }
+
+private:
+    QSharedPointer<BackgroundImageSourceState> m_state;
+    int m_index;
+    QString m_file;
+};
+
+}
+
+BackgroundImageSource::BackgroundImageSource(const QStringList &files, int prefetchCount, QThreadPool *pool)
+    : d(new BackgroundImageSourceState),
+      m_pool(pool ? pool : QThreadPool::globalInstance())
+{
+    d->files = files;
+    d->prefetchCount = qMax(1, prefetchCount);
+
+    QMutexLocker locker(&d->mutex);
+    scheduleDecodes();
+}
+
+BackgroundImageSource::~BackgroundImageSource()
+{
+    QMutexLocker locker(&d->mutex);
+    d->cancelled = true;
+    d->decoded.clear();
+}
+
+QStringList BackgroundImageSource::imagesInDirectory(const QString &directory)
+{
+    QStringList nameFilters;
+    for (const QByteArray &format : QImageReader::supportedImageFormats())
+        nameFilters << QStringLiteral("*.") + QString::fromLatin1(format);
+
+    const QDir dir(directory);
+    QStringList files;
+    for (const QString &name : dir.entryList(nameFilters, QDir::Files, QDir::Name))
+        files << dir.filePath(name);
+    return files;
+}
+
+int BackgroundImageSource::count() const
+{
+    return d->files.size();
+}
+
+int BackgroundImageSource::position() const
+{
+    QMutexLocker locker(&d->mutex);
+    return d->nextToTake;
+}
+
+// Needs d->mutex to be locked.
+void BackgroundImageSource::scheduleDecodes()
+{
+    while (d->nextToSchedule < d->files.size()
+           && d->nextToSchedule - d->nextToTake < d->prefetchCount) {
+        m_pool->start(new DecodeTask(d, d->nextToSchedule));
+        ++d->nextToSchedule;
+    }
+}
+
+// Needs d->mutex to be locked and the next frame to be decoded.
+QImage BackgroundImageSource::take()
+{
+    const QImage image = d->decoded.take(d->nextToTake);
+    ++d->nextToTake;
+    scheduleDecodes();
+    return image;
+}
+
+QImage BackgroundImageSource::next()
+{
+    QMutexLocker locker(&d->mutex);
+    if (d->nextToTake >= d->files.size())
+        return QImage();
+    while (!d->decoded.contains(d->nextToTake))
+        d->frameDecoded.wait(&d->mutex);
+    return take();
+}
+
+bool BackgroundImageSource::tryNext(QImage *image)
+{
+    QMutexLocker locker(&d->mutex);
+    if (!d->decoded.contains(d->nextToTake))
+        return false;
+    *image = take();
+    return true;
+}
@@ -0,0 +1,93 @@
+/****************************************************************************
+**
+** Copyright (C) 2016 The Qt Company Ltd.
+** Contact: https://www.qt.io/licensing/
+**
+** This file is part of the examples of the Qt Toolkit.
+**
+** $QT_BEGIN_LICENSE:BSD$
+** Commercial License Usage
+** Licensees holding valid commercial Qt licenses may use this file in
+** accordance with the commercial license agreement provided with the
+** Software or, alternatively, in accordance with the terms contained in
+** a written agreement between you and The Qt Company. For licensing terms
+** and conditions see https://www.qt.io/terms-conditions. For further
+** information use the contact form at https://www.qt.io/contact-us.
+**
+** BSD License Usage
+** Alternatively, you may use this file under the terms of the BSD license
+** as follows:
+**
+** "Redistribution and use in source and binary forms, with or without
+** modification, are permitted provided that the following conditions are
+** met:
+**   * Redistributions of source code must retain the above copyright
+**     notice, this list of conditions and the following disclaimer.
+**   * Redistributions in binary form must reproduce the above copyright
+**     notice, this list of conditions and the following disclaimer in
+**     the documentation and/or other materials provided with the
+**     distribution.
+**   * Neither the name of The Qt Company Ltd nor the names of its
+**     contributors may be used to endorse or promote products derived
+**     from this software without specific prior written permission.
+**
+**
+** THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+** "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+** LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+** A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+** OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+** SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+** LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+** DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+** THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+** (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+** OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE."
+**
+** $QT_END_LICENSE$
+**
+****************************************************************************/
+
+#ifndef BACKGROUNDIMAGESOURCE_H
+#define BACKGROUNDIMAGESOURCE_H
+
+#include <QImage>
+#include <QSharedPointer>
+#include <QStringList>
+
+QT_FORWARD_DECLARE_CLASS(QThreadPool)
+
+struct BackgroundImageSourceState;
+
+// Streams a sequence of background images, e.g. a T-LESS train_canon
+// images folder. Decoding runs on a thread pool and stays up to
+// prefetchCount frames ahead of the consumer, so frames arrive already
+// prepared for upload (see SceneRenderer::prepareBackgroundImage()) and
+// the render loop does not wait on JPEG decoding.
+class BackgroundImageSource
+{
+public:
+    explicit BackgroundImageSource(const QStringList &files, int prefetchCount = 8,
+                                   QThreadPool *pool = nullptr);
+    ~BackgroundImageSource();
+
+    static QStringList imagesInDirectory(const QString &directory);
+
+    int count() const;
+    int position() const;
+    bool atEnd() const { return position() >= count(); }
+
+    // Returns the next frame, waiting for its decode if necessary.
+    QImage next();
+    // Returns false right away if the next frame is not decoded yet.
+    bool tryNext(QImage *image);
+
+private:
+    void scheduleDecodes();
+    QImage take();
+
+    QSharedPointer<BackgroundImageSourceState> d;
+    QThreadPool *m_pool;
+};
+
+#endif // BACKGROUNDIMAGESOURCE_H
@@ -0,0 +1,222 @@
+/****************************************************************************
+**
+** Copyright (C) 2016 The Qt Company Ltd.
+** Contact: https://www.qt.io/licensing/
+**
+** This file is part of the examples of the Qt Toolkit.
+**
+** $QT_BEGIN_LICENSE:BSD$
+** Commercial License Usage
+** Licensees holding valid commercial Qt licenses may use this file in
+** accordance with the commercial license agreement provided with the
+** Software or, alternatively, in accordance with the terms contained in
+** a written agreement between you and The Qt Company. For licensing terms
+** and conditions see https://www.qt.io/terms-conditions. For further
+** information use the contact form at https://www.qt.io/contact-us.
+**
+** BSD License Usage
+** Alternatively, you may use this file under the terms of the BSD license
+** as follows:
+**
+** "Redistribution and use in source and binary forms, with or without
+** modification, are permitted provided that the following conditions are
+** met:
+**   * Redistributions of source code must retain the above copyright
+**     notice, this list of conditions and the following disclaimer.
+**   * Redistributions in binary form must reproduce the above copyright
+**     notice, this list of conditions and the following disclaimer in
+**     the documentation and/or other materials provided with the
+**     distribution.
+**   * Neither the name of The Qt Company Ltd nor the names of its
+**     contributors may be used to endorse or promote products derived
+**     from this software without specific prior written permission.
+**
+**
+** THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+** "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+** LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+** A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+** OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+** SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+** LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+** DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+** THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+** (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+** OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE."
+**
+** $QT_END_LICENSE$
+**
+****************************************************************************/
+
+#include "backgroundtexturering.h"
+#include "profiler.h"
+
+#include <QOpenGLContext>
+#include <cstring>
+
+#ifndef GL_BGR
+#define GL_BGR 0x80E0
+#endif
+#ifndef GL_BGRA
+#define GL_BGRA 0x80E1
+#endif
+
+// How GL has to read the rows of an image prepared by uploadableImage().
+static bool pixelTransfer(QImage::Format format, bool isOpenGLES, GLenum *pixelFormat)
+{
+    switch (format) {
+    case QImage::Format_RGB888:
+        *pixelFormat = GL_RGB;
+        return true;
+#if QT_VERSION >= QT_VERSION_CHECK(5, 14, 0)
+    case QImage::Format_BGR888:
+        *pixelFormat = GL_BGR;
+        return !isOpenGLES;
+#endif
+    case QImage::Format_RGBA8888:
+    case QImage::Format_RGBX8888:
+        *pixelFormat = GL_RGBA;
+        return true;
+    case QImage::Format_RGB32:
+    case QImage::Format_ARGB32:
+        // 0xAARRGGBB words are B, G, R, A in memory on little endian.
+        *pixelFormat = GL_BGRA;
+        return !isOpenGLES && Q_BYTE_ORDER == Q_LITTLE_ENDIAN;
+    default:
+        return false;
+    }
+}
+
+BackgroundTextureRing::BackgroundTextureRing(int ringSize)
+    : m_ringSize(qMax(1, ringSize)),
+      m_unpackBuffer(QOpenGLBuffer::PixelUnpackBuffer)
+{
+}
+
+BackgroundTextureRing::~BackgroundTextureRing()
+{
+    // Textures are released through destroy() while the context is current.
+}
+
+QImage BackgroundTextureRing::uploadableImage(const QImage &image)
+{
+    GLenum pixelFormat;
+    if (image.isNull() || pixelTransfer(image.format(), false, &pixelFormat))
+        return image;
+    return image.convertToFormat(image.hasAlphaChannel() ? QImage::Format_RGBA8888
+                                                         : QImage::Format_RGB888);
+}
+
+void BackgroundTextureRing::create()
+{
+    initializeOpenGLFunctions();
+    m_unpackBuffer.setUsagePattern(QOpenGLBuffer::StreamDraw);
+    m_unpackBuffer.create();
+}
+
+void BackgroundTextureRing::destroy()
+{
+    qDeleteAll(m_textures);
+    m_textures.clear();
+    m_unpackBuffer.destroy();
+    m_unpackBytes = 0;
+    m_current = -1;
+    m_size = QSize();
+    m_imageSize = QSize();
+    m_textureFormat = QOpenGLTexture::NoFormat;
+}
+
+bool BackgroundTextureRing::ensureStorage(const QImage &image, const QSize &storageSize)
+{
+    const QOpenGLTexture::TextureFormat textureFormat = image.hasAlphaChannel()
+            ? QOpenGLTexture::RGBA8_UNorm : QOpenGLTexture::RGB8_UNorm;
+    const QSize size = image.size().expandedTo(storageSize);
+    if (m_size == size && m_textureFormat == textureFormat)
+        return true;
+
+    qDeleteAll(m_textures);
+    m_textures.clear();
+    m_current = -1;
+    m_size = size;
+    m_textureFormat = textureFormat;
+
+    for (int i = 0; i < m_ringSize; ++i) {
+        QOpenGLTexture *texture = new QOpenGLTexture(QOpenGLTexture::Target2D);
+        texture->setFormat(textureFormat);
+        texture->setSize(size.width(), size.height());
+        texture->setMipLevels(1);
+        // Uses glTexStorage2D wherever immutable storage is supported.
+        texture->allocateStorage(QOpenGLTexture::RGBA, QOpenGLTexture::UInt8);
+        if (!texture->isStorageAllocated()) {
+            delete texture;
+            qDeleteAll(m_textures);
+            m_textures.clear();
+            m_size = QSize();
+            return false;
+        }
+        texture->setMagnificationFilter(QOpenGLTexture::Nearest);
+        texture->setMinificationFilter(QOpenGLTexture::Nearest);
+        texture->setWrapMode(QOpenGLTexture::ClampToEdge);
+        m_textures.append(texture);
+    }
+    return true;
+}
+
+qint64 BackgroundTextureRing::gpuBytes() const
+{
+    // Drivers store RGB8 padded to four bytes per texel.
+    return qint64(m_textures.size()) * m_size.width() * m_size.height() * 4 + m_unpackBytes;
+}
+
+bool BackgroundTextureRing::upload(const QImage &sourceImage, const QSize &storageSize)
+{
+    ProfileScope profile("background upload");
+    const bool isOpenGLES = QOpenGLContext::currentContext()->isOpenGLES();
+    QImage image = sourceImage;
+    GLenum pixelFormat;
+    if (!pixelTransfer(image.format(), isOpenGLES, &pixelFormat)) {
+        // Only hit for BGR layouts on OpenGL ES, everything else already
+        // went through uploadableImage() on the decoding threads.
+        image = image.convertToFormat(image.hasAlphaChannel() ? QImage::Format_RGBA8888
+                                                              : QImage::Format_RGB888);
+        pixelTransfer(image.format(), isOpenGLES, &pixelFormat);
+    }
+
+    if (image.isNull() || !ensureStorage(image, storageSize)) {
+        clear();
+        return false;
+    }
+
+    // Orphan the previous contents so mapping never waits for the upload
+    // of the last image to finish.
+    const int byteCount = image.bytesPerLine() * image.height();
+    m_unpackBuffer.bind();
+    m_unpackBuffer.allocate(byteCount);
+    m_unpackBytes = byteCount;
+    void *data = m_unpackBuffer.mapRange(0, byteCount, QOpenGLBuffer::RangeWrite
+                                         | QOpenGLBuffer::RangeInvalidateBuffer);
+    if (!data) {
+        m_unpackBuffer.release();
+        clear();
+        return false;
+    }
+    std::memcpy(data, image.constBits(), byteCount);
+    m_unpackBuffer.unmap();
+
+    m_current = (m_current + 1) % m_textures.size();
+    m_textures.at(m_current)->bind();
+    // QImage rows are padded to 4 bytes, which is GL's default alignment.
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+    glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, image.width(), image.height(),
+                    pixelFormat, GL_UNSIGNED_BYTE, 0);
+    m_textures.at(m_current)->release();
+    m_unpackBuffer.release();
+    m_imageSize = image.size();
+    return true;
+}
+
+void BackgroundTextureRing::bind(uint unit)
+{
+    if (hasImage())
+        m_textures.at(m_current)->bind(unit);
+}
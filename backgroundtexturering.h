@@ -0,0 +1,104 @@
+/****************************************************************************
+**
+** Copyright (C) 2016 The Qt Company Ltd.
+** Contact: https://www.qt.io/licensing/
+**
+** This file is part of the examples of the Qt Toolkit.
+**
+** $QT_BEGIN_LICENSE:BSD$
+** Commercial License Usage
+** Licensees holding valid commercial Qt licenses may use this file in
+** accordance with the commercial license agreement provided with the
+** Software or, alternatively, in accordance with the terms contained in
+** a written agreement between you and The Qt Company. For licensing terms
+** and conditions see https://www.qt.io/terms-conditions. For further
+** information use the contact form at https://www.qt.io/contact-us.
+**
+** BSD License Usage
+** Alternatively, you may use this file under the terms of the BSD license
+** as follows:
+**
+** "Redistribution and use in source and binary forms, with or without
+** modification, are permitted provided that the following conditions are
+** met:
+**   * Redistributions of source code must retain the above copyright
+**     notice, this list of conditions and the following disclaimer.
+**   * Redistributions in binary form must reproduce the above copyright
+**     notice, this list of conditions and the following disclaimer in
+**     the documentation and/or other materials provided with the
+**     distribution.
+**   * Neither the name of The Qt Company Ltd nor the names of its
+**     contributors may be used to endorse or promote products derived
+**     from this software without specific prior written permission.
+**
+**
+** THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+** "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+** LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+** A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+** OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+** SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+** LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+** DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+** THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+** (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+** OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE."
+**
+** $QT_END_LICENSE$
+**
+****************************************************************************/
+
+#ifndef BACKGROUNDTEXTURERING_H
+#define BACKGROUNDTEXTURERING_H
+
+#include <QOpenGLFunctions>
+#include <QOpenGLBuffer>
+#include <QOpenGLTexture>
+#include <QImage>
+#include <QVector>
+
+// A fixed ring of immutable-storage textures the background images are
+// streamed into. Every upload goes through a pixel unpack buffer into the
+// next texture of the ring with glTexSubImage2D, so we neither allocate
+// per image nor write into a texture the GPU might still be reading.
+// Storage is only reallocated when size or format of the images change,
+// or never for images of varying size uploaded into fixed larger storage.
+class BackgroundTextureRing : protected QOpenGLFunctions
+{
+public:
+    explicit BackgroundTextureRing(int ringSize = 3);
+    ~BackgroundTextureRing();
+
+    // Converts image into a layout upload() takes without another copy.
+    // RGB, BGR and 32 bit images stay as they are. Needs no context.
+    static QImage uploadableImage(const QImage &image);
+
+    // Everything below needs the context the ring was created in.
+    void create();
+    void destroy();
+    // Uploads into the top left of storage of at least storageSize, see
+    // imageSize(). Storage of the image size if storageSize is invalid.
+    bool upload(const QImage &image, const QSize &storageSize = QSize());
+    void clear() { m_current = -1; }
+    bool hasImage() const { return m_current >= 0; }
+    void bind(uint unit = 0);
+    QSize size() const { return m_size; }
+    // The part of size() the current image covers.
+    QSize imageSize() const { return m_imageSize; }
+    // Texture storage of the ring and the unpack buffer, estimated.
+    qint64 gpuBytes() const;
+
+private:
+    bool ensureStorage(const QImage &image, const QSize &storageSize);
+
+    int m_ringSize;
+    int m_current = -1;
+    QSize m_size;
+    QSize m_imageSize;
+    QOpenGLTexture::TextureFormat m_textureFormat = QOpenGLTexture::NoFormat;
+    QVector<QOpenGLTexture *> m_textures;
+    QOpenGLBuffer m_unpackBuffer;
+    int m_unpackBytes = 0;
+};
+
+#endif // BACKGROUNDTEXTURERING_H
@@ -0,0 +1,7 @@
+# Headless performance sweep, run with -platform offscreen.
+TARGET        = benchmark
+CONFIG       += console
+CONFIG       -= app_bundle
+SOURCES       = main.cpp
+
+include(../renderer.pri)
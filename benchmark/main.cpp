@@ -0,0 +1,253 @@
+/****************************************************************************
+**
+** Copyright (C) 2016 The Qt Company Ltd.
+** Contact: https://www.qt.io/licensing/
+**
+** This file is part of the examples of the Qt Toolkit.
+**
+** $QT_BEGIN_LICENSE:BSD$
+** Commercial License Usage
+** Licensees holding valid commercial Qt licenses may use this file in
+** accordance with the commercial license agreement provided with the
+** Software or, alternatively, in accordance with the terms contained in
+** a written agreement between you and The Qt Company. For licensing terms
+** and conditions see https://www.qt.io/terms-conditions. For further
+** information use the contact form at https://www.qt.io/contact-us.
+**
+** BSD License Usage
+** Alternatively, you may use this file under the terms of the BSD license
+** as follows:
+**
+** "Redistribution and use in source and binary forms, with or without
+** modification, are permitted provided that the following conditions are
+** met:
+**   * Redistributions of source code must retain the above copyright
+**     notice, this list of conditions and the following disclaimer.
+**   * Redistributions in binary form must reproduce the above copyright
+**     notice, this list of conditions and the following disclaimer in
+**     the documentation and/or other materials provided with the
+**     distribution.
+**   * Neither the name of The Qt Company Ltd nor the names of its
+**     contributors may be used to endorse or promote products derived
+**     from this software without specific prior written permission.
+**
+**
+** THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+** "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+** LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+** A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+** OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+** SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+** LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+** DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+** THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+** (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+** OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE."
+**
+** $QT_END_LICENSE$
+**
+****************************************************************************/
+
+#include <QGuiApplication>
+#include <QCommandLineParser>
+#include <QElapsedTimer>
+#include <QImage>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QTextStream>
+#include <QDebug>
+#include <qmath.h>
+
+#include "offscreenrenderer.h"
+#include "profiler.h"
+
+// A UV sphere of 50 mm radius with roughly triangleCount triangles.
+static ObjectModelRenerable sphere(int triangleCount)
+{
+    const int rings = qMax(2, int(qSqrt(triangleCount / 4.0)));
+    const int sectors = 2 * rings;
+    QVector<GLfloat> vertices;
+    QVector<GLfloat> normals;
+    QVector<GLuint> indices;
+    vertices.reserve((rings + 1) * (sectors + 1) * 3);
+    normals.reserve(vertices.capacity());
+    indices.reserve(rings * sectors * 6);
+
+    for (int r = 0; r <= rings; ++r) {
+        const float theta = float(M_PI) * r / rings;
+        for (int s = 0; s <= sectors; ++s) {
+            const float phi = 2.0f * float(M_PI) * s / sectors;
+            const float x = qSin(theta) * qCos(phi);
+            const float y = qSin(theta) * qSin(phi);
+            const float z = qCos(theta);
+            vertices << 50.0f * x << 50.0f * y << 50.0f * z;
+            normals << x << y << z;
+        }
+    }
+    for (int r = 0; r < rings; ++r) {
+        for (int s = 0; s < sectors; ++s) {
+            const GLuint a = r * (sectors + 1) + s;
+            const GLuint b = a + sectors + 1;
+            indices << a << b << a + 1 << a + 1 << b << b + 1;
+        }
+    }
+    return ObjectModelRenerable(vertices, normals, indices);
+}
+
+static QImage background(const QSize &size)
+{
+    QImage image(size, QImage::Format_RGB888);
+    for (int y = 0; y < size.height(); ++y) {
+        uchar *line = image.scanLine(y);
+        for (int x = 0; x < size.width(); ++x) {
+            line[3 * x] = uchar(x);
+            line[3 * x + 1] = uchar(y);
+            line[3 * x + 2] = uchar(x ^ y);
+        }
+    }
+    return image;
+}
+
+static QVector<int> intList(const QString &value)
+{
+    QVector<int> values;
+    for (const QString &item : value.split(',', QString::SkipEmptyParts))
+        values << item.toInt();
+    return values;
+}
+
+static QVector<QSize> sizeList(const QString &value)
+{
+    QVector<QSize> sizes;
+    for (const QString &item : value.split(',', QString::SkipEmptyParts)) {
+        const QStringList size = item.split('x');
+        if (size.size() == 2)
+            sizes << QSize(size.at(0).toInt(), size.at(1).toInt());
+    }
+    return sizes;
+}
+
+static double megabytesPerSecond(qint64 bytes, double milliseconds)
+{
+    return milliseconds > 0.0 ? bytes / (milliseconds * 1000.0) : 0.0;
+}
+
+int main(int argc, char *argv[])
+{
+    QGuiApplication app(argc, argv);
+
+    QCommandLineParser parser;
+    parser.setApplicationDescription("Sweeps mesh sizes, background resolutions, antialiasing modes and instance counts "
+                                     "through the offscreen renderer and prints one JSON object per run.");
+    parser.addHelpOption();
+    QCommandLineOption trianglesOption("triangles", "Synthetic mesh sizes.", "list", "1000,10000,100000,1000000,5000000");
+    QCommandLineOption backgroundsOption("backgrounds", "Background and framebuffer sizes.", "list",
+                                         "640x480,1280x720,1920x1080,3840x2160");
+    QCommandLineOption antialiasingOption("antialiasing", "Antialiasing modes (none, msaa2, msaa4, msaa8, fxaa).",
+                                          "list", "none,msaa4,fxaa");
+    QCommandLineOption instancesOption("instances", "Poses drawn per frame.", "list", "1,100");
+    QCommandLineOption framesOption("frames", "Frames rendered per run.", "count", "60");
+    parser.addOption(trianglesOption);
+    parser.addOption(backgroundsOption);
+    parser.addOption(antialiasingOption);
+    parser.addOption(instancesOption);
+    parser.addOption(framesOption);
+    parser.process(app);
+
+    const int frameCount = qMax(1, parser.value(framesOption).toInt());
+    Profiler *profiler = Profiler::instance();
+    profiler->setEnabled(true);
+    QTextStream out(stdout);
+
+    for (int triangles : intList(parser.value(trianglesOption))) {
+        const ObjectModelRenerable model = sphere(triangles);
+        const qint64 modelBytes = qint64(model.verticesCount() + model.normalsCount()) * sizeof(GLfloat)
+                + qint64(model.indicesCount()) * sizeof(GLuint);
+
+        for (const QSize &size : sizeList(parser.value(backgroundsOption))) {
+            const QImage image = background(size);
+            for (const QString &modeName : parser.value(antialiasingOption).split(',', QString::SkipEmptyParts)) {
+                AntialiasingMode antialiasing;
+                if (!parseAntialiasingMode(modeName, &antialiasing)) {
+                    qWarning() << "Unknown antialiasing mode" << modeName;
+                    return 1;
+                }
+                OffscreenRenderer renderer(size, antialiasing);
+                if (!renderer.create())
+                    return 1;
+                renderer.setReadbackMode(OffscreenRenderer::PixelBufferReadback);
+
+                QElapsedTimer timer;
+                timer.start();
+                const int modelId = renderer.addObjectModel(model);
+                renderer.finish();
+                const double modelUploadMs = timer.nsecsElapsed() / 1e6;
+
+                CameraIntrinsics intrinsics;
+                intrinsics.fx = intrinsics.fy = size.width();
+                intrinsics.cx = size.width() / 2.0f;
+                intrinsics.cy = size.height() / 2.0f;
+
+                for (int instances : intList(parser.value(instancesOption))) {
+                    RenderJob job;
+                    job.background = image;
+                    job.intrinsics = intrinsics;
+                    job.pose.translate(0.0f, 0.0f, 600.0f);
+                    if (instances <= 1) {
+                        SceneObject object;
+                        object.modelId = modelId;
+                        job.objects << object;
+                    } else {
+                        // A grid of poses filling the shorter side of the
+                        // view at the distance of the pose, so every
+                        // instance is on screen.
+                        InstanceGroup group;
+                        group.modelId = modelId;
+                        const int columns = qCeil(qSqrt(instances));
+                        const float spacing = 600.0f * qMin(size.width(), size.height()) / intrinsics.fx / columns;
+                        const float center = (columns - 1) / 2.0f;
+                        for (int i = 0; i < instances; ++i) {
+                            ObjectInstance instance;
+                            instance.modelMatrix.translate(spacing * (i % columns - center),
+                                                           spacing * (i / columns - center), 0.0f);
+                            instance.modelMatrix.scale(1.0f / columns);
+                            group.instances << instance;
+                        }
+                        job.instanceGroups << group;
+                    }
+
+                    // Warm up, then measure without the first frames.
+                    const auto ignore = [](int, const QImage &) {};
+                    renderer.render(QVector<RenderJob>(3, job), ignore);
+                    renderer.finish();
+                    profiler->clear();
+                    timer.restart();
+                    renderer.render(QVector<RenderJob>(frameCount, job), ignore);
+                    renderer.finish();
+                    const double totalMs = timer.nsecsElapsed() / 1e6;
+
+                    const qint64 frameBytes = qint64(size.width()) * size.height() * 4;
+                    const qint64 backgroundBytes = qint64(image.sizeInBytes());
+                    QJsonObject result;
+                    result["triangles"] = model.indicesCount() / 3;
+                    result["width"] = size.width();
+                    result["height"] = size.height();
+                    result["antialiasing"] = antialiasingModeName(antialiasing);
+                    result["instances"] = instances;
+                    result["frames"] = frameCount;
+                    result["fps"] = frameCount * 1000.0 / totalMs;
+                    result["model_upload_mbps"] = megabytesPerSecond(modelBytes, modelUploadMs);
+                    result["background_upload_mbps"] =
+                            megabytesPerSecond(backgroundBytes, profiler->stats("background upload").median);
+                    result["readback_mbps"] =
+                            megabytesPerSecond(frameBytes, profiler->stats("readback deliver").median);
+                    for (const char *stage : { "background pass", "object pass" })
+                        result[QString(stage).replace(' ', '_') + "_ms"] = profiler->stats(stage).median;
+                    out << QJsonDocument(result).toJson(QJsonDocument::Compact) << '\n';
+                    out.flush();
+                }
+            }
+        }
+    }
+    return 0;
+}
@@ -0,0 +1,624 @@
+/****************************************************************************
+**
+** Copyright (C) 2016 The Qt Company Ltd.
+** Contact: https://www.qt.io/licensing/
+**
+** This file is part of the examples of the Qt Toolkit.
+**
+** $QT_BEGIN_LICENSE:BSD$
+** Commercial License Usage
+** Licensees holding valid commercial Qt licenses may use this file in
+** accordance with the commercial license agreement provided with the
+** Software or, alternatively, in accordance with the terms contained in
+** a written agreement between you and The Qt Company. For licensing terms
+** and conditions see https://www.qt.io/terms-conditions. For further
+** information use the contact form at https://www.qt.io/contact-us.
+**
+** BSD License Usage
+** Alternatively, you may use this file under the terms of the BSD license
+** as follows:
+**
+** "Redistribution and use in source and binary forms, with or without
+** modification, are permitted provided that the following conditions are
+** met:
+**   * Redistributions of source code must retain the above copyright
+**     notice, this list of conditions and the following disclaimer.
+**   * Redistributions in binary form must reproduce the above copyright
+**     notice, this list of conditions and the following disclaimer in
+**     the documentation and/or other materials provided with the
+**     distribution.
+**   * Neither the name of The Qt Company Ltd nor the names of its
+**     contributors may be used to endorse or promote products derived
+**     from this software without specific prior written permission.
+**
+**
+** THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+** "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+** LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+** A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+** OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+** SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+** LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+** DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+** THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+** (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+** OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE."
+**
+** $QT_END_LICENSE$
+**
+****************************************************************************/
+
+#include "cpurasterizer.h"
+#include "posebatch.h"
+#include "profiler.h"
+
+#include <QAtomicInt>
+#include <QRunnable>
+#include <QThread>
+#include <QDebug>
+
+#include <algorithm>
+#include <cmath>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define CPURASTERIZER_SSE2
+#include <emmintrin.h>
+#endif
+
+namespace {
+
+// Vertices snap to 1/256 pixel, like they do on Mesa and most GPUs.
+const int SubpixelBits = 8;
+const int SubpixelScale = 1 << SubpixelBits;
+// Screen tiles are the unit of work of the threads, blocks the unit edge
+// functions are classified in.
+const int TileSize = 64;
+const int BlockSize = 8;
+// Triangles are clipped to this many viewports around the image, which
+// keeps the fixed point coordinates small.
+const float GuardBand = 64.0f;
+const int ClipPlaneCount = 5;
+const int MaxClipVertices = 3 + ClipPlaneCount;
+// Triangles set up by one task.
+const int SetupChunk = 4096;
+
+struct ClipVertex
+{
+    float x, y, z, w;
+};
+
+// Edge functions a * x + b * y + c in 1/256 pixel, positive inside, with
+// the top-left rule folded into c. NDC depth is a plane over pixel
+// centers, relative to the one of (minX, minY).
+struct Triangle
+{
+    qint64 c[3];
+    qint32 a[3];
+    qint32 b[3];
+    float zBase;
+    float zx;
+    float zy;
+    float objectId;
+    int minX;
+    int minY;
+    int maxX;
+    int maxY;
+    // Edge values inside a block fit into 32 bits.
+    bool narrow;
+};
+
+struct DrawItem
+{
+    int modelId;
+    float objectId;
+    const float *modelMatrix;
+};
+
+inline qint64 floorDivide(qint64 value, qint64 divisor)
+{
+    return value >= 0 ? value / divisor : -((-value + divisor - 1) / divisor);
+}
+
+inline ClipVertex transform(const float *m, const float *p)
+{
+    // Column-major, like QMatrix4x4::constData().
+    ClipVertex v;
+    v.x = m[0] * p[0] + m[4] * p[1] + m[8] * p[2] + m[12];
+    v.y = m[1] * p[0] + m[5] * p[1] + m[9] * p[2] + m[13];
+    v.z = m[2] * p[0] + m[6] * p[1] + m[10] * p[2] + m[14];
+    v.w = m[3] * p[0] + m[7] * p[1] + m[11] * p[2] + m[15];
+    return v;
+}
+
+// Near plane first, the far plane is left to the depth test.
+inline float planeDistance(const ClipVertex &v, int plane)
+{
+    switch (plane) {
+    case 0: return v.z + v.w;
+    case 1: return GuardBand * v.w + v.x;
+    case 2: return GuardBand * v.w - v.x;
+    case 3: return GuardBand * v.w + v.y;
+    default: return GuardBand * v.w - v.y;
+    }
+}
+
+// Sutherland-Hodgman, returns the vertex count of the clipped polygon.
+int clipPolygon(ClipVertex *polygon, int count)
+{
+    ClipVertex clipped[MaxClipVertices];
+    for (int plane = 0; plane < ClipPlaneCount && count >= 3; ++plane) {
+        int clippedCount = 0;
+        for (int i = 0; i < count; ++i) {
+            const ClipVertex &current = polygon[i];
+            const ClipVertex &next = polygon[(i + 1) % count];
+            const float currentDistance = planeDistance(current, plane);
+            const float nextDistance = planeDistance(next, plane);
+            if (currentDistance >= 0.0f)
+                clipped[clippedCount++] = current;
+            if ((currentDistance >= 0.0f) != (nextDistance >= 0.0f)) {
+                const float t = currentDistance / (currentDistance - nextDistance);
+                ClipVertex &v = clipped[clippedCount++];
+                v.x = current.x + t * (next.x - current.x);
+                v.y = current.y + t * (next.y - current.y);
+                v.z = current.z + t * (next.z - current.z);
+                v.w = current.w + t * (next.w - current.w);
+            }
+        }
+        std::copy(clipped, clipped + clippedCount, polygon);
+        count = clippedCount;
+    }
+    return count >= 3 ? count : 0;
+}
+
+// Projects, snaps and culls one clipped triangle. The targets of
+// OffscreenRenderer are rendered upside down with clockwise front faces,
+// so rows here go top-down and front faces have negative orientation.
+void setupTriangle(const ClipVertex &v0, const ClipVertex &v1, const ClipVertex &v2,
+                   int width, int height, float objectId, QVector<Triangle> *triangles)
+{
+    const ClipVertex *vertices[3] = { &v0, &v1, &v2 };
+    qint64 x[3];
+    qint64 y[3];
+    float z[3];
+    for (int k = 0; k < 3; ++k) {
+        const ClipVertex &v = *vertices[k];
+        const float windowX = (v.x / v.w * 0.5f + 0.5f) * width;
+        const float windowY = (0.5f - v.y / v.w * 0.5f) * height;
+        x[k] = qint64(std::floor(double(windowX) * SubpixelScale + 0.5));
+        y[k] = qint64(std::floor(double(windowY) * SubpixelScale + 0.5));
+        z[k] = v.z / v.w;
+    }
+
+    const qint64 orientation = (x[1] - x[0]) * (y[2] - y[0]) - (y[1] - y[0]) * (x[2] - x[0]);
+    if (orientation >= 0)
+        return;
+    std::swap(x[1], x[2]);
+    std::swap(y[1], y[2]);
+    std::swap(z[1], z[2]);
+
+    const qint64 minX = qMin(x[0], qMin(x[1], x[2]));
+    const qint64 maxX = qMax(x[0], qMax(x[1], x[2]));
+    const qint64 minY = qMin(y[0], qMin(y[1], y[2]));
+    const qint64 maxY = qMax(y[0], qMax(y[1], y[2]));
+    const int halfPixel = SubpixelScale / 2;
+
+    Triangle triangle;
+    triangle.minX = int(qMax<qint64>(0, floorDivide(minX - halfPixel + SubpixelScale - 1, SubpixelScale)));
+    triangle.minY = int(qMax<qint64>(0, floorDivide(minY - halfPixel + SubpixelScale - 1, SubpixelScale)));
+    triangle.maxX = int(qMin<qint64>(width - 1, floorDivide(maxX - halfPixel, SubpixelScale)));
+    triangle.maxY = int(qMin<qint64>(height - 1, floorDivide(maxY - halfPixel, SubpixelScale)));
+    if (triangle.minX > triangle.maxX || triangle.minY > triangle.maxY)
+        return;
+
+    triangle.narrow = true;
+    for (int k = 0; k < 3; ++k) {
+        const int next = (k + 1) % 3;
+        const qint64 dx = x[next] - x[k];
+        const qint64 dy = y[next] - y[k];
+        triangle.a[k] = qint32(-dy);
+        triangle.b[k] = qint32(dx);
+        triangle.c[k] = dy * x[k] - dx * y[k];
+        // Pixel centers exactly on an edge belong to the triangle left of
+        // or below it on screen, the top-left rule of GL window coordinates.
+        if (!(dy < 0 || (dy == 0 && dx < 0)))
+            triangle.c[k] -= 1;
+        const qint64 blockExtent = 2 * (BlockSize - 1) * (qAbs(dx) + qAbs(dy)) * SubpixelScale;
+        if (blockExtent >= (qint64(1) << 31))
+            triangle.narrow = false;
+    }
+
+    // Depth plane in pixels, through the snapped vertices.
+    const double ex1 = double(x[1] - x[0]) / SubpixelScale;
+    const double ey1 = double(y[1] - y[0]) / SubpixelScale;
+    const double ex2 = double(x[2] - x[0]) / SubpixelScale;
+    const double ey2 = double(y[2] - y[0]) / SubpixelScale;
+    const double dz1 = double(z[1]) - z[0];
+    const double dz2 = double(z[2]) - z[0];
+    const double determinant = ex1 * ey2 - ex2 * ey1;
+    const double zx = (dz1 * ey2 - dz2 * ey1) / determinant;
+    const double zy = (ex1 * dz2 - ex2 * dz1) / determinant;
+    const double baseX = triangle.minX + 0.5 - double(x[0]) / SubpixelScale;
+    const double baseY = triangle.minY + 0.5 - double(y[0]) / SubpixelScale;
+    triangle.zBase = float(z[0] + zx * baseX + zy * baseY);
+    triangle.zx = float(zx);
+    triangle.zy = float(zy);
+    triangle.objectId = objectId;
+    triangles->append(triangle);
+}
+
+// Where the pixels [x0, x1) x [y0, y1) of one block are, within the depth
+// and mask of a tile.
+struct BlockCoverage
+{
+    qint64 edge[3];
+    qint64 stepX[3];
+    qint64 stepY[3];
+    bool test[3];
+    int blockX;
+    int blockY;
+    int x0, x1, y0, y1;
+};
+
+void fillBlock(const Triangle &triangle, const BlockCoverage &block, int tileX, int tileY,
+               float *depth, float *mask)
+{
+    for (int y = block.y0; y < block.y1; ++y) {
+        float *depthRow = depth + (y - tileY) * TileSize - tileX;
+        float *maskRow = mask + (y - tileY) * TileSize - tileX;
+        const float rowDepth = triangle.zBase + triangle.zy * float(y - triangle.minY);
+        for (int x = block.x0; x < block.x1; ++x) {
+            bool inside = true;
+            for (int k = 0; k < 3 && inside; ++k) {
+                if (block.test[k]) {
+                    inside = block.edge[k] + (x - block.blockX) * block.stepX[k]
+                            + (y - block.blockY) * block.stepY[k] >= 0;
+                }
+            }
+            if (!inside)
+                continue;
+            const float z = rowDepth + triangle.zx * float(x - triangle.minX);
+            if (z < depthRow[x]) {
+                depthRow[x] = z;
+                maskRow[x] = triangle.objectId;
+            }
+        }
+    }
+}
+
+#ifdef CPURASTERIZER_SSE2
+// The same for narrow triangles, four pixels of a row at a time.
+void fillBlockSse2(const Triangle &triangle, const BlockCoverage &block, int tileX, int tileY,
+                   float *depth, float *mask)
+{
+    const __m128i lanes = _mm_setr_epi32(0, 1, 2, 3);
+    __m128i laneSteps[3];
+    for (int k = 0; k < 3; ++k) {
+        const qint32 step = qint32(block.stepX[k]);
+        laneSteps[k] = _mm_setr_epi32(0, step, 2 * step, 3 * step);
+    }
+    const __m128i first = _mm_set1_epi32(block.x0);
+    const __m128i end = _mm_set1_epi32(block.x1);
+    const __m128i minusOne = _mm_set1_epi32(-1);
+    const __m128 zx = _mm_set1_ps(triangle.zx);
+    const __m128 objectId = _mm_set1_ps(triangle.objectId);
+
+    for (int y = block.y0; y < block.y1; ++y) {
+        float *depthRow = depth + (y - tileY) * TileSize - tileX;
+        float *maskRow = mask + (y - tileY) * TileSize - tileX;
+        const __m128 rowDepth = _mm_set1_ps(triangle.zBase + triangle.zy * float(y - triangle.minY));
+        for (int offset = 0; offset < BlockSize; offset += 4) {
+            const int x = block.blockX + offset;
+            if (x >= block.x1 || x + 4 <= block.x0)
+                continue;
+            const __m128i columns = _mm_add_epi32(_mm_set1_epi32(x), lanes);
+            __m128i inside = _mm_andnot_si128(_mm_cmplt_epi32(columns, first), _mm_cmplt_epi32(columns, end));
+            for (int k = 0; k < 3; ++k) {
+                if (!block.test[k])
+                    continue;
+                const qint32 rowEdge = qint32(block.edge[k] + offset * block.stepX[k]
+                                              + (y - block.blockY) * block.stepY[k]);
+                const __m128i edge = _mm_add_epi32(_mm_set1_epi32(rowEdge), laneSteps[k]);
+                inside = _mm_and_si128(inside, _mm_cmpgt_epi32(edge, minusOne));
+            }
+            if (_mm_movemask_epi8(inside) == 0)
+                continue;
+
+            const __m128 pixelX = _mm_cvtepi32_ps(_mm_sub_epi32(columns, _mm_set1_epi32(triangle.minX)));
+            const __m128 z = _mm_add_ps(rowDepth, _mm_mul_ps(zx, pixelX));
+            const __m128 oldDepth = _mm_loadu_ps(depthRow + x);
+            const __m128 oldMask = _mm_loadu_ps(maskRow + x);
+            const __m128 pass = _mm_and_ps(_mm_castsi128_ps(inside), _mm_cmplt_ps(z, oldDepth));
+            _mm_storeu_ps(depthRow + x, _mm_or_ps(_mm_and_ps(pass, z), _mm_andnot_ps(pass, oldDepth)));
+            _mm_storeu_ps(maskRow + x, _mm_or_ps(_mm_and_ps(pass, objectId), _mm_andnot_ps(pass, oldMask)));
+        }
+    }
+}
+#endif
+
+// Draws the part of triangle inside the tile at (tileX, tileY), whose
+// depth and mask are TileSize floats wide.
+void rasterizeTriangle(const Triangle &triangle, int tileX, int tileY, int tileWidth, int tileHeight,
+                       float *depth, float *mask)
+{
+    const int x0 = qMax(triangle.minX, tileX);
+    const int x1 = qMin(triangle.maxX + 1, tileX + tileWidth);
+    const int y0 = qMax(triangle.minY, tileY);
+    const int y1 = qMin(triangle.maxY + 1, tileY + tileHeight);
+
+    BlockCoverage block;
+    for (int k = 0; k < 3; ++k) {
+        block.stepX[k] = qint64(triangle.a[k]) * SubpixelScale;
+        block.stepY[k] = qint64(triangle.b[k]) * SubpixelScale;
+    }
+    for (int blockY = y0 & ~(BlockSize - 1); blockY < y1; blockY += BlockSize) {
+        for (int blockX = x0 & ~(BlockSize - 1); blockX < x1; blockX += BlockSize) {
+            // Edge values at the first pixel center of the block, and the
+            // range they take within it.
+            bool rejected = false;
+            for (int k = 0; k < 3 && !rejected; ++k) {
+                block.edge[k] = qint64(triangle.a[k]) * (qint64(blockX) * SubpixelScale + SubpixelScale / 2)
+                        + qint64(triangle.b[k]) * (qint64(blockY) * SubpixelScale + SubpixelScale / 2)
+                        + triangle.c[k];
+                const qint64 low = block.edge[k] + (BlockSize - 1) * (qMin<qint64>(block.stepX[k], 0)
+                                                                     + qMin<qint64>(block.stepY[k], 0));
+                const qint64 high = block.edge[k] + (BlockSize - 1) * (qMax<qint64>(block.stepX[k], 0)
+                                                                      + qMax<qint64>(block.stepY[k], 0));
+                rejected = high < 0;
+                block.test[k] = low < 0;
+            }
+            if (rejected)
+                continue;
+
+            block.blockX = blockX;
+            block.blockY = blockY;
+            block.x0 = qMax(blockX, x0);
+            block.x1 = qMin(blockX + BlockSize, x1);
+            block.y0 = qMax(blockY, y0);
+            block.y1 = qMin(blockY + BlockSize, y1);
+#ifdef CPURASTERIZER_SSE2
+            if (triangle.narrow) {
+                fillBlockSse2(triangle, block, tileX, tileY, depth, mask);
+                continue;
+            }
+#endif
+            fillBlock(triangle, block, tileX, tileY, depth, mask);
+        }
+    }
+}
+
+class ParallelTask : public QRunnable
+{
+public:
+    ParallelTask(QAtomicInt *next, int count, const std::function<void(int)> &body)
+        : m_next(next), m_count(count), m_body(body)
+    {
+    }
+
+    void run() override
+    {
+        for (int i = m_next->fetchAndAddRelaxed(1); i < m_count; i = m_next->fetchAndAddRelaxed(1))
+            m_body(i);
+    }
+
+private:
+    QAtomicInt *m_next;
+    int m_count;
+    const std::function<void(int)> &m_body;
+};
+
+} // namespace
+
+CpuRasterizer::CpuRasterizer(const QSize &size, int threadCount)
+    : m_size(size)
+{
+    m_pool.setMaxThreadCount(threadCount > 0 ? threadCount : QThread::idealThreadCount());
+}
+
+CpuRasterizer::~CpuRasterizer()
+{
+    m_pool.waitForDone();
+}
+
+void CpuRasterizer::setObjectModel(const ObjectModelRenerable &objectModel)
+{
+    m_models.clear();
+    SceneObject object;
+    object.modelId = addObjectModel(objectModel);
+    m_defaultObjects = QVector<SceneObject>() << object;
+}
+
+int CpuRasterizer::addObjectModel(const ObjectModelRenerable &objectModel)
+{
+    Model model;
+    const MeshSpan<GLfloat> vertices = objectModel.vertexSpan();
+    model.positions = QVector<float>(vertices.size);
+    std::copy(vertices.begin(), vertices.end(), model.positions.begin());
+
+    // Only the level as imported, the coarser ones index the same vertices.
+    const GLuint *indices = objectModel.indexData();
+    const SubMesh *subMeshes = objectModel.subMeshData(0);
+    for (int i = 0; i < objectModel.subMeshCount(); ++i) {
+        const GLuint *first = indices + subMeshes[i].firstIndex;
+        for (quint32 j = 0; j < subMeshes[i].indexCount; ++j)
+            model.indices.append(first[j]);
+    }
+    if (model.positions.isEmpty())
+        qWarning() << "CpuRasterizer: model has no vertices, was its CPU data released?";
+
+    m_models.append(model);
+    return m_models.size() - 1;
+}
+
+void CpuRasterizer::parallelFor(int count, const std::function<void(int)> &body)
+{
+    const int taskCount = qMin(count, m_pool.maxThreadCount());
+    if (taskCount <= 1) {
+        for (int i = 0; i < count; ++i)
+            body(i);
+        return;
+    }
+    QAtomicInt next(0);
+    for (int i = 0; i < taskCount; ++i)
+        m_pool.start(new ParallelTask(&next, count, body));
+    m_pool.waitForDone();
+}
+
+RenderTargets CpuRasterizer::render(const RenderJob &job)
+{
+    const int width = m_size.width();
+    const int height = m_size.height();
+
+    // The order SceneRenderer draws in, which decides depth ties: opaque
+    // instance groups stably sorted by model, then everything blended in
+    // submission order.
+    const QMatrix4x4 projection = SceneRenderer::projectionMatrix(job.intrinsics, m_size);
+    const QMatrix4x4 view = SceneRenderer::viewMatrix(job.pose);
+    const bool useDefault = job.objects.isEmpty() && job.instanceGroups.isEmpty();
+    const QVector<SceneObject> &objects = useDefault ? m_defaultObjects : job.objects;
+    QVector<DrawItem> opaqueItems;
+    QVector<DrawItem> blendedItems;
+    int objectId = 0;
+    for (const SceneObject &object : objects) {
+        ++objectId;
+        if (object.modelId < 0 || object.modelId >= m_models.size()) {
+            qWarning() << "CpuRasterizer: unknown model" << object.modelId;
+            continue;
+        }
+        DrawItem item;
+        item.modelId = object.modelId;
+        item.objectId = objectId;
+        item.modelMatrix = object.modelMatrix.constData();
+        blendedItems.append(item);
+    }
+    for (const InstanceGroup &group : job.instanceGroups) {
+        ++objectId;
+        if (group.modelId < 0 || group.modelId >= m_models.size()) {
+            qWarning() << "CpuRasterizer: unknown model" << group.modelId;
+            continue;
+        }
+        bool blended = false;
+        for (const ObjectInstance &instance : group.instances)
+            blended = blended || instance.color.w() < 1.0f;
+        for (const ObjectInstance &instance : group.instances) {
+            DrawItem item;
+            item.modelId = group.modelId;
+            item.objectId = objectId;
+            item.modelMatrix = instance.modelMatrix.constData();
+            (blended ? blendedItems : opaqueItems).append(item);
+        }
+    }
+    const auto byModel = [](const DrawItem &a, const DrawItem &b) { return a.modelId < b.modelId; };
+    std::stable_sort(opaqueItems.begin(), opaqueItems.end(), byModel);
+    const QVector<DrawItem> items = opaqueItems + blendedItems;
+
+    // The matrices SceneRenderer draws with, out of PoseBatch as well.
+    QVector<float> models(items.size() * 16);
+    for (int i = 0; i < items.size(); ++i)
+        std::copy_n(items.at(i).modelMatrix, 16, models.data() + 16 * i);
+    QVector<float> matrices(items.size() * PoseBatch::Stride);
+    PoseBatch::compute(projection * view, view, models.constData(), 16, items.size(), matrices.data());
+
+    // Triangle setup in chunks of every item, kept in drawing order.
+    struct SetupRange
+    {
+        int item;
+        int firstTriangle;
+        int triangleCount;
+    };
+    QVector<SetupRange> ranges;
+    for (int i = 0; i < items.size(); ++i) {
+        const int triangleCount = m_models.at(items.at(i).modelId).indices.size() / 3;
+        for (int first = 0; first < triangleCount; first += SetupChunk) {
+            SetupRange range;
+            range.item = i;
+            range.firstTriangle = first;
+            range.triangleCount = qMin(SetupChunk, triangleCount - first);
+            ranges.append(range);
+        }
+    }
+
+    QVector<QVector<Triangle> > triangles(ranges.size());
+    {
+        ProfileScope profile("cpu triangle setup");
+        parallelFor(ranges.size(), [&](int rangeIndex) {
+            const SetupRange &range = ranges.at(rangeIndex);
+            const DrawItem &item = items.at(range.item);
+            const Model &model = m_models.at(item.modelId);
+            const float *matrix = matrices.constData() + range.item * PoseBatch::Stride;
+            const quint32 *indices = model.indices.constData() + 3 * range.firstTriangle;
+            QVector<Triangle> &setUp = triangles[rangeIndex];
+            setUp.reserve(range.triangleCount);
+            ClipVertex polygon[MaxClipVertices];
+            for (int t = 0; t < range.triangleCount; ++t, indices += 3) {
+                bool inside = true;
+                for (int k = 0; k < 3; ++k) {
+                    polygon[k] = transform(matrix, model.positions.constData() + 3 * indices[k]);
+                    for (int plane = 0; plane < ClipPlaneCount && inside; ++plane)
+                        inside = planeDistance(polygon[k], plane) >= 0.0f;
+                }
+                const int count = inside ? 3 : clipPolygon(polygon, 3);
+                for (int k = 1; k + 1 < count; ++k)
+                    setupTriangle(polygon[0], polygon[k], polygon[k + 1], width, height, item.objectId, &setUp);
+            }
+        });
+    }
+
+    const int tilesX = (width + TileSize - 1) / TileSize;
+    const int tilesY = (height + TileSize - 1) / TileSize;
+    QVector<QVector<const Triangle *> > bins(tilesX * tilesY);
+    {
+        ProfileScope profile("cpu binning");
+        for (const QVector<Triangle> &chunk : triangles) {
+            for (const Triangle &triangle : chunk) {
+                for (int tileY = triangle.minY / TileSize; tileY <= triangle.maxY / TileSize; ++tileY) {
+                    for (int tileX = triangle.minX / TileSize; tileX <= triangle.maxX / TileSize; ++tileX)
+                        bins[tileY * tilesX + tileX].append(&triangle);
+                }
+            }
+        }
+    }
+
+    RenderTargets targets;
+    targets.depth = QVector<float>(width * height);
+    targets.mask = QVector<float>(width * height);
+    float *depthTarget = targets.depth.data();
+    float *maskTarget = targets.mask.data();
+    {
+        ProfileScope profile("cpu rasterization");
+        const float n = job.intrinsics.nearPlane;
+        const float f = job.intrinsics.farPlane;
+        parallelFor(bins.size(), [&](int tile) {
+            const int tileX = (tile % tilesX) * TileSize;
+            const int tileY = (tile / tilesX) * TileSize;
+            const int tileWidth = qMin(TileSize, width - tileX);
+            const int tileHeight = qMin(TileSize, height - tileY);
+            // NDC depth, cleared to the far plane, so anything beyond it
+            // fails the depth test.
+            float depth[TileSize * TileSize];
+            float mask[TileSize * TileSize];
+            std::fill(depth, depth + TileSize * TileSize, 1.0f);
+            std::fill(mask, mask + TileSize * TileSize, 0.0f);
+            for (const Triangle *triangle : bins.at(tile))
+                rasterizeTriangle(*triangle, tileX, tileY, tileWidth, tileHeight, depth, mask);
+
+            // Linear depth like the fragment shader of SceneRenderer writes.
+            for (int y = 0; y < tileHeight; ++y) {
+                float *depthRow = depthTarget + (tileY + y) * width + tileX;
+                float *maskRow = maskTarget + (tileY + y) * width + tileX;
+                for (int x = 0; x < tileWidth; ++x) {
+                    const float objectMask = mask[y * TileSize + x];
+                    const float ndcDepth = depth[y * TileSize + x];
+                    depthRow[x] = objectMask > 0.0f ? 2.0f * n * f / (f + n - ndcDepth * (f - n)) : 0.0f;
+                    maskRow[x] = objectMask;
+                }
+            }
+        });
+    }
+    return targets;
+}
+
+void CpuRasterizer::render(const QVector<RenderJob> &jobs, const TargetsCallback &callback)
+{
+    for (int i = 0; i < jobs.size(); ++i)
+        callback(i, render(jobs.at(i)));
+}
@@ -0,0 +1,103 @@
+/****************************************************************************
+**
+** Copyright (C) 2016 The Qt Company Ltd.
+** Contact: https://www.qt.io/licensing/
+**
+** This file is part of the examples of the Qt Toolkit.
+**
+** $QT_BEGIN_LICENSE:BSD$
+** Commercial License Usage
+** Licensees holding valid commercial Qt licenses may use this file in
+** accordance with the commercial license agreement provided with the
+** Software or, alternatively, in accordance with the terms contained in
+** a written agreement between you and The Qt Company. For licensing terms
+** and conditions see https://www.qt.io/terms-conditions. For further
+** information use the contact form at https://www.qt.io/contact-us.
+**
+** BSD License Usage
+** Alternatively, you may use this file under the terms of the BSD license
+** as follows:
+**
+** "Redistribution and use in source and binary forms, with or without
+** modification, are permitted provided that the following conditions are
+** met:
+**   * Redistributions of source code must retain the above copyright
+**     notice, this list of conditions and the following disclaimer.
+**   * Redistributions in binary form must reproduce the above copyright
+**     notice, this list of conditions and the following disclaimer in
+**     the documentation and/or other materials provided with the
+**     distribution.
+**   * Neither the name of The Qt Company Ltd nor the names of its
+**     contributors may be used to endorse or promote products derived
+**     from this software without specific prior written permission.
+**
+**
+** THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+** "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+** LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+** A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+** OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+** SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+** LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+** DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+** THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+** (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+** OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE."
+**
+** $QT_END_LICENSE$
+**
+****************************************************************************/
+
+#ifndef CPURASTERIZER_H
+#define CPURASTERIZER_H
+
+#include "offscreenrenderer.h"
+
+#include <QThreadPool>
+#include <QVector>
+
+#include <functional>
+
+// Renders depth and instance mask of jobs on the CPU, for nodes without
+// usable OpenGL. Triangles go through the matrices of SceneRenderer, are
+// clipped, culled and snapped to 1/256 pixel like on the GPU, and binned
+// into screen tiles that the threads of a pool rasterize independently,
+// four pixels at a time with SSE2 where available. The targets match
+// OffscreenRenderer::renderTargets() with levels of detail disabled, up
+// to depth ties and rounding of the GL implementation.
+class CpuRasterizer
+{
+public:
+    typedef OffscreenRenderer::TargetsCallback TargetsCallback;
+
+    // A threadCount of 0 uses one thread per core.
+    explicit CpuRasterizer(const QSize &size, int threadCount = 0);
+    ~CpuRasterizer();
+
+    QSize size() const { return m_size; }
+    void setObjectModel(const ObjectModelRenerable &objectModel);
+    // Copies the positions and the finest level of the model, returns the
+    // id jobs refer to in their SceneObjects. Ids match the ones of an
+    // OffscreenRenderer the same models were added to.
+    int addObjectModel(const ObjectModelRenerable &objectModel);
+
+    // Only depth and mask of the targets are filled.
+    RenderTargets render(const RenderJob &job);
+    void render(const QVector<RenderJob> &jobs, const TargetsCallback &callback);
+
+private:
+    struct Model
+    {
+        QVector<float> positions;
+        QVector<quint32> indices;
+    };
+
+    void parallelFor(int count, const std::function<void(int)> &body);
+
+    QSize m_size;
+    QVector<Model> m_models;
+    QVector<SceneObject> m_defaultObjects;
+    QThreadPool m_pool;
+};
+
+#endif // CPURASTERIZER_H
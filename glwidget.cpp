@@ -49,66 +49,56 @@
 ****************************************************************************/
 
 #include "glwidget.h"
-#include <QOpenGLShaderProgram>
-#include <QOpenGLTexture>
+#include "modelloader.h"
+#include <QOpenGLContext>
+#include <QOpenGLFramebufferObject>
 #include <QMouseEvent>
-
-#define PROGRAM_VERTEX_ATTRIBUTE 0
-#define PROGRAM_TEXCOORD_ATTRIBUTE 1
+#include <qmath.h>
 
 GLWidget::GLWidget(QWidget *parent)
     : QOpenGLWidget(parent),
-      clearColor(Qt::black),
-      xRot(0),
-      yRot(0),
-      zRot(0),
-      backgroundProgram(0),
-      m_objectModelNormalVbo(QOpenGLBuffer::VertexBuffer),
-      m_objectModelVertexVbo(QOpenGLBuffer::VertexBuffer),
-      m_objectModelIndexVbo(QOpenGLBuffer::IndexBuffer)
+      clearColor(Qt::black)
 {
+    connect(this, &QOpenGLWidget::frameSwapped, this, &GLWidget::frameSwapped);
 }
 
 GLWidget::~GLWidget()
 {
-    makeCurrent();
-    backgroundVbo.destroy();
-    delete backgroundTexture;
-    delete backgroundProgram;
-    doneCurrent();
-}
-
-static void qNormalizeAngle(int &angle)
-{
-    while (angle < 0)
-        angle += 360 * 16;
-    while (angle > 360 * 16)
-        angle -= 360 * 16;
+    cleanup();
 }
 
-void GLWidget::setXRotation(int angle)
+void GLWidget::cleanup()
 {
-    qNormalizeAngle(angle);
-    if (angle != xRot) {
-        xRot = angle;
-        update();
-    }
+    delete m_modelLoader;
+    m_modelLoader = nullptr;
+    if (!context())
+        return;
+    makeCurrent();
+    m_readbackRing.flush();
+    m_readbackRing.destroy();
+    delete m_sceneFbo;
+    m_sceneFbo = nullptr;
+    m_fxaa.destroy();
+    m_renderer.cleanup();
+    doneCurrent();
 }
 
-void GLWidget::setYRotation(int angle)
+// Paints at most once per swap, i.e. per display refresh with vsync, and
+// only when something changed. On slow links every extra repaint queues
+// up behind the one still on its way to the screen.
+void GLWidget::requestFrame()
 {
-    qNormalizeAngle(angle);
-    if (angle != yRot) {
-        yRot = angle;
+    if (m_frameInFlight)
+        m_frameRequested = true;
+    else
         update();
-    }
 }
 
-void GLWidget::setZRotation(int angle)
+void GLWidget::frameSwapped()
 {
-    qNormalizeAngle(angle);
-    if (angle != zRot) {
-        zRot = angle;
+    m_frameInFlight = false;
+    if (m_frameRequested) {
+        m_frameRequested = false;
         update();
     }
 }
@@ -125,292 +115,263 @@ QSize GLWidget::sizeHint() const
 
 void GLWidget::rotateBy(int xAngle, int yAngle, int zAngle)
 {
-    xRot += xAngle;
-    yRot += yAngle;
-    zRot += zAngle;
-    update();
+    rotateInCameraSpace(QQuaternion::fromAxisAndAngle(1.0f, 0.0f, 0.0f, xAngle / 16.0f)
+                        * QQuaternion::fromAxisAndAngle(0.0f, 1.0f, 0.0f, yAngle / 16.0f)
+                        * QQuaternion::fromAxisAndAngle(0.0f, 0.0f, 1.0f, zAngle / 16.0f));
+    updateObjectRotation();
+    requestFrame();
+}
+
+// The pose maps the object into the camera, so a rotation about camera
+// axes becomes pose^-1 * rotation * pose in model space. The object turns
+// about its own origin.
+void GLWidget::rotateInCameraSpace(const QQuaternion &rotation)
+{
+    m_objectRotation = (m_poseRotation.conjugated() * rotation * m_poseRotation * m_objectRotation).normalized();
+}
+
+void GLWidget::updateObjectRotation()
+{
+    QMatrix4x4 modelMatrix;
+    modelMatrix.rotate(m_objectRotation);
+    QVector<SceneObject> objects = m_renderer.sceneObjects();
+    for (SceneObject &object : objects)
+        object.modelMatrix = modelMatrix;
+    m_renderer.setSceneObjects(objects);
 }
 
 void GLWidget::setClearColor(const QColor &color)
 {
     clearColor = color;
-    update();
+    m_renderer.setClearColor(color);
+    requestFrame();
 }
 
-const char *vertexShaderBackgroundSource =
-        "attribute highp vec4 vertex;\n"
-        "attribute mediump vec4 texCoord;\n"
-        "varying mediump vec4 texc;\n"
-        "uniform mediump mat4 matrix;\n"
-        "void main(void)\n"
-        "{\n"
-        "    gl_Position = matrix * vertex;\n"
-        "    texc = texCoord;\n"
-        "}\n";
-
-const char *fragmentShaderBackgroundSource =
-        "uniform sampler2D texture;\n"
-        "varying mediump vec4 texc;\n"
-        "void main(void)\n"
-        "{\n"
-        "    gl_FragColor = texture2D(texture, texc.st);\n"
-        "}\n";
-
-static const char *vertexShaderObjectSource =
-        "attribute vec4 vertex;\n"
-        "attribute vec3 normal;\n"
-        "varying vec3 vert;\n"
-        "varying vec3 vertNormal;\n"
-        "uniform mat4 projectionMatrix;\n"
-        "uniform mat3 normalMatrix;\n"
-        "void main() {\n"
-        "   vert = vertex.xyz;\n"
-        "   vertNormal = normalMatrix * normal;\n"
-        "   gl_Position = projectionMatrix * vertex;\n"
-        "}\n";
-
-static const char *fragmentShaderObjectSource =
-        "varying highp vec3 vert;\n"
-        "varying highp vec3 vertNormal;\n"
-        "uniform highp vec3 lightPos;\n"
-        "void main() {\n"
-        "   highp vec3 L = normalize(lightPos - vert);\n"
-        "   highp float NL = max(dot(normalize(vertNormal), L), 0.0);\n"
-        "   highp vec3 color = vec3(0.39, 1.0, 0.0);\n"
-        "   highp vec3 col = clamp(color * 0.2 + color * 0.8 * NL, 0.0, 1.0);\n"
-        "   gl_FragColor = vec4(col, 0.5);\n"
-        "}\n";
-
 void GLWidget::initializeGL()
 {
-    initializeOpenGLFunctions();
-
-    glEnable(GL_DEPTH_TEST);
-    glEnable(GL_CULL_FACE);
-
-    makeBackgroundObject();
-    initializeBackgroundProgram();
-    setupBackgroundVertexBuffers();
-
-    initializeObjectProgram();
-    setupObjectVertexBuffer();
+    // The context is destroyed before the widget when the widget gets
+    // reparented or the application quits, release our resources then.
+    connect(context(), &QOpenGLContext::aboutToBeDestroyed, this, &GLWidget::cleanup);
+
+    m_renderer.initialize();
+    m_renderer.setClearColor(clearColor);
+    // Models the loader could not upload itself stream in over frames.
+    m_renderer.setProgressiveUpload(16 * 1024 * 1024);
+    m_fxaa.create();
+    m_renderer.setBackgroundImage(QImage(QUrl::fromLocalFile("/home/floretti/git/flowerpower_nn/data/assets/tless/train_canon/01/generated/images/1002.jpg").path()));
+
+    // The model arrives asynchronously, the background shows until then.
+    m_modelLoader = new ModelLoader(context(), VertexFormat::Float32, this);
+    connect(m_modelLoader, &ModelLoader::modelLoaded, this, &GLWidget::addLoadedModel);
+    m_modelLoader->load("/home/floretti/git/flowerpower_nn/data/assets/tless/models_cad/obj_01.ply");
+
+    // Our camera never changes in this example, dragging turns the object.
+    const QMatrix4x4 pose(0.99880781f,    0.04439075f, -0.02027142f,  -2.52484405f,
+                          -0.01520601f, 0.6778174f, 0.73507287f, 22.31654879f,
+                          0.04637038f,  -0.733889f,  0.67768545f,  600.30748785f,
+                          0.f,                             0.f,               0.f,              1.f);
+    m_renderer.setPose(pose);
+    m_poseRotation = QQuaternion::fromRotationMatrix(pose.toGenericMatrix<3, 3>());
+    CameraIntrinsics intrinsics;
+    intrinsics.fx = 4781.91740099f;
+    intrinsics.fy = 4778.72123643f;
+    intrinsics.cx = 159.66974846999994f;
+    intrinsics.cy = 29.862207509999962f;
+    m_renderer.setIntrinsics(intrinsics);
 }
 
-void GLWidget::initializeBackgroundProgram()
+void GLWidget::addLoadedModel(int ticket)
 {
-    QOpenGLShader *vshader = new QOpenGLShader(QOpenGLShader::Vertex, this);
-    vshader->compileSourceCode(vertexShaderBackgroundSource);
-
-    QOpenGLShader *fshader = new QOpenGLShader(QOpenGLShader::Fragment, this);
-    fshader->compileSourceCode(fragmentShaderBackgroundSource);
-
-    backgroundProgram = new QOpenGLShaderProgram;
-    backgroundProgram->addShader(vshader);
-    backgroundProgram->addShader(fshader);
-    backgroundProgram->bindAttributeLocation("vertex", PROGRAM_VERTEX_ATTRIBUTE);
-    backgroundProgram->bindAttributeLocation("texCoord", PROGRAM_TEXCOORD_ATTRIBUTE);
-    backgroundProgram->link();
-
-    backgroundProgram->bind();
-    backgroundProgram->setUniformValue("texture", 0);
-    backgroundProgram->release();
+    const QSharedPointer<LoadedModel> model = m_modelLoader->takeModel(ticket);
+    if (!model)
+        return;
+    makeCurrent();
+    SceneObject object;
+    object.modelId = m_renderer.addLoadedModel(*model);
+    doneCurrent();
+    if (object.modelId < 0)
+        return;
+    object.modelMatrix.rotate(m_objectRotation);
+    m_renderer.setSceneObjects(QVector<SceneObject>(m_renderer.sceneObjects()) << object);
+    requestFrame();
 }
 
-void GLWidget::setupBackgroundVertexBuffers()
+void GLWidget::setFrameConsumer(const PixelReadbackRing::Consumer &consumer)
 {
-    backgroundProgram->bind();
-    backgroundVao.create();
-    QOpenGLVertexArrayObject::Binder vaoBinder(&backgroundVao);
-
-    // Setup our vertex buffer object.
-    backgroundVbo.create();
-    backgroundVbo.bind();
-    backgroundVbo.allocate(backgroundVertexData.constData(), backgroundVertexData.count() * sizeof(GLfloat));
-
-    backgroundVbo.bind();
-    QOpenGLFunctions *f = QOpenGLContext::currentContext()->functions();
-    f->glEnableVertexAttribArray(0);
-    f->glEnableVertexAttribArray(1);
-    f->glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 5 * sizeof(GLfloat), 0);
-    f->glVertexAttribPointer(1, 2, GL_FLOAT, GL_FALSE, 5 * sizeof(GLfloat), reinterpret_cast<void *>(3 * sizeof(GLfloat)));
-    backgroundVbo.release();
-    backgroundProgram->release();
+    if (!consumer)
+        flushFrames();
+    m_frameConsumer = consumer;
+    m_readbackRing.setConsumer(consumer);
+    requestFrame();
 }
 
-void GLWidget::initializeObjectProgram() {
-    // Init objects shader program
-    m_objectsProgram = new QOpenGLShaderProgram;
-    m_objectsProgram->addShaderFromSourceCode(QOpenGLShader::Vertex, vertexShaderObjectSource);
-    m_objectsProgram->addShaderFromSourceCode(QOpenGLShader::Fragment, fragmentShaderObjectSource);
-    m_objectsProgram->bindAttributeLocation("vertex", 0);
-    m_objectsProgram->bindAttributeLocation("normal", 1);
-    m_objectsProgram->link();
-
-
-    QMatrix4x4 m_modelMatrix = QMatrix4x4();
-    m_modelMatrix.setToIdentity();
-
-    m_viewMatrix = QMatrix4x4(0.99880781f,    0.04439075f, -0.02027142f,  -2.52484405f,
-                           -0.01520601f, 0.6778174f, 0.73507287f, 22.31654879f,
-                           0.04637038f,  -0.733889f,  0.67768545f,  600.30748785f,
-                           0.f,                             0.f,               0.f,              1.f);
-    QMatrix4x4 yz_flip;
-    yz_flip.setToIdentity();
-    yz_flip(1, 1) = -1;
-    yz_flip(2, 2) = -1;
-    m_viewMatrix = yz_flip * m_viewMatrix;
-    m_viewMatrix = m_viewMatrix.transposed();
-
-    // Our camera never changes in this example.
-    float k00 = 4781.91740099;
-    float k01 = 0.00000000;
-    float k02 = 159.66974846999994;
-    float k11 = 4778.72123643;
-    float k12 = 29.862207509999962;
-    float w = (float) this->width();
-    float h = (float) this->height();
-    float nc = 100.f;
-    float fc = 1000.f;
-    float depth = (float) fc - nc;
-    float q = -(fc + nc) / depth;
-    float qn = -2 * (fc * nc) / depth;
-    m_projectionMatrix = QMatrix4x4(2 * k00 / w, -2 * k01 / w, (-2 * k02 + w) / w, 0,
-                                    0, 2 * k11 / h, (2 * k12 - h) / h, 0,
-                                    0,            0,                  q, qn,
-                                    0,            0,                 -1, 0);
-    m_projectionMatrix = m_projectionMatrix.transposed();
-    m_projectionMatrix = m_modelMatrix * m_viewMatrix * m_projectionMatrix;
-    m_projectionMatrix = m_projectionMatrix.transposed();
+void GLWidget::flushFrames()
+{
+    if (!m_readbackRing.isCreated())
+        return;
+    makeCurrent();
+    m_readbackRing.flush();
+    doneCurrent();
 }
 
-void GLWidget::setupObjectVertexBuffer()
+void GLWidget::setBackgroundSource(BackgroundImageSource *source)
 {
-    // Create a vertex array object. In OpenGL ES 2.0 and OpenGL 2.x
-    // implementations this is optional and support may not be present
-    // at all. Nonetheless the below code works in all cases and makes
-    // sure there is a VAO when one is needed.
-    m_objectVao.create();
-    QOpenGLVertexArrayObject::Binder vaoBinder(&m_objectVao);
-    QOpenGLFunctions *f = QOpenGLContext::currentContext()->functions();
-
-    // Setup the vertex buffer object.
-    m_objectModelVertexVbo.create();
-    m_objectModelVertexVbo.bind();
-    m_objectModelVertexVbo.setUsagePattern(QOpenGLBuffer::StaticDraw);
-    m_objectModelVertexVbo.allocate(objectModel.getVertices().constData(), objectModel.verticesCount() * sizeof(GLfloat));
-    m_objectModelVertexVbo.bind();
-    f->glEnableVertexAttribArray(0);
-    f->glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 3 * sizeof(GLfloat), 0);
-
-    // Setup the normal buffer object.
-    m_objectModelNormalVbo.create();
-    m_objectModelNormalVbo.bind();
-    m_objectModelNormalVbo.setUsagePattern(QOpenGLBuffer::StaticDraw);
-    m_objectModelNormalVbo.allocate(objectModel.getNormals().constData(), objectModel.normalsCount() * sizeof(GLfloat));
-    m_objectModelNormalVbo.bind();
-    f->glEnableVertexAttribArray(1);
-    f->glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, 3 * sizeof(GLfloat), 0);
-
-    // Setup the index buffer object.
-    m_objectModelIndexVbo.create();
-    m_objectModelIndexVbo.bind();
-    m_objectModelIndexVbo.setUsagePattern(QOpenGLBuffer::StaticDraw);
-    m_objectModelIndexVbo.allocate(objectModel.getIndices().constData(), objectModel.indicesCount() * sizeof(GLint));
+    m_backgroundSource = source;
+    requestFrame();
 }
 
-void GLWidget::paintGL()
-{   
-    glClearColor(clearColor.redF(), clearColor.greenF(), clearColor.blueF(), clearColor.alphaF());
-    glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+void GLWidget::setInstanceGroups(const QVector<InstanceGroup> &groups)
+{
+    // Only copied here, the instance buffer is filled on the next paint.
+    m_renderer.setInstanceGroups(groups);
+    requestFrame();
+}
 
-    backgroundProgram->bind();
-    {
-        QMatrix4x4 m;
-        m.ortho(0, 1, 1, 0, 1.0f, 3.0f);
-        m.translate(0.0f, 0.0f, -2.0f);
+MemoryReport GLWidget::memoryReport() const
+{
+    MemoryReport report;
+    m_renderer.reportMemory(&report);
+    const QSize pixelSize = size() * devicePixelRatioF();
+    report.add("framebuffer", "widget", 0, MemoryReport::framebufferBytes(pixelSize, 8));
+    if (m_sceneFbo) {
+        report.add("framebuffer", "scene", 0,
+                   MemoryReport::framebufferBytes(m_sceneFbo->size(), 8, m_sceneFbo->format().samples()));
+    }
+    report.add("readback", "pixel buffer ring", 0, m_readbackRing.gpuBytes());
+    return report;
+}
 
-        QOpenGLVertexArrayObject::Binder vaoBinder(&backgroundVao);
+void GLWidget::setAntialiasing(AntialiasingMode mode)
+{
+    m_antialiasing = mode;
+    requestFrame();
+}
 
-        backgroundProgram->setUniformValue("matrix", m);
-        backgroundTexture->bind();
-        glDrawArrays(GL_TRIANGLE_FAN, 0, 4);
+void GLWidget::bindSceneFbo()
+{
+    const QSize pixelSize = size() * devicePixelRatioF();
+    const int samples = antialiasingSamples(m_antialiasing);
+    if (!m_sceneFbo || m_sceneFbo->size() != pixelSize || m_sceneFbo->format().samples() != samples) {
+        delete m_sceneFbo;
+        QOpenGLFramebufferObjectFormat fboFormat;
+        fboFormat.setAttachment(QOpenGLFramebufferObject::CombinedDepthStencil);
+        fboFormat.setSamples(samples);
+        m_sceneFbo = new QOpenGLFramebufferObject(pixelSize, fboFormat);
     }
-    backgroundProgram->release();
+    m_sceneFbo->bind();
+}
 
-    glClear(GL_DEPTH_BUFFER_BIT);
-    glEnable(GL_BLEND);
-    glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+void GLWidget::presentSceneFbo()
+{
+    if (m_antialiasing == AntialiasingMode::Fxaa) {
+        QOpenGLFramebufferObject::bindDefault();
+        m_fxaa.draw(m_sceneFbo->texture(), m_sceneFbo->size());
+    } else {
+        // A null target is the framebuffer of the widget.
+        QOpenGLFramebufferObject::blitFramebuffer(nullptr, m_sceneFbo);
+        QOpenGLFramebufferObject::bindDefault();
+    }
+}
 
-    m_objectsProgram->bind();
-    {
-        m_projectionMatrixLoc = m_objectsProgram->uniformLocation("projectionMatrix");
-        m_normalMatrixLoc = m_objectsProgram->uniformLocation("normalMatrix");
-        m_lightPosLoc = m_objectsProgram->uniformLocation("lightPos");
+void GLWidget::paintGL()
+{
+    // Set before anything below requests the next frame, which then waits
+    // for frameSwapped() instead of calling update() from in here.
+    m_frameInFlight = true;
+    if (m_backgroundSource) {
+        // Never wait for a decode here, keep the last frame until the
+        // next one is ready.
+        QImage image;
+        if (m_backgroundSource->tryNext(&image))
+            m_renderer.setPreparedBackgroundImage(image);
+        if (!m_backgroundSource->atEnd())
+            requestFrame();
+    }
 
-        QOpenGLVertexArrayObject::Binder vaoBinder(&m_objectVao);
+    // Whatever the pointer did since the last frame goes in as one step,
+    // sampled as late as possible.
+    applyPendingDrag();
+    if (m_antialiasing != AntialiasingMode::None) {
+        bindSceneFbo();
+        m_renderer.render(size());
+        presentSceneFbo();
+    } else {
+        delete m_sceneFbo;
+        m_sceneFbo = nullptr;
+        m_renderer.render(size());
+    }
+    if (m_renderer.hasPendingUploads())
+        requestFrame();
+    if (m_frameConsumer)
+        readbackFrame();
+}
 
-        // Light position is fixed.
-        m_objectsProgram->setUniformValue(m_lightPosLoc, QVector3D(0, 0, 70));
+void GLWidget::readbackFrame()
+{
+    const QSize pixelSize = size() * devicePixelRatioF();
+    if (m_readbackRing.size() != pixelSize) {
+        m_readbackRing.flush();
+        m_readbackRing.create(pixelSize);
+        m_readbackRing.setMirrored(true);
+    }
+    m_readbackRing.poll();
 
-        m_objectsProgram->setUniformValue(m_projectionMatrixLoc, m_projectionMatrix);
-        QMatrix3x3 normalMatrix = m_viewMatrix.normalMatrix();
-        m_objectsProgram->setUniformValue(m_normalMatrixLoc, normalMatrix);
+    // The framebuffer of the widget is single sampled, multisampling
+    // happens in m_sceneFbo and is resolved by presentSceneFbo().
+    m_readbackRing.readPixels(m_frameCount++);
+}
 
-        glDrawElements(GL_TRIANGLES, objectModel.indicesCount(), GL_UNSIGNED_INT, 0);
-    }
-    m_objectsProgram->release();
+void GLWidget::resizeGL(int /* width */, int /* height */)
+{
+    // QOpenGLWidget sets up the viewport for us and the projection is
+    // derived from the widget size on every frame.
 }
-void GLWidget::resizeGL(int width, int height)
+
+// Shoemake's arcball: the widget shows a unit sphere around its center,
+// in camera coordinates (x right, y down, the front half towards -z).
+// Points outside of it map onto its silhouette.
+QVector3D GLWidget::trackballPoint(const QPoint &pos) const
 {
-    m_proj.setToIdentity();
-    // We don't allow the user to resize the window
-    //m_proj.perspective(45.0f, GLfloat(width) / height, 0.01f, 1000.0f);
-    glViewport(0, 0, width, height);
+    const float radius = qMax(1, qMin(width(), height())) / 2.0f;
+    QVector3D point((pos.x() - width() / 2.0f) / radius, (pos.y() - height() / 2.0f) / radius, 0.0f);
+    const float lengthSquared = point.lengthSquared();
+    if (lengthSquared > 1.0f)
+        point /= qSqrt(lengthSquared);
+    else
+        point.setZ(-qSqrt(1.0f - lengthSquared));
+    return point;
 }
 
-void GLWidget::mousePressEvent(QMouseEvent *event)
+void GLWidget::applyPendingDrag()
 {
-    lastPos = event->pos();
+    if (dragPos == lastPos)
+        return;
+    rotateInCameraSpace(QQuaternion::rotationTo(trackballPoint(lastPos), trackballPoint(dragPos)));
+    lastPos = dragPos;
+    updateObjectRotation();
 }
 
-void GLWidget::mouseMoveEvent(QMouseEvent *event)
+void GLWidget::mousePressEvent(QMouseEvent *event)
 {
-    int dx = event->x() - lastPos.x();
-    int dy = event->y() - lastPos.y();
-
-    if (event->buttons() & Qt::LeftButton) {
-        setXRotation(xRot + 8 * dy);
-        setYRotation(yRot + 8 * dx);
-    } else if (event->buttons() & Qt::RightButton) {
-        setXRotation(xRot + 8 * dy);
-        setZRotation(zRot + 8 * dx);
-    }
-    lastPos = event->pos();
+    lastPos = dragPos = event->pos();
+    dragging = event->button() == Qt::LeftButton;
 }
 
-void GLWidget::mouseReleaseEvent(QMouseEvent * /* event */)
+void GLWidget::mouseMoveEvent(QMouseEvent *event)
 {
-    emit clicked();
+    if (!dragging)
+        return;
+    dragPos = event->pos();
+    requestFrame();
 }
 
-void GLWidget::makeBackgroundObject()
+void GLWidget::mouseReleaseEvent(QMouseEvent *event)
 {
-    static const int coords[4][3] = {
-         { +1, 0, 0 }, { 0, 0, 0 }, { 0, +1, 0 }, { +1, +1, 0 }
-    };
-
-    QImage textureImage = QImage(QUrl::fromLocalFile("/home/floretti/git/flowerpower_nn/data/assets/tless/train_canon/01/generated/images/1002.jpg").path()).mirrored();
-    backgroundTexture = new QOpenGLTexture(textureImage);
-    backgroundTexture->setMagnificationFilter(QOpenGLTexture::Nearest);
-    backgroundTexture->setMinificationFilter(QOpenGLTexture::Nearest);
-
-    for (int i = 0; i < 4; ++i) {
-        // vertex position
-        backgroundVertexData.append(coords[i][0]);
-        backgroundVertexData.append(coords[i][1]);
-        backgroundVertexData.append(coords[i][2]);
-        // texture coordinate
-        backgroundVertexData.append(i == 0 || i == 3);
-        backgroundVertexData.append(i == 0 || i == 1);
+    // The last stretch of the drag is still applied by the next frame.
+    if (dragging) {
+        dragPos = event->pos();
+        requestFrame();
+        dragging = false;
     }
+    emit clicked();
 }
@@ -51,18 +51,18 @@
 #ifndef GLWIDGET_H
 #define GLWIDGET_H
 
-#include "objectmodelrenderable.h"
+#include "scenerenderer.h"
+#include "antialiasing.h"
+#include "pixelreadbackring.h"
+#include "backgroundimagesource.h"
 
 #include <QOpenGLWidget>
-#include <QOpenGLFunctions>
-#include <QOpenGLVertexArrayObject>
-#include <QOpenGLBuffer>
-#include <QMatrix4x4>
+#include <QQuaternion>
 
-QT_FORWARD_DECLARE_CLASS(QOpenGLShaderProgram)
-QT_FORWARD_DECLARE_CLASS(QOpenGLTexture)
+QT_FORWARD_DECLARE_CLASS(QOpenGLFramebufferObject)
+class ModelLoader;
 
-class GLWidget : public QOpenGLWidget, protected QOpenGLFunctions
+class GLWidget : public QOpenGLWidget
 {
     Q_OBJECT
 
@@ -72,8 +72,23 @@ public:
 
     QSize minimumSizeHint() const override;
     QSize sizeHint() const override;
+    // Rotates the object about the camera axes, in 1/16 degrees.
     void rotateBy(int xAngle, int yAngle, int zAngle);
     void setClearColor(const QColor &color);
+    // Every painted frame is read back asynchronously and handed to
+    // consumer a few frames later. Pass an empty consumer to stop.
+    void setFrameConsumer(const PixelReadbackRing::Consumer &consumer);
+    void flushFrames();
+    // Shows the frames of source one after another, as fast as they are
+    // decoded and painted. The source is not owned by the widget.
+    void setBackgroundSource(BackgroundImageSource *source);
+    // Pose hypotheses drawn on top of the object, see SceneRenderer.
+    void setInstanceGroups(const QVector<InstanceGroup> &groups);
+    // Takes effect with the next frame, MSAA 4x by default.
+    void setAntialiasing(AntialiasingMode mode);
+    AntialiasingMode antialiasing() const { return m_antialiasing; }
+    // Renderer resources, the widget framebuffer and our own ones.
+    MemoryReport memoryReport() const;
 
 signals:
     void clicked();
@@ -87,45 +102,42 @@ protected:
     void mouseReleaseEvent(QMouseEvent *event) override;
 
 private:
-
-    void setXRotation(int angle);
-    void setYRotation(int angle);
-    void setZRotation(int angle);
-
-    void initializeBackgroundProgram();
-    void setupBackgroundVertexBuffers();
-    void makeBackgroundObject();
-    void setupObjectVertexBuffer();
-    void initializeObjectProgram();
+    void rotateInCameraSpace(const QQuaternion &rotation);
+    QVector3D trackballPoint(const QPoint &pos) const;
+    void applyPendingDrag();
+    void updateObjectRotation();
+    void requestFrame();
+    void frameSwapped();
+    void cleanup();
+    void readbackFrame();
+    void bindSceneFbo();
+    void presentSceneFbo();
+    void addLoadedModel(int ticket);
 
     QColor clearColor;
+    // Mouse moves only update dragPos, the drag is applied once per
+    // frame when painting starts.
     QPoint lastPos;
-    int xRot;
-    int yRot;
-    int zRot;
-
-    // Background stuff
-    QOpenGLTexture *backgroundTexture = 0;
-    QOpenGLShaderProgram *backgroundProgram;
-    QOpenGLVertexArrayObject backgroundVao;
-    QOpenGLBuffer backgroundVbo;
-    QVector<GLfloat> backgroundVertexData;
-    QMatrix4x4 orthoMatrix;
-
-    ObjectModelRenerable objectModel = ObjectModelRenerable("/home/floretti/git/flowerpower_nn/data/assets/tless/models_cad/obj_01.ply");
-    QOpenGLVertexArrayObject m_objectVao;
-    QOpenGLBuffer m_objectModelVertexVbo;
-    QOpenGLBuffer m_objectModelNormalVbo;
-    QOpenGLBuffer m_objectModelIndexVbo;
-    QOpenGLShaderProgram *m_objectsProgram;
-    int m_projectionMatrixLoc;
-    int m_viewMatrixLoc;
-    int m_modelMatrixLoc;
-    int m_normalMatrixLoc;
-    int m_lightPosLoc;
-    QMatrix4x4 m_proj;
-    QMatrix4x4 m_projectionMatrix;
-    QMatrix4x4 m_viewMatrix;
+    QPoint dragPos;
+    bool dragging = false;
+    QQuaternion m_objectRotation;
+    QQuaternion m_poseRotation;
+    // At most one frame is in flight, requests made meanwhile are
+    // merged and painted after it was swapped.
+    bool m_frameInFlight = false;
+    bool m_frameRequested = false;
+
+    SceneRenderer m_renderer;
+    ModelLoader *m_modelLoader = nullptr;
+    PixelReadbackRing m_readbackRing;
+    PixelReadbackRing::Consumer m_frameConsumer;
+    // The scene is drawn in here when antialiasing, and resolved into the
+    // framebuffer of the widget when the frame is presented.
+    AntialiasingMode m_antialiasing = AntialiasingMode::Msaa4;
+    QOpenGLFramebufferObject *m_sceneFbo = nullptr;
+    FxaaPass m_fxaa;
+    BackgroundImageSource *m_backgroundSource = nullptr;
+    int m_frameCount = 0;
 };
 
 #endif
@@ -49,18 +49,345 @@
 ****************************************************************************/
 
 #include <QApplication>
+#include <QGuiApplication>
+#include <QCommandLineParser>
+#include <QDir>
+#include <QFile>
 #include <QSurfaceFormat>
+#include <QRunnable>
+#include <QTextStream>
+#include <QThreadPool>
+#include <QDebug>
 
+#include "offscreenrenderer.h"
+#include "cpurasterizer.h"
+#include "rendererpool.h"
+#include "poseevaluator.h"
+#include "tiledimagewriter.h"
+#include "profiler.h"
 #include "window.h"
 
+// R(3x3, row-major) t(3) starting at fields[first], as in BOP.
+static QMatrix4x4 poseFromFields(const QStringList &fields, int first)
+{
+    float values[12];
+    for (int i = 0; i < 12; ++i)
+        values[i] = fields.at(first + i).toFloat();
+    return QMatrix4x4(values[0], values[1], values[2], values[9],
+                      values[3], values[4], values[5], values[10],
+                      values[6], values[7], values[8], values[11],
+                      0.f,       0.f,       0.f,       1.f);
+}
+
+static CameraIntrinsics intrinsicsFromFields(const QStringList &fields, int first)
+{
+    CameraIntrinsics intrinsics;
+    intrinsics.fx = fields.at(first).toFloat();
+    intrinsics.fy = fields.at(first + 1).toFloat();
+    intrinsics.cx = fields.at(first + 2).toFloat();
+    intrinsics.cy = fields.at(first + 3).toFloat();
+    return intrinsics;
+}
+
+// Every line of a job file holds one composite in BOP order:
+// background R(3x3, row-major) t(3) fx fy cx cy
+static bool readJobs(const QString &fileName, QVector<RenderJob> *jobs)
+{
+    QFile file(fileName);
+    if (!file.open(QIODevice::ReadOnly | QIODevice::Text))
+        return false;
+
+    QTextStream in(&file);
+    while (!in.atEnd()) {
+        const QStringList fields = in.readLine().simplified().split(' ', QString::SkipEmptyParts);
+        if (fields.isEmpty() || fields.first().startsWith('#'))
+            continue;
+        if (fields.size() != 17) {
+            qWarning() << "Skipping malformed job line" << fields.join(' ');
+            continue;
+        }
+
+        RenderJob job;
+        job.backgroundFile = fields.first();
+        job.pose = poseFromFields(fields, 1);
+        job.intrinsics = intrinsicsFromFields(fields, 13);
+        jobs->append(job);
+    }
+    return true;
+}
+
+// Every line of a hypothesis file holds the ground truth and the estimated
+// pose of the model, then the camera: R(3x3) t(3) R(3x3) t(3) fx fy cx cy
+static bool readHypotheses(const QString &fileName, QVector<PoseHypothesis> *hypotheses)
+{
+    QFile file(fileName);
+    if (!file.open(QIODevice::ReadOnly | QIODevice::Text))
+        return false;
+
+    QTextStream in(&file);
+    while (!in.atEnd()) {
+        const QStringList fields = in.readLine().simplified().split(' ', QString::SkipEmptyParts);
+        if (fields.isEmpty() || fields.first().startsWith('#'))
+            continue;
+        if (fields.size() != 28) {
+            qWarning() << "Skipping malformed hypothesis line" << fields.join(' ');
+            continue;
+        }
+
+        PoseHypothesis hypothesis;
+        hypothesis.groundTruth = poseFromFields(fields, 0);
+        hypothesis.estimate = poseFromFields(fields, 12);
+        hypothesis.intrinsics = intrinsicsFromFields(fields, 24);
+        hypotheses->append(hypothesis);
+    }
+    return true;
+}
+
+// Encodes one composite on the thread pool, so PNG encoding keeps up with
+// a RendererPool.
+class SaveTask : public QRunnable
+{
+public:
+    SaveTask(const QImage &image, const QString &fileName) : m_image(image), m_fileName(fileName) {}
+
+    void run() override
+    {
+        ProfileScope profile("png encode");
+        m_image.save(m_fileName);
+    }
+
+private:
+    QImage m_image;
+    QString m_fileName;
+};
+
+// Writes the depth in model units (millimeters for BOP) as 16-bit and the
+// mask as 8-bit binary PGM.
+static bool writeTargets(const QString &baseName, const QSize &size, const RenderTargets &targets)
+{
+    QFile depthFile(baseName + "-depth.pgm");
+    QFile maskFile(baseName + "-mask.pgm");
+    if (!depthFile.open(QIODevice::WriteOnly) || !maskFile.open(QIODevice::WriteOnly)) {
+        qWarning() << "Could not write" << baseName;
+        return false;
+    }
+
+    const QByteArray dimensions = QByteArray::number(size.width()) + ' ' + QByteArray::number(size.height());
+    QByteArray depth = "P5\n" + dimensions + "\n65535\n";
+    for (float value : targets.depth) {
+        const int depthValue = qBound(0, qRound(value), 65535);
+        depth.append(char(depthValue >> 8)).append(char(depthValue & 0xff));
+    }
+    QByteArray mask = "P5\n" + dimensions + "\n255\n";
+    for (float value : targets.mask)
+        mask.append(char(qBound(0, qRound(value), 255)));
+    return depthFile.write(depth) == depth.size() && maskFile.write(mask) == mask.size();
+}
+
+static int runBatch(int argc, char *argv[])
+{
+    // Batch rendering never shows a window, a QGuiApplication is enough
+    // and lets us run with -platform offscreen on machines without display.
+    QGuiApplication app(argc, argv);
+
+    QCommandLineParser parser;
+    parser.setApplicationDescription("Renders composites of a model over background images without a window.");
+    parser.addHelpOption();
+    QCommandLineOption jobsOption("jobs", "Job file, one composite per line.", "file");
+    QCommandLineOption modelOption("model", "Object model to render.", "file");
+    QCommandLineOption outputOption("output", "Directory the composites are written to.", "directory", ".");
+    QCommandLineOption sizeOption("size", "Size of the composites.", "WxH", "274x451");
+    QCommandLineOption packedOption("packed-vertices", "Upload the model in the packed vertex format.");
+    QCommandLineOption rawIndicesOption("no-index-optimization", "Keep the triangle order of the model file.");
+    QCommandLineOption antialiasingOption("antialiasing", "none, msaa2, msaa4, msaa8 or fxaa.", "mode", "none");
+    QCommandLineOption threadsOption("threads", "Render threads, each with its own context, 0 for one per core.",
+                                     "count", "1");
+    QCommandLineOption tileOption("tile", "Render in tiles of this size and write PPM files, for sizes beyond "
+                                  "the GL limits. Uses a single thread.", "WxH");
+    QCommandLineOption cpuOption("cpu", "Rasterize only depth and mask on the CPU, without OpenGL, and write PGM "
+                                 "files. Uses --threads.");
+    QCommandLineOption profileOption("profile", "Write a Chrome trace of all stages and print their timings.", "file");
+    parser.addOption(jobsOption);
+    parser.addOption(modelOption);
+    parser.addOption(outputOption);
+    parser.addOption(sizeOption);
+    parser.addOption(packedOption);
+    parser.addOption(rawIndicesOption);
+    parser.addOption(antialiasingOption);
+    parser.addOption(threadsOption);
+    parser.addOption(tileOption);
+    parser.addOption(cpuOption);
+    parser.addOption(profileOption);
+    parser.process(app);
+
+    const QStringList size = parser.value(sizeOption).split('x');
+    const QStringList tile = parser.value(tileOption).split('x');
+    AntialiasingMode antialiasing;
+    bool threadsValid;
+    const int threads = parser.value(threadsOption).toInt(&threadsValid);
+    if (size.size() != 2 || !parser.isSet(modelOption)
+            || !parseAntialiasingMode(parser.value(antialiasingOption), &antialiasing)
+            || !threadsValid || threads < 0 || (parser.isSet(tileOption) && tile.size() != 2)) {
+        parser.showHelp(1);
+    }
+
+    if (parser.isSet(profileOption))
+        Profiler::instance()->setEnabled(true);
+
+    QVector<RenderJob> jobs;
+    if (!readJobs(parser.value(jobsOption), &jobs)) {
+        qWarning() << "Could not read job file" << parser.value(jobsOption);
+        return 1;
+    }
+
+    const QSize imageSize(size.at(0).toInt(), size.at(1).toInt());
+    const VertexFormat vertexFormat = parser.isSet(packedOption) ? VertexFormat::Packed : VertexFormat::Float32;
+    // Released once it is uploaded or copied, the batch only needs the
+    // renderer's copy of the mesh.
+    ObjectModelRenerable model(parser.value(modelOption), true, !parser.isSet(rawIndicesOption));
+
+    const QDir outputDir(parser.value(outputOption));
+    outputDir.mkpath(".");
+
+    MemoryReport memoryReport;
+    if (parser.isSet(cpuOption)) {
+        CpuRasterizer rasterizer(imageSize, threads);
+        rasterizer.setObjectModel(model);
+        model.releaseCpuData();
+        bool written = true;
+        rasterizer.render(jobs, [&](int jobIndex, const RenderTargets &targets) {
+            ProfileScope profile("pgm encode");
+            const QString baseName = outputDir.filePath(QString("%1").arg(jobIndex, 6, 10, QChar('0')));
+            written = writeTargets(baseName, imageSize, targets) && written;
+        });
+        if (!written)
+            return 1;
+    } else if (parser.isSet(tileOption)) {
+        OffscreenRenderer renderer(QSize(tile.at(0).toInt(), tile.at(1).toInt()), antialiasing);
+        if (!renderer.create())
+            return 1;
+        renderer.setClearColor(Qt::white);
+        renderer.setVertexFormat(vertexFormat);
+        renderer.setObjectModel(model);
+        model.releaseCpuData();
+        for (int i = 0; i < jobs.size(); ++i) {
+            TiledImageWriter writer;
+            if (!writer.open(outputDir.filePath(QString("%1.ppm").arg(i, 6, 10, QChar('0'))), imageSize))
+                return 1;
+            renderer.renderTiled(jobs.at(i), imageSize, [&writer](const QRect &tile, const QImage &image) {
+                writer.addTile(tile, image);
+            });
+            if (!writer.close())
+                return 1;
+        }
+        memoryReport = renderer.memoryReport();
+    } else if (threads == 1) {
+        OffscreenRenderer renderer(imageSize, antialiasing);
+        if (!renderer.create())
+            return 1;
+        renderer.setClearColor(Qt::white);
+        renderer.setReadbackMode(OffscreenRenderer::PixelBufferReadback);
+        renderer.setVertexFormat(vertexFormat);
+        renderer.setObjectModel(model);
+        model.releaseCpuData();
+        renderer.render(jobs, [&outputDir](int jobIndex, const QImage &image) {
+            ProfileScope profile("png encode");
+            image.save(outputDir.filePath(QString("%1.png").arg(jobIndex, 6, 10, QChar('0'))));
+        });
+        memoryReport = renderer.memoryReport();
+    } else {
+        RendererPool pool(imageSize, threads, antialiasing);
+        if (!pool.create())
+            return 1;
+        pool.setClearColor(Qt::white);
+        pool.setVertexFormat(vertexFormat);
+        pool.setObjectModel(model);
+        model.releaseCpuData();
+        pool.render(jobs, [&outputDir](int jobIndex, const QImage &image) {
+            const QString fileName = outputDir.filePath(QString("%1.png").arg(jobIndex, 6, 10, QChar('0')));
+            QThreadPool::globalInstance()->start(new SaveTask(image, fileName));
+        });
+        QThreadPool::globalInstance()->waitForDone();
+        memoryReport = pool.memoryReport();
+    }
+
+    if (parser.isSet(profileOption)) {
+        QTextStream(stdout) << Profiler::instance()->summary() << '\n' << memoryReport.summary();
+        if (!Profiler::instance()->writeTrace(parser.value(profileOption)))
+            return 1;
+    }
+    return 0;
+}
+
+static int runEvaluation(int argc, char *argv[])
+{
+    QGuiApplication app(argc, argv);
+
+    QCommandLineParser parser;
+    parser.setApplicationDescription("Compares estimated poses with the ground truth on the GPU.");
+    parser.addHelpOption();
+    QCommandLineOption evaluateOption("evaluate", "Hypothesis file, one pose pair per line.", "file");
+    QCommandLineOption modelOption("model", "Object model the poses refer to.", "file");
+    QCommandLineOption sizeOption("size", "Size of the camera images.", "WxH", "274x451");
+    QCommandLineOption profileOption("profile", "Write a Chrome trace of all stages and print their timings.", "file");
+    parser.addOption(evaluateOption);
+    parser.addOption(modelOption);
+    parser.addOption(sizeOption);
+    parser.addOption(profileOption);
+    parser.process(app);
+
+    const QStringList size = parser.value(sizeOption).split('x');
+    if (size.size() != 2 || !parser.isSet(modelOption))
+        parser.showHelp(1);
+
+    if (parser.isSet(profileOption))
+        Profiler::instance()->setEnabled(true);
+
+    QVector<PoseHypothesis> hypotheses;
+    if (!readHypotheses(parser.value(evaluateOption), &hypotheses)) {
+        qWarning() << "Could not read hypothesis file" << parser.value(evaluateOption);
+        return 1;
+    }
+
+    PoseEvaluator evaluator(QSize(size.at(0).toInt(), size.at(1).toInt()));
+    if (!evaluator.create())
+        return 1;
+    evaluator.addObjectModel(ObjectModelRenerable(parser.value(modelOption)));
+
+    // One line per hypothesis: mask IoU, VSD, mean and max projection
+    // error in pixels.
+    QTextStream out(stdout);
+    for (const PoseMetrics &metrics : evaluator.evaluate(hypotheses)) {
+        out << metrics.maskIou << ' ' << metrics.vsd << ' '
+            << metrics.meanProjectionError << ' ' << metrics.maxProjectionError << '\n';
+    }
+
+    if (parser.isSet(profileOption)) {
+        out << Profiler::instance()->summary();
+        if (!Profiler::instance()->writeTrace(parser.value(profileOption)))
+            return 1;
+    }
+    return 0;
+}
+
 int main(int argc, char *argv[])
 {
+    // Names the cache directories, e.g. the one of the MeshCache.
+    QCoreApplication::setApplicationName("textures");
+
+    for (int i = 1; i < argc; ++i) {
+        if (QByteArray(argv[i]).startsWith("--jobs"))
+            return runBatch(argc, argv);
+        if (QByteArray(argv[i]).startsWith("--evaluate"))
+            return runEvaluation(argc, argv);
+    }
 
     QApplication app(argc, argv);
 
+    // Single sampled, GLWidget antialiases in its own framebuffer objects
+    // and can switch modes at runtime.
     QSurfaceFormat format;
     format.setDepthBufferSize(24);
-    format.setSamples(8);
     QSurfaceFormat::setDefaultFormat(format);
 
     Window window;
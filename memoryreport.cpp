@@ -0,0 +1,102 @@
+/****************************************************************************
+**
+** Copyright (C) 2016 The Qt Company Ltd.
+** Contact: https://www.qt.io/licensing/
+**
+** This file is part of the examples of the Qt Toolkit.
+**
+** $QT_BEGIN_LICENSE:BSD$
+** Commercial License Usage
+** Licensees holding valid commercial Qt licenses may use this file in
+** accordance with the commercial license agreement provided with the
+** Software or, alternatively, in accordance with the terms contained in
+** a written agreement between you and The Qt Company. For licensing terms
+** and conditions see https://www.qt.io/terms-conditions. For further
+** information use the contact form at https://www.qt.io/contact-us.
+**
+** BSD License Usage
+** Alternatively, you may use this file under the terms of the BSD license
+** as follows:
+**
+** "Redistribution and use in source and binary forms, with or without
+** modification, are permitted provided that the following conditions are
+** met:
+**   * Redistributions of source code must retain the above copyright
+**     notice, this list of conditions and the following disclaimer.
+**   * Redistributions in binary form must reproduce the above copyright
+**     notice, this list of conditions and the following disclaimer in
+**     the documentation and/or other materials provided with the
+**     distribution.
+**   * Neither the name of The Qt Company Ltd nor the names of its
+**     contributors may be used to endorse or promote products derived
+**     from this software without specific prior written permission.
+**
+**
+** THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+** "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+** LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+** A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+** OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+** SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+** LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+** DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+** THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+** (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+** OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE."
+**
+** $QT_END_LICENSE$
+**
+****************************************************************************/
+
+#include "memoryreport.h"
+
+#include <QtGlobal>
+
+void MemoryReport::add(const QString &category, const QString &name, qint64 cpuBytes, qint64 gpuBytes)
+{
+    Entry entry;
+    entry.category = category;
+    entry.name = name;
+    entry.cpuBytes = cpuBytes;
+    entry.gpuBytes = gpuBytes;
+    m_entries.append(entry);
+}
+
+qint64 MemoryReport::totalCpuBytes() const
+{
+    qint64 bytes = 0;
+    for (const Entry &entry : m_entries)
+        bytes += entry.cpuBytes;
+    return bytes;
+}
+
+qint64 MemoryReport::totalGpuBytes() const
+{
+    qint64 bytes = 0;
+    for (const Entry &entry : m_entries)
+        bytes += entry.gpuBytes;
+    return bytes;
+}
+
+static double megabytes(qint64 bytes)
+{
+    return bytes / (1024.0 * 1024.0);
+}
+
+QString MemoryReport::summary() const
+{
+    QString text;
+    for (const Entry &entry : m_entries) {
+        text += QString::asprintf("%-20s %-24s cpu %10.2f MB  gpu %10.2f MB\n",
+                                  qPrintable(entry.category), qPrintable(entry.name),
+                                  megabytes(entry.cpuBytes), megabytes(entry.gpuBytes));
+    }
+    text += QString::asprintf("%-45s cpu %10.2f MB  gpu %10.2f MB\n", "total",
+                              megabytes(totalCpuBytes()), megabytes(totalGpuBytes()));
+    return text;
+}
+
+qint64 MemoryReport::framebufferBytes(const QSize &size, int bytesPerPixel, int samples)
+{
+    return qint64(size.width()) * size.height() * bytesPerPixel * qMax(1, samples);
+}
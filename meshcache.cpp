@@ -0,0 +1,176 @@
+/****************************************************************************
+**
+** Copyright (C) 2016 The Qt Company Ltd.
+** Contact: https://www.qt.io/licensing/
+**
+** This file is part of the examples of the Qt Toolkit.
+**
+** $QT_BEGIN_LICENSE:BSD$
+** Commercial License Usage
+** Licensees holding valid commercial Qt licenses may use this file in
+** accordance with the commercial license agreement provided with the
+** Software or, alternatively, in accordance with the terms contained in
+** a written agreement between you and The Qt Company. For licensing terms
+** and conditions see https://www.qt.io/terms-conditions. For further
+** information use the contact form at https://www.qt.io/contact-us.
+**
+** BSD License Usage
+** Alternatively, you may use this file under the terms of the BSD license
+** as follows:
+**
+** "Redistribution and use in source and binary forms, with or without
+** modification, are permitted provided that the following conditions are
+** met:
+**   * Redistributions of source code must retain the above copyright
+**     notice, this list of conditions and the following disclaimer.
+**   * Redistributions in binary form must reproduce the above copyright
+**     notice, this list of conditions and the following disclaimer in
+**     the documentation and/or other materials provided with the
+**     distribution.
+**   * Neither the name of The Qt Company Ltd nor the names of its
+**     contributors may be used to endorse or promote products derived
+**     from this software without specific prior written permission.
+**
+**
+** THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+** "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+** LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+** A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+** OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+** SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+** LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+** DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+** THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+** (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+** OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE."
+**
+** $QT_END_LICENSE$
+**
+****************************************************************************/
+
+#include "meshcache.h"
+
+#include <QCryptographicHash>
+#include <QDir>
+#include <QFile>
+#include <QSaveFile>
+#include <QStandardPaths>
+#include <cstring>
+
+// Bump whenever the layout below or the processing of meshes changes.
+static const quint32 MeshCacheVersion = 3;
+
+struct MeshCacheHeader
+{
+    char magic[8];
+    quint32 version;
+    quint32 vertexCount;
+    quint32 normalCount;
+    quint32 indexCount;
+    char key[20];
+    quint32 subMeshCount;
+    quint32 levelCount;
+};
+
+static const char MeshCacheMagic[8] = { 'Q', 'O', 'W', 'B', 'M', 'E', 'S', 'H' };
+
+static qint64 dataSize(const MeshCacheHeader &header)
+{
+    return qint64(header.vertexCount) * 3 * sizeof(GLfloat)
+            + qint64(header.normalCount) * 3 * sizeof(GLfloat)
+            + qint64(header.indexCount) * sizeof(GLuint)
+            + qint64(header.subMeshCount) * sizeof(SubMesh);
+}
+
+QString MeshCache::cacheDirectory()
+{
+    return QStandardPaths::writableLocation(QStandardPaths::CacheLocation) + QStringLiteral("/meshes");
+}
+
+QByteArray MeshCache::key(const QString &sourceFile, quint32 importFlags, bool optimized)
+{
+    QFile file(sourceFile);
+    if (!file.open(QIODevice::ReadOnly))
+        return QByteArray();
+
+    QCryptographicHash hash(QCryptographicHash::Sha1);
+    if (!hash.addData(&file))
+        return QByteArray();
+    hash.addData(reinterpret_cast<const char *>(&importFlags), sizeof(importFlags));
+    hash.addData(optimized ? "optimized" : "as imported");
+    hash.addData(reinterpret_cast<const char *>(&MeshCacheVersion), sizeof(MeshCacheVersion));
+    return hash.result();
+}
+
+MeshCacheMapping MeshCache::map(const QByteArray &key)
+{
+    MeshCacheMapping mapping;
+    if (key.size() != int(sizeof(MeshCacheHeader::key)))
+        return mapping;
+
+    QSharedPointer<QFile> file(new QFile(QDir(cacheDirectory()).filePath(QString::fromLatin1(key.toHex()))));
+    if (!file->open(QIODevice::ReadOnly) || file->size() < qint64(sizeof(MeshCacheHeader)))
+        return mapping;
+
+    const uchar *data = file->map(0, file->size());
+    if (!data)
+        return mapping;
+
+    MeshCacheHeader header;
+    std::memcpy(&header, data, sizeof(header));
+    if (std::memcmp(header.magic, MeshCacheMagic, sizeof(MeshCacheMagic)) != 0
+            || header.version != MeshCacheVersion
+            || std::memcmp(header.key, key.constData(), sizeof(header.key)) != 0
+            || (header.normalCount != 0 && header.normalCount != header.vertexCount)
+            || header.levelCount == 0 || header.subMeshCount % header.levelCount != 0
+            || qint64(sizeof(header)) + dataSize(header) != file->size()) {
+        return mapping;
+    }
+
+    const uchar *vertices = data + sizeof(header);
+    const uchar *normals = vertices + header.vertexCount * 3 * sizeof(GLfloat);
+    const uchar *indices = normals + header.normalCount * 3 * sizeof(GLfloat);
+    const uchar *subMeshes = indices + header.indexCount * sizeof(GLuint);
+    mapping.file = file;
+    mapping.vertices = reinterpret_cast<const GLfloat *>(vertices);
+    mapping.normals = header.normalCount ? reinterpret_cast<const GLfloat *>(normals) : nullptr;
+    mapping.indices = reinterpret_cast<const GLuint *>(indices);
+    mapping.subMeshes = reinterpret_cast<const SubMesh *>(subMeshes);
+    mapping.vertexCount = header.vertexCount;
+    mapping.indexCount = header.indexCount;
+    mapping.subMeshCount = header.subMeshCount;
+    mapping.levelCount = header.levelCount;
+    return mapping;
+}
+
+bool MeshCache::store(const QByteArray &key,
+                      const GLfloat *vertices, const GLfloat *normals, int vertexCount,
+                      const GLuint *indices, int indexCount,
+                      const SubMesh *subMeshes, int subMeshCount, int levelCount)
+{
+    if (key.size() != int(sizeof(MeshCacheHeader::key)) || !QDir().mkpath(cacheDirectory()))
+        return false;
+
+    MeshCacheHeader header;
+    std::memset(&header, 0, sizeof(header));
+    std::memcpy(header.magic, MeshCacheMagic, sizeof(MeshCacheMagic));
+    header.version = MeshCacheVersion;
+    header.vertexCount = vertexCount;
+    header.normalCount = normals ? vertexCount : 0;
+    header.indexCount = indexCount;
+    header.subMeshCount = subMeshCount;
+    header.levelCount = levelCount;
+    std::memcpy(header.key, key.constData(), sizeof(header.key));
+
+    // Readers never see a partially written entry.
+    QSaveFile file(QDir(cacheDirectory()).filePath(QString::fromLatin1(key.toHex())));
+    if (!file.open(QIODevice::WriteOnly))
+        return false;
+    file.write(reinterpret_cast<const char *>(&header), sizeof(header));
+    file.write(reinterpret_cast<const char *>(vertices), vertexCount * 3 * sizeof(GLfloat));
+    if (normals)
+        file.write(reinterpret_cast<const char *>(normals), vertexCount * 3 * sizeof(GLfloat));
+    file.write(reinterpret_cast<const char *>(indices), indexCount * sizeof(GLuint));
+    file.write(reinterpret_cast<const char *>(subMeshes), subMeshCount * sizeof(SubMesh));
+    return file.commit();
+}
@@ -0,0 +1,106 @@
+/****************************************************************************
+**
+** Copyright (C) 2016 The Qt Company Ltd.
+** Contact: https://www.qt.io/licensing/
+**
+** This file is part of the examples of the Qt Toolkit.
+**
+** $QT_BEGIN_LICENSE:BSD$
+** Commercial License Usage
+** Licensees holding valid commercial Qt licenses may use this file in
+** accordance with the commercial license agreement provided with the
+** Software or, alternatively, in accordance with the terms contained in
+** a written agreement between you and The Qt Company. For licensing terms
+** and conditions see https://www.qt.io/terms-conditions. For further
+** information use the contact form at https://www.qt.io/contact-us.
+**
+** BSD License Usage
+** Alternatively, you may use this file under the terms of the BSD license
+** as follows:
+**
+** "Redistribution and use in source and binary forms, with or without
+** modification, are permitted provided that the following conditions are
+** met:
+**   * Redistributions of source code must retain the above copyright
+**     notice, this list of conditions and the following disclaimer.
+**   * Redistributions in binary form must reproduce the above copyright
+**     notice, this list of conditions and the following disclaimer in
+**     the documentation and/or other materials provided with the
+**     distribution.
+**   * Neither the name of The Qt Company Ltd nor the names of its
+**     contributors may be used to endorse or promote products derived
+**     from this software without specific prior written permission.
+**
+**
+** THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+** "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+** LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+** A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+** OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+** SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+** LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+** DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+** THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+** (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+** OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE."
+**
+** $QT_END_LICENSE$
+**
+****************************************************************************/
+
+#ifndef MESHCACHE_H
+#define MESHCACHE_H
+
+#include <qopengl.h>
+#include <QByteArray>
+#include <QSharedPointer>
+#include <QString>
+
+QT_FORWARD_DECLARE_CLASS(QFile)
+
+// The range of the index buffer that came from one mesh of a model file.
+struct SubMesh
+{
+    quint32 firstIndex;
+    quint32 indexCount;
+};
+
+// An entry of the mesh cache, mapped into memory. The pointers stay valid
+// as long as any copy of the mapping is alive.
+struct MeshCacheMapping
+{
+    QSharedPointer<QFile> file;
+    const GLfloat *vertices = nullptr;
+    const GLfloat *normals = nullptr;
+    const GLuint *indices = nullptr;
+    const SubMesh *subMeshes = nullptr;
+    int vertexCount = 0;
+    int indexCount = 0;
+    // Over all levels of detail, which follow each other.
+    int subMeshCount = 0;
+    int levelCount = 1;
+
+    bool isValid() const { return !file.isNull(); }
+};
+
+// Persistent cache of meshes after Assimp post-processing. Entries are
+// keyed on the hash of the source file, the import flags and whether the
+// indices were optimized, and are laid
+// out so they can be mapped and uploaded to the GPU without any parsing.
+class MeshCache
+{
+public:
+    static QString cacheDirectory();
+    static QByteArray key(const QString &sourceFile, quint32 importFlags, bool optimized);
+
+    // Returns an invalid mapping if there is no usable entry for key.
+    static MeshCacheMapping map(const QByteArray &key);
+    // normals may be null, otherwise it holds vertexCount normals.
+    // subMeshes holds subMeshCount / levelCount entries per level.
+    static bool store(const QByteArray &key,
+                      const GLfloat *vertices, const GLfloat *normals, int vertexCount,
+                      const GLuint *indices, int indexCount,
+                      const SubMesh *subMeshes, int subMeshCount, int levelCount);
+};
+
+#endif // MESHCACHE_H
@@ -0,0 +1,359 @@
+/****************************************************************************
+**
+** Copyright (C) 2016 The Qt Company Ltd.
+** Contact: https://www.qt.io/licensing/
+**
+** This file is part of the examples of the Qt Toolkit.
+**
+** $QT_BEGIN_LICENSE:BSD$
+** Commercial License Usage
+** Licensees holding valid commercial Qt licenses may use this file in
+** accordance with the commercial license agreement provided with the
+** Software or, alternatively, in accordance with the terms contained in
+** a written agreement between you and The Qt Company. For licensing terms
+** and conditions see https://www.qt.io/terms-conditions. For further
+** information use the contact form at https://www.qt.io/contact-us.
+**
+** BSD License Usage
+** Alternatively, you may use this file under the terms of the BSD license
+** as follows:
+**
+** "Redistribution and use in source and binary forms, with or without
+** modification, are permitted provided that the following conditions are
+** met:
+**   * Redistributions of source code must retain the above copyright
+**     notice, this list of conditions and the following disclaimer.
+**   * Redistributions in binary form must reproduce the above copyright
+**     notice, this list of conditions and the following disclaimer in
+**     the documentation and/or other materials provided with the
+**     distribution.
+**   * Neither the name of The Qt Company Ltd nor the names of its
+**     contributors may be used to endorse or promote products derived
+**     from this software without specific prior written permission.
+**
+**
+** THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+** "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+** LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+** A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+** OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+** SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+** LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+** DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+** THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+** (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+** OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE."
+**
+** $QT_END_LICENSE$
+**
+****************************************************************************/
+
+#include "meshoptimizer.h"
+
+#include <algorithm>
+#include <cmath>
+
+namespace {
+
+// Cache modelled by optimizeVertexCache(), an LRU one like Forsyth's.
+const int ForsythCacheSize = 32;
+
+float vertexScore(int cachePosition, int remainingTriangles)
+{
+    if (remainingTriangles == 0)
+        return -1.0f;
+
+    float score = 0.0f;
+    if (cachePosition >= 0) {
+        // The triangle just emitted used the three most recent entries,
+        // they get a fixed score so it is not picked again right away.
+        if (cachePosition < 3) {
+            score = 0.75f;
+        } else {
+            const float scale = 1.0f / (ForsythCacheSize - 3);
+            score = std::pow(1.0f - (cachePosition - 3) * scale, 1.5f);
+        }
+    }
+    // Prefer vertices with few triangles left, so none get stranded.
+    return score + 2.0f / std::sqrt(float(remainingTriangles));
+}
+
+// Counts cache misses of triangles [first, last) in a FIFO cache of
+// MeshOptimizer::CacheSize entries, timestamps has one entry per vertex.
+class CacheSimulator
+{
+public:
+    explicit CacheSimulator(int vertexCount)
+        : m_timestamps(vertexCount, 0)
+    {
+    }
+
+    void reset() { m_time += MeshOptimizer::CacheSize + 1; }
+
+    int triangleMisses(const GLuint *triangle)
+    {
+        int misses = 0;
+        for (int i = 0; i < 3; ++i) {
+            if (m_time - m_timestamps.at(triangle[i]) > MeshOptimizer::CacheSize) {
+                m_timestamps[triangle[i]] = m_time++;
+                ++misses;
+            }
+        }
+        return misses;
+    }
+
+private:
+    QVector<quint32> m_timestamps;
+    quint32 m_time = MeshOptimizer::CacheSize + 1;
+};
+
+}
+
+float MeshOptimizer::acmr(const GLuint *indices, int indexCount, int vertexCount)
+{
+    const int triangleCount = indexCount / 3;
+    if (triangleCount == 0)
+        return 0.0f;
+
+    CacheSimulator cache(vertexCount);
+    int misses = 0;
+    for (int t = 0; t < triangleCount; ++t)
+        misses += cache.triangleMisses(indices + 3 * t);
+    return float(misses) / triangleCount;
+}
+
+void MeshOptimizer::optimizeVertexCache(GLuint *indices, int indexCount, int vertexCount)
+{
+    const int triangleCount = indexCount / 3;
+    if (triangleCount == 0)
+        return;
+
+    // Triangles of every vertex, in one array with offsets. Emitted
+    // triangles get swapped to the end of their vertex's range.
+    QVector<int> remaining(vertexCount, 0);
+    for (int i = 0; i < triangleCount * 3; ++i)
+        ++remaining[indices[i]];
+    QVector<int> offsets(vertexCount + 1, 0);
+    for (int v = 0; v < vertexCount; ++v)
+        offsets[v + 1] = offsets[v] + remaining.at(v);
+    QVector<int> adjacency(offsets.at(vertexCount));
+    QVector<int> filled(vertexCount, 0);
+    for (int t = 0; t < triangleCount; ++t) {
+        for (int i = 0; i < 3; ++i) {
+            const GLuint v = indices[3 * t + i];
+            adjacency[offsets.at(v) + filled[v]++] = t;
+        }
+    }
+
+    QVector<int> cachePositions(vertexCount, -1);
+    QVector<float> vertexScores(vertexCount);
+    for (int v = 0; v < vertexCount; ++v)
+        vertexScores[v] = vertexScore(-1, remaining.at(v));
+    QVector<float> triangleScores(triangleCount);
+    for (int t = 0; t < triangleCount; ++t) {
+        const GLuint *corner = indices + 3 * t;
+        triangleScores[t] = vertexScores.at(corner[0]) + vertexScores.at(corner[1]) + vertexScores.at(corner[2]);
+    }
+
+    QVector<GLuint> source(triangleCount * 3);
+    std::copy(indices, indices + source.size(), source.begin());
+    QVector<bool> emitted(triangleCount, false);
+    QVector<GLuint> cache;
+    QVector<GLuint> nextCache;
+    cache.reserve(ForsythCacheSize + 3);
+    nextCache.reserve(ForsythCacheSize + 3);
+
+    int bestTriangle = 0;
+    int inputCursor = 0;
+    for (int output = 0; output < triangleCount; ++output) {
+        if (bestTriangle < 0) {
+            // Nothing in the cache has triangles left, continue with the
+            // next triangle of the input.
+            while (emitted.at(inputCursor))
+                ++inputCursor;
+            bestTriangle = inputCursor;
+        }
+
+        const GLuint *corner = source.constData() + 3 * bestTriangle;
+        std::copy(corner, corner + 3, indices + 3 * output);
+        emitted[bestTriangle] = true;
+
+        nextCache.clear();
+        for (int i = 0; i < 3; ++i) {
+            const GLuint v = corner[i];
+            // Drop the triangle from the triangles left for its vertices.
+            int *first = adjacency.data() + offsets.at(v);
+            int *last = first + remaining.at(v) - 1;
+            std::swap(*std::find(first, last + 1, bestTriangle), *last);
+            --remaining[v];
+            nextCache.append(v);
+        }
+        for (GLuint v : cache) {
+            if (v != corner[0] && v != corner[1] && v != corner[2])
+                nextCache.append(v);
+        }
+        std::swap(cache, nextCache);
+
+        // Entries beyond the cache size just got evicted.
+        for (int i = 0; i < cache.size(); ++i) {
+            const GLuint v = cache.at(i);
+            cachePositions[v] = i < ForsythCacheSize ? i : -1;
+            vertexScores[v] = vertexScore(cachePositions.at(v), remaining.at(v));
+        }
+
+        bestTriangle = -1;
+        float bestScore = -1.0f;
+        for (GLuint v : cache) {
+            for (int i = offsets.at(v); i < offsets.at(v) + remaining.at(v); ++i) {
+                const int t = adjacency.at(i);
+                const GLuint *c = source.constData() + 3 * t;
+                triangleScores[t] = vertexScores.at(c[0]) + vertexScores.at(c[1]) + vertexScores.at(c[2]);
+                if (triangleScores.at(t) > bestScore) {
+                    bestScore = triangleScores.at(t);
+                    bestTriangle = t;
+                }
+            }
+        }
+        if (cache.size() > ForsythCacheSize)
+            cache.resize(ForsythCacheSize);
+    }
+}
+
+void MeshOptimizer::optimizeOverdraw(GLuint *indices, int indexCount, const GLfloat *vertices, int vertexCount,
+                                     float threshold)
+{
+    const int triangleCount = indexCount / 3;
+    if (triangleCount == 0)
+        return;
+
+    // Hard boundaries are where the cache ran dry anyway, a cluster can
+    // start there without costing any extra misses.
+    QVector<int> hardBoundaries;
+    CacheSimulator cache(vertexCount);
+    for (int t = 0; t < triangleCount; ++t) {
+        if (cache.triangleMisses(indices + 3 * t) == 3)
+            hardBoundaries.append(t);
+    }
+    hardBoundaries.append(triangleCount);
+
+    // Soft boundaries split hard clusters further, wherever restarting
+    // the cache keeps the cluster below threshold times its own ACMR.
+    QVector<int> clusters;
+    for (int h = 0; h + 1 < hardBoundaries.size(); ++h) {
+        const int start = hardBoundaries.at(h);
+        const int end = hardBoundaries.at(h + 1);
+        const float limit = acmr(indices + 3 * start, 3 * (end - start), vertexCount) * threshold;
+
+        cache.reset();
+        int clusterStart = start;
+        int misses = 0;
+        clusters.append(start);
+        for (int t = start; t < end; ++t) {
+            misses += cache.triangleMisses(indices + 3 * t);
+            // A cluster of at least a cache's worth of triangles, small
+            // ones would not sort any meaningfully.
+            const int size = t + 1 - clusterStart;
+            if (t + 1 < end && size >= CacheSize && float(misses) / size <= limit) {
+                cache.reset();
+                clusterStart = t + 1;
+                misses = 0;
+                clusters.append(clusterStart);
+            }
+        }
+    }
+    clusters.append(triangleCount);
+
+    double meshCenter[3] = { 0.0, 0.0, 0.0 };
+    double meshArea = 0.0;
+    struct Cluster
+    {
+        int start;
+        int end;
+        double center[3];
+        double normal[3];
+        double sortKey;
+    };
+    QVector<Cluster> sorted(clusters.size() - 1);
+    for (int c = 0; c < sorted.size(); ++c) {
+        Cluster &cluster = sorted[c];
+        cluster.start = clusters.at(c);
+        cluster.end = clusters.at(c + 1);
+        double area = 0.0;
+        for (int i = 0; i < 3; ++i)
+            cluster.center[i] = cluster.normal[i] = 0.0;
+        for (int t = cluster.start; t < cluster.end; ++t) {
+            const GLfloat *a = vertices + 3 * indices[3 * t];
+            const GLfloat *b = vertices + 3 * indices[3 * t + 1];
+            const GLfloat *p = vertices + 3 * indices[3 * t + 2];
+            const double u[3] = { b[0] - a[0], b[1] - a[1], b[2] - a[2] };
+            const double v[3] = { p[0] - a[0], p[1] - a[1], p[2] - a[2] };
+            const double n[3] = { u[1] * v[2] - u[2] * v[1], u[2] * v[0] - u[0] * v[2], u[0] * v[1] - u[1] * v[0] };
+            const double triangleArea = std::sqrt(n[0] * n[0] + n[1] * n[1] + n[2] * n[2]);
+            for (int i = 0; i < 3; ++i) {
+                cluster.center[i] += triangleArea * (a[i] + b[i] + p[i]) / 3.0;
+                cluster.normal[i] += n[i];
+            }
+            area += triangleArea;
+        }
+        for (int i = 0; i < 3; ++i)
+            meshCenter[i] += cluster.center[i];
+        meshArea += area;
+        if (area > 0.0) {
+            for (int i = 0; i < 3; ++i)
+                cluster.center[i] /= area;
+        }
+    }
+    if (meshArea > 0.0) {
+        for (int i = 0; i < 3; ++i)
+            meshCenter[i] /= meshArea;
+    }
+
+    // Clusters far out along their normal are likely to occlude others.
+    for (Cluster &cluster : sorted) {
+        const double length = std::sqrt(cluster.normal[0] * cluster.normal[0] + cluster.normal[1] * cluster.normal[1]
+                                        + cluster.normal[2] * cluster.normal[2]);
+        cluster.sortKey = 0.0;
+        if (length > 0.0) {
+            for (int i = 0; i < 3; ++i)
+                cluster.sortKey += (cluster.center[i] - meshCenter[i]) * cluster.normal[i] / length;
+        }
+    }
+    std::stable_sort(sorted.begin(), sorted.end(), [](const Cluster &a, const Cluster &b) {
+        return a.sortKey > b.sortKey;
+    });
+
+    QVector<GLuint> source(triangleCount * 3);
+    std::copy(indices, indices + source.size(), source.begin());
+    GLuint *output = indices;
+    for (const Cluster &cluster : sorted)
+        output = std::copy(source.constData() + 3 * cluster.start, source.constData() + 3 * cluster.end, output);
+}
+
+void MeshOptimizer::optimizeVertexFetch(QVector<GLfloat> &vertices, QVector<GLfloat> &normals,
+                                        QVector<GLuint> &indices)
+{
+    const int vertexCount = vertices.size() / 3;
+    const GLuint unused = ~GLuint(0);
+    QVector<GLuint> remap(vertexCount, unused);
+    GLuint next = 0;
+    for (GLuint &index : indices) {
+        if (remap.at(index) == unused)
+            remap[index] = next++;
+        index = remap.at(index);
+    }
+    // Vertices no triangle uses keep their relative order at the end.
+    for (GLuint &target : remap) {
+        if (target == unused)
+            target = next++;
+    }
+
+    QVector<GLfloat> reordered(vertices.size());
+    for (int v = 0; v < vertexCount; ++v)
+        std::copy(vertices.constData() + 3 * v, vertices.constData() + 3 * v + 3, reordered.data() + 3 * remap.at(v));
+    vertices = reordered;
+    if (!normals.isEmpty()) {
+        for (int v = 0; v < vertexCount; ++v)
+            std::copy(normals.constData() + 3 * v, normals.constData() + 3 * v + 3, reordered.data() + 3 * remap.at(v));
+        normals = reordered;
+    }
+}
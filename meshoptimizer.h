@@ -0,0 +1,85 @@
+/****************************************************************************
+**
+** Copyright (C) 2016 The Qt Company Ltd.
+** Contact: https://www.qt.io/licensing/
+**
+** This file is part of the examples of the Qt Toolkit.
+**
+** $QT_BEGIN_LICENSE:BSD$
+** Commercial License Usage
+** Licensees holding valid commercial Qt licenses may use this file in
+** accordance with the commercial license agreement provided with the
+** Software or, alternatively, in accordance with the terms contained in
+** a written agreement between you and The Qt Company. For licensing terms
+** and conditions see https://www.qt.io/terms-conditions. For further
+** information use the contact form at https://www.qt.io/contact-us.
+**
+** BSD License Usage
+** Alternatively, you may use this file under the terms of the BSD license
+** as follows:
+**
+** "Redistribution and use in source and binary forms, with or without
+** modification, are permitted provided that the following conditions are
+** met:
+**   * Redistributions of source code must retain the above copyright
+**     notice, this list of conditions and the following disclaimer.
+**   * Redistributions in binary form must reproduce the above copyright
+**     notice, this list of conditions and the following disclaimer in
+**     the documentation and/or other materials provided with the
+**     distribution.
+**   * Neither the name of The Qt Company Ltd nor the names of its
+**     contributors may be used to endorse or promote products derived
+**     from this software without specific prior written permission.
+**
+**
+** THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+** "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+** LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+** A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+** OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+** SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+** LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+** DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+** THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+** (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+** OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE."
+**
+** $QT_END_LICENSE$
+**
+****************************************************************************/
+
+#ifndef MESHOPTIMIZER_H
+#define MESHOPTIMIZER_H
+
+#include <qopengl.h>
+#include <QVector>
+
+// Reorders triangle lists for the GPU: triangles for the post-transform
+// vertex cache, clusters of them against overdraw, and vertices for
+// fetching them in order. None of it changes what gets drawn.
+class MeshOptimizer
+{
+public:
+    // Entries of the FIFO cache acmr() simulates.
+    static const int CacheSize = 16;
+
+    // Average cache miss ratio, transformed vertices per triangle. 3 is
+    // the worst, around 0.6 the best a regular grid can do.
+    static float acmr(const GLuint *indices, int indexCount, int vertexCount);
+
+    // Forsyth, "Linear-Speed Vertex Cache Optimisation". Indices may
+    // refer to any vertex below vertexCount.
+    static void optimizeVertexCache(GLuint *indices, int indexCount, int vertexCount);
+    // Sander et al., "Fast Triangle Reordering for Vertex Locality and
+    // Reduced Overdraw". Cuts a cache optimized list into clusters and
+    // draws the outward facing ones first, letting the ACMR grow by at
+    // most threshold.
+    static void optimizeOverdraw(GLuint *indices, int indexCount, const GLfloat *vertices, int vertexCount,
+                                 float threshold = 1.05f);
+    // Renumbers the vertices in the order indices first use them, and
+    // moves vertices and normals (which may be empty) along.
+    static void optimizeVertexFetch(QVector<GLfloat> &vertices, QVector<GLfloat> &normals,
+                                    QVector<GLuint> &indices);
+};
+
+#endif // MESHOPTIMIZER_H
@@ -0,0 +1,246 @@
+/****************************************************************************
+**
+** Copyright (C) 2016 The Qt Company Ltd.
+** Contact: https://www.qt.io/licensing/
+**
+** This file is part of the examples of the Qt Toolkit.
+**
+** $QT_BEGIN_LICENSE:BSD$
+** Commercial License Usage
+** Licensees holding valid commercial Qt licenses may use this file in
+** accordance with the commercial license agreement provided with the
+** Software or, alternatively, in accordance with the terms contained in
+** a written agreement between you and The Qt Company. For licensing terms
+** and conditions see https://www.qt.io/terms-conditions. For further
+** information use the contact form at https://www.qt.io/contact-us.
+**
+** BSD License Usage
+** Alternatively, you may use this file under the terms of the BSD license
+** as follows:
+**
+** "Redistribution and use in source and binary forms, with or without
+** modification, are permitted provided that the following conditions are
+** met:
+**   * Redistributions of source code must retain the above copyright
+**     notice, this list of conditions and the following disclaimer.
+**   * Redistributions in binary form must reproduce the above copyright
+**     notice, this list of conditions and the following disclaimer in
+**     the documentation and/or other materials provided with the
+**     distribution.
+**   * Neither the name of The Qt Company Ltd nor the names of its
+**     contributors may be used to endorse or promote products derived
+**     from this software without specific prior written permission.
+**
+**
+** THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+** "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+** LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+** A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+** OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+** SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+** LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+** DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+** THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+** (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+** OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE."
+**
+** $QT_END_LICENSE$
+**
+****************************************************************************/
+
+#include "meshsimplifier.h"
+
+#include <QHash>
+#include <algorithm>
+#include <cmath>
+#include <queue>
+
+namespace {
+
+// Symmetric 4x4 matrix, upper triangle row by row.
+struct Quadric
+{
+    double q[10] = { 0.0, 0.0, 0.0, 0.0, 0.0, 0.0, 0.0, 0.0, 0.0, 0.0 };
+
+    void addPlane(double a, double b, double c, double d, double weight)
+    {
+        q[0] += weight * a * a; q[1] += weight * a * b; q[2] += weight * a * c; q[3] += weight * a * d;
+        q[4] += weight * b * b; q[5] += weight * b * c; q[6] += weight * b * d;
+        q[7] += weight * c * c; q[8] += weight * c * d;
+        q[9] += weight * d * d;
+    }
+
+    void add(const Quadric &other)
+    {
+        for (int i = 0; i < 10; ++i)
+            q[i] += other.q[i];
+    }
+
+    double error(const GLfloat *p) const
+    {
+        const double x = p[0], y = p[1], z = p[2];
+        return q[0] * x * x + 2 * q[1] * x * y + 2 * q[2] * x * z + 2 * q[3] * x
+                + q[4] * y * y + 2 * q[5] * y * z + 2 * q[6] * y
+                + q[7] * z * z + 2 * q[8] * z
+                + q[9];
+    }
+};
+
+struct Collapse
+{
+    double cost;
+    GLuint from;
+    GLuint to;
+    quint32 fromVersion;
+    quint32 toVersion;
+
+    bool operator<(const Collapse &other) const { return cost > other.cost; }
+};
+
+void cross(const GLfloat *a, const GLfloat *b, const GLfloat *c, double *n)
+{
+    const double u[3] = { b[0] - a[0], b[1] - a[1], b[2] - a[2] };
+    const double v[3] = { c[0] - a[0], c[1] - a[1], c[2] - a[2] };
+    n[0] = u[1] * v[2] - u[2] * v[1];
+    n[1] = u[2] * v[0] - u[0] * v[2];
+    n[2] = u[0] * v[1] - u[1] * v[0];
+}
+
+quint64 edgeKey(GLuint a, GLuint b)
+{
+    return a < b ? (quint64(a) << 32) | b : (quint64(b) << 32) | a;
+}
+
+}
+
+QVector<GLuint> MeshSimplifier::simplify(const GLfloat *vertices, int vertexCount,
+                                         const GLuint *indices, int indexCount, int targetIndexCount)
+{
+    const int triangleCount = indexCount / 3;
+    QVector<GLuint> triangles(triangleCount * 3);
+    std::copy(indices, indices + triangles.size(), triangles.begin());
+    QVector<bool> alive(triangleCount, true);
+    QVector<Quadric> quadrics(vertexCount);
+    QVector<QVector<int>> vertexTriangles(vertexCount);
+    QVector<quint32> versions(vertexCount, 0);
+    QVector<bool> locked(vertexCount, false);
+    QHash<quint64, int> edgeUses;
+
+    for (int t = 0; t < triangleCount; ++t) {
+        const GLuint *corner = triangles.constData() + 3 * t;
+        double n[3];
+        cross(vertices + 3 * corner[0], vertices + 3 * corner[1], vertices + 3 * corner[2], n);
+        const double length = std::sqrt(n[0] * n[0] + n[1] * n[1] + n[2] * n[2]);
+        if (length > 0.0) {
+            // Weighted by the triangle area, which is half the length.
+            const GLfloat *p = vertices + 3 * corner[0];
+            const double a = n[0] / length, b = n[1] / length, c = n[2] / length;
+            const double d = -(a * p[0] + b * p[1] + c * p[2]);
+            for (int i = 0; i < 3; ++i)
+                quadrics[corner[i]].addPlane(a, b, c, d, 0.5 * length);
+        }
+        for (int i = 0; i < 3; ++i) {
+            vertexTriangles[corner[i]].append(t);
+            ++edgeUses[edgeKey(corner[i], corner[(i + 1) % 3])];
+        }
+    }
+    // Edges not shared by exactly two triangles are borders or seams
+    // between vertices that only differ in their normal.
+    for (auto it = edgeUses.constBegin(); it != edgeUses.constEnd(); ++it) {
+        if (it.value() != 2) {
+            locked[GLuint(it.key() >> 32)] = true;
+            locked[GLuint(it.key() & 0xffffffff)] = true;
+        }
+    }
+    edgeUses.clear();
+
+    std::priority_queue<Collapse> queue;
+    const auto push = [&](GLuint from, GLuint to) {
+        if (locked[from] || from == to)
+            return;
+        Quadric q = quadrics[from];
+        q.add(quadrics[to]);
+        queue.push({ q.error(vertices + 3 * to), from, to, versions[from], versions[to] });
+    };
+    for (int t = 0; t < triangleCount; ++t) {
+        for (int i = 0; i < 3; ++i) {
+            push(triangles[3 * t + i], triangles[3 * t + (i + 1) % 3]);
+            push(triangles[3 * t + (i + 1) % 3], triangles[3 * t + i]);
+        }
+    }
+
+    int liveTriangles = triangleCount;
+    while (liveTriangles * 3 > targetIndexCount && !queue.empty()) {
+        const Collapse collapse = queue.top();
+        queue.pop();
+        const GLuint from = collapse.from;
+        const GLuint to = collapse.to;
+        if (collapse.fromVersion != versions[from] || collapse.toVersion != versions[to])
+            continue;
+
+        // Moving from onto to must not turn any remaining triangle over.
+        bool flips = false;
+        for (int t : qAsConst(vertexTriangles[from])) {
+            const GLuint *corner = triangles.constData() + 3 * t;
+            if (!alive[t] || corner[0] == to || corner[1] == to || corner[2] == to)
+                continue;
+            const GLfloat *before[3];
+            const GLfloat *after[3];
+            for (int i = 0; i < 3; ++i) {
+                before[i] = vertices + 3 * corner[i];
+                after[i] = corner[i] == from ? vertices + 3 * to : before[i];
+            }
+            double n0[3], n1[3];
+            cross(before[0], before[1], before[2], n0);
+            cross(after[0], after[1], after[2], n1);
+            if (n0[0] * n1[0] + n0[1] * n1[1] + n0[2] * n1[2] <= 0.0) {
+                flips = true;
+                break;
+            }
+        }
+        if (flips)
+            continue;
+
+        quadrics[to].add(quadrics[from]);
+        ++versions[from];
+        ++versions[to];
+        // from is gone for good, nothing may collapse onto it any more.
+        locked[from] = true;
+        for (int t : qAsConst(vertexTriangles[from])) {
+            if (!alive[t])
+                continue;
+            GLuint *corner = triangles.data() + 3 * t;
+            for (int i = 0; i < 3; ++i) {
+                if (corner[i] == from)
+                    corner[i] = to;
+            }
+            if (corner[0] == corner[1] || corner[1] == corner[2] || corner[0] == corner[2]) {
+                alive[t] = false;
+                --liveTriangles;
+            } else {
+                vertexTriangles[to].append(t);
+            }
+        }
+        vertexTriangles[from].clear();
+
+        for (int t : qAsConst(vertexTriangles[to])) {
+            if (!alive[t])
+                continue;
+            for (int i = 0; i < 3; ++i) {
+                const GLuint other = triangles[3 * t + i];
+                if (other != to) {
+                    push(other, to);
+                    push(to, other);
+                }
+            }
+        }
+    }
+
+    QVector<GLuint> result;
+    result.reserve(liveTriangles * 3);
+    for (int t = 0; t < triangleCount; ++t) {
+        if (alive[t])
+            result << triangles[3 * t] << triangles[3 * t + 1] << triangles[3 * t + 2];
+    }
+    return result;
+}
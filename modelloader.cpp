@@ -0,0 +1,205 @@
+/****************************************************************************
+**
+** Copyright (C) 2016 The Qt Company Ltd.
+** Contact: https://www.qt.io/licensing/
+**
+** This file is part of the examples of the Qt Toolkit.
+**
+** $QT_BEGIN_LICENSE:BSD$
+** Commercial License Usage
+** Licensees holding valid commercial Qt licenses may use this file in
+** accordance with the commercial license agreement provided with the
+** Software or, alternatively, in accordance with the terms contained in
+** a written agreement between you and The Qt Company. For licensing terms
+** and conditions see https://www.qt.io/terms-conditions. For further
+** information use the contact form at https://www.qt.io/contact-us.
+**
+** BSD License Usage
+** Alternatively, you may use this file under the terms of the BSD license
+** as follows:
+**
+** "Redistribution and use in source and binary forms, with or without
+** modification, are permitted provided that the following conditions are
+** met:
+**   * Redistributions of source code must retain the above copyright
+**     notice, this list of conditions and the following disclaimer.
+**   * Redistributions in binary form must reproduce the above copyright
+**     notice, this list of conditions and the following disclaimer in
+**     the documentation and/or other materials provided with the
+**     distribution.
+**   * Neither the name of The Qt Company Ltd nor the names of its
+**     contributors may be used to endorse or promote products derived
+**     from this software without specific prior written permission.
+**
+**
+** THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+** "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+** LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+** A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+** OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+** SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+** LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+** DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+** THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+** (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+** OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE."
+**
+** $QT_END_LICENSE$
+**
+****************************************************************************/
+
+#include "modelloader.h"
+#include "profiler.h"
+
+#include <QOffscreenSurface>
+#include <QOpenGLContext>
+#include <QOpenGLFunctions>
+#include <QRunnable>
+#include <functional>
+
+namespace {
+
+class ImportTask : public QRunnable
+{
+public:
+    explicit ImportTask(const std::function<void()> &function)
+        : m_function(function)
+    {
+    }
+
+    void run() override
+    {
+        m_function();
+    }
+
+private:
+    std::function<void()> m_function;
+};
+
+}
+
+ModelLoader::ModelLoader(QOpenGLContext *shareContext, VertexFormat format, QObject *parent)
+    : QObject(parent),
+      m_format(format)
+{
+    m_uploadThread.setObjectName(QStringLiteral("ModelLoader upload"));
+    m_uploader = new QObject;
+    m_uploader->moveToThread(&m_uploadThread);
+
+    if (shareContext) {
+        m_uploadContext = new QOpenGLContext;
+        m_uploadContext->setFormat(shareContext->format());
+        m_uploadContext->setShareContext(shareContext);
+        if (m_uploadContext->create() && QOpenGLContext::areSharing(m_uploadContext, shareContext)) {
+            // Surfaces have to be created on the GUI thread.
+            m_surface = new QOffscreenSurface;
+            m_surface->setFormat(m_uploadContext->format());
+            m_surface->create();
+            m_uploadContext->moveToThread(&m_uploadThread);
+        } else {
+            qWarning("ModelLoader: could not create a shared upload context, uploading from the CPU");
+            delete m_uploadContext;
+            m_uploadContext = nullptr;
+        }
+    }
+    m_uploadThread.start();
+}
+
+ModelLoader::~ModelLoader()
+{
+    m_importPool.clear();
+    m_importPool.waitForDone();
+
+    // Uploads queued by the finished imports run before this.
+    QMetaObject::invokeMethod(m_uploader, [this] { releaseUploads(); }, Qt::BlockingQueuedConnection);
+    m_uploadThread.quit();
+    m_uploadThread.wait();
+
+    delete m_uploader;
+    delete m_uploadContext;
+    delete m_surface;
+}
+
+int ModelLoader::load(const QString &file)
+{
+    QMutexLocker locker(&m_mutex);
+    const int ticket = m_nextTicket++;
+    ++m_pending;
+    m_importPool.start(new ImportTask([this, ticket, file] { import(ticket, file); }));
+    return ticket;
+}
+
+QSharedPointer<LoadedModel> ModelLoader::takeModel(int ticket)
+{
+    QMutexLocker locker(&m_mutex);
+    return m_loaded.take(ticket);
+}
+
+int ModelLoader::pendingCount() const
+{
+    QMutexLocker locker(&m_mutex);
+    return m_pending;
+}
+
+// Runs on the import pool.
+void ModelLoader::import(int ticket, const QString &file)
+{
+    const ObjectModelRenerable objectModel(file);
+    if (objectModel.indicesCount() == 0) {
+        {
+            QMutexLocker locker(&m_mutex);
+            --m_pending;
+        }
+        emit loadFailed(ticket, file);
+        return;
+    }
+
+    QSharedPointer<LoadedModel> model(new LoadedModel);
+    model->file = file;
+    model->data = ModelRegistry::prepareModel(objectModel, m_format);
+    QMetaObject::invokeMethod(m_uploader, [this, ticket, model] { upload(ticket, model); }, Qt::QueuedConnection);
+}
+
+// Runs on the upload thread.
+void ModelLoader::upload(int ticket, const QSharedPointer<LoadedModel> &model)
+{
+    ProfileScope profile("model upload");
+    if (m_uploadContext && m_uploadContext->makeCurrent(m_surface)) {
+        model->vertexBuffer.create();
+        model->vertexBuffer.bind();
+        model->vertexBuffer.allocate(model->data.vertexData.constData(), model->data.vertexData.size());
+        model->vertexBuffer.release();
+        model->indexBuffer.create();
+        model->indexBuffer.bind();
+        model->indexBuffer.allocate(model->data.indexData.constData(), model->data.indexData.size());
+        model->indexBuffer.release();
+        // The buffers are used from the other context right after the
+        // signal, the uploads have to be complete by then.
+        m_uploadContext->functions()->glFinish();
+        m_uploadContext->doneCurrent();
+    }
+
+    {
+        QMutexLocker locker(&m_mutex);
+        --m_pending;
+        m_loaded.insert(ticket, model);
+    }
+    emit modelLoaded(ticket);
+}
+
+// Runs on the upload thread, frees what nobody took.
+void ModelLoader::releaseUploads()
+{
+    if (!m_uploadContext)
+        return;
+    if (m_uploadContext->makeCurrent(m_surface)) {
+        QMutexLocker locker(&m_mutex);
+        for (const QSharedPointer<LoadedModel> &model : qAsConst(m_loaded)) {
+            model->vertexBuffer.destroy();
+            model->indexBuffer.destroy();
+        }
+        m_loaded.clear();
+        m_uploadContext->doneCurrent();
+    }
+    m_uploadContext->moveToThread(thread());
+}
@@ -0,0 +1,127 @@
+/****************************************************************************
+**
+** Copyright (C) 2016 The Qt Company Ltd.
+** Contact: https://www.qt.io/licensing/
+**
+** This file is part of the examples of the Qt Toolkit.
+**
+** $QT_BEGIN_LICENSE:BSD$
+** Commercial License Usage
+** Licensees holding valid commercial Qt licenses may use this file in
+** accordance with the commercial license agreement provided with the
+** Software or, alternatively, in accordance with the terms contained in
+** a written agreement between you and The Qt Company. For licensing terms
+** and conditions see https://www.qt.io/terms-conditions. For further
+** information use the contact form at https://www.qt.io/contact-us.
+**
+** BSD License Usage
+** Alternatively, you may use this file under the terms of the BSD license
+** as follows:
+**
+** "Redistribution and use in source and binary forms, with or without
+** modification, are permitted provided that the following conditions are
+** met:
+**   * Redistributions of source code must retain the above copyright
+**     notice, this list of conditions and the following disclaimer.
+**   * Redistributions in binary form must reproduce the above copyright
+**     notice, this list of conditions and the following disclaimer in
+**     the documentation and/or other materials provided with the
+**     distribution.
+**   * Neither the name of The Qt Company Ltd nor the names of its
+**     contributors may be used to endorse or promote products derived
+**     from this software without specific prior written permission.
+**
+**
+** THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+** "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+** LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+** A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+** OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+** SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+** LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+** DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+** THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+** (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+** OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE."
+**
+** $QT_END_LICENSE$
+**
+****************************************************************************/
+
+#ifndef MODELLOADER_H
+#define MODELLOADER_H
+
+#include "modelregistry.h"
+
+#include <QHash>
+#include <QMutex>
+#include <QObject>
+#include <QOpenGLBuffer>
+#include <QSharedPointer>
+#include <QThread>
+#include <QThreadPool>
+
+QT_FORWARD_DECLARE_CLASS(QOffscreenSurface)
+QT_FORWARD_DECLARE_CLASS(QOpenGLContext)
+
+// A model imported by ModelLoader. When the upload context worked, data
+// already sits in the two buffers, which belong to the share group of the
+// context given to the loader.
+struct LoadedModel
+{
+    QString file;
+    ModelRegistry::ModelData data;
+    QOpenGLBuffer vertexBuffer = QOpenGLBuffer(QOpenGLBuffer::VertexBuffer);
+    QOpenGLBuffer indexBuffer = QOpenGLBuffer(QOpenGLBuffer::IndexBuffer);
+
+    bool isUploaded() const { return vertexBuffer.isCreated() && indexBuffer.isCreated(); }
+};
+
+// Imports models in parallel on a thread pool, each worker with its own
+// Assimp importer, and uploads them through a context sharing with
+// shareContext on a thread of its own. modelLoaded() is emitted once a
+// model can be taken; adding it to a ModelRegistry then is a copy on the
+// GPU, so the first frames do not wait for the big models.
+//
+// Create and destroy the loader on the GUI thread.
+class ModelLoader : public QObject
+{
+    Q_OBJECT
+
+public:
+    // Without shareContext, or if sharing fails, models are only imported
+    // and have to be written from the CPU when they are added.
+    ModelLoader(QOpenGLContext *shareContext, VertexFormat format, QObject *parent = nullptr);
+    ~ModelLoader();
+
+    // Returns the ticket modelLoaded() or loadFailed() reports.
+    int load(const QString &file);
+    // Null unless modelLoaded() was emitted for ticket. Afterwards the
+    // caller owns the buffers of the model.
+    QSharedPointer<LoadedModel> takeModel(int ticket);
+    int pendingCount() const;
+
+signals:
+    void modelLoaded(int ticket);
+    void loadFailed(int ticket, const QString &file);
+
+private:
+    void import(int ticket, const QString &file);
+    void upload(int ticket, const QSharedPointer<LoadedModel> &model);
+    void releaseUploads();
+
+    VertexFormat m_format;
+    QThreadPool m_importPool;
+    QThread m_uploadThread;
+    // Lives on the upload thread, receives the uploads.
+    QObject *m_uploader = nullptr;
+    QOffscreenSurface *m_surface = nullptr;
+    QOpenGLContext *m_uploadContext = nullptr;
+
+    mutable QMutex m_mutex;
+    int m_nextTicket = 0;
+    int m_pending = 0;
+    QHash<int, QSharedPointer<LoadedModel>> m_loaded;
+};
+
+#endif // MODELLOADER_H
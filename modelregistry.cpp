@@ -0,0 +1,533 @@
+/****************************************************************************
+**
+** Copyright (C) 2016 The Qt Company Ltd.
+** Contact: https://www.qt.io/licensing/
+**
+** This file is part of the examples of the Qt Toolkit.
+**
+** $QT_BEGIN_LICENSE:BSD$
+** Commercial License Usage
+** Licensees holding valid commercial Qt licenses may use this file in
+** accordance with the commercial license agreement provided with the
+** Software or, alternatively, in accordance with the terms contained in
+** a written agreement between you and The Qt Company. For licensing terms
+** and conditions see https://www.qt.io/terms-conditions. For further
+** information use the contact form at https://www.qt.io/contact-us.
+**
+** BSD License Usage
+** Alternatively, you may use this file under the terms of the BSD license
+** as follows:
+**
+** "Redistribution and use in source and binary forms, with or without
+** modification, are permitted provided that the following conditions are
+** met:
+**   * Redistributions of source code must retain the above copyright
+**     notice, this list of conditions and the following disclaimer.
+**   * Redistributions in binary form must reproduce the above copyright
+**     notice, this list of conditions and the following disclaimer in
+**     the documentation and/or other materials provided with the
+**     distribution.
+**   * Neither the name of The Qt Company Ltd nor the names of its
+**     contributors may be used to endorse or promote products derived
+**     from this software without specific prior written permission.
+**
+**
+** THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+** "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+** LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+** A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+** OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+** SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+** LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+** DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+** THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+** (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+** OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE."
+**
+** $QT_END_LICENSE$
+**
+****************************************************************************/
+
+#include "modelregistry.h"
+
+#include <QOpenGLContext>
+#include <cstring>
+#include <algorithm>
+
+#define PROGRAM_VERTEX_ATTRIBUTE 0
+#define PROGRAM_NORMAL_ATTRIBUTE 1
+
+// Buffers grow at least by this much, so adding the T-LESS models one by
+// one does not copy the arena every time.
+static const int MinimumGrowth = 4 * 1024 * 1024;
+
+ModelRegistry::ModelRegistry(VertexFormat format)
+    : m_format(format),
+      m_vertexBuffer(QOpenGLBuffer::VertexBuffer),
+      m_indexBuffer(QOpenGLBuffer::IndexBuffer)
+{
+}
+
+ModelRegistry::~ModelRegistry()
+{
+    // Buffers are released through destroy() while the context is current.
+}
+
+void ModelRegistry::create()
+{
+    initializeOpenGLFunctions();
+
+    // Create a vertex array object. In OpenGL ES 2.0 and OpenGL 2.x
+    // implementations this is optional and support may not be present
+    // at all, bind() sets up the attributes by hand then.
+    m_vao.create();
+    m_vertexBuffer.setUsagePattern(QOpenGLBuffer::StaticDraw);
+    m_vertexBuffer.create();
+    m_indexBuffer.setUsagePattern(QOpenGLBuffer::StaticDraw);
+    m_indexBuffer.create();
+
+    // Not part of OpenGL ES, fall back to one draw per sub mesh there.
+    QOpenGLContext *context = QOpenGLContext::currentContext();
+    if (!context->isOpenGLES() && (context->format().version() >= qMakePair(3, 2)
+                                   || context->hasExtension("GL_ARB_draw_elements_base_vertex"))) {
+        m_multiDrawElementsBaseVertex = reinterpret_cast<MultiDrawElementsBaseVertex>(
+                    context->getProcAddress("glMultiDrawElementsBaseVertex"));
+    }
+}
+
+void ModelRegistry::destroy()
+{
+    m_vao.destroy();
+    if (m_sharedBuffers) {
+        // Copies of QOpenGLBuffer share the GL buffer, destroying ours
+        // would pull it away from the registry we share with.
+        m_vertexBuffer = QOpenGLBuffer(QOpenGLBuffer::VertexBuffer);
+        m_indexBuffer = QOpenGLBuffer(QOpenGLBuffer::IndexBuffer);
+        m_sharedBuffers = false;
+    } else {
+        m_vertexBuffer.destroy();
+        m_indexBuffer.destroy();
+    }
+    m_vertexCapacity = 0;
+    m_indexCapacity = 0;
+    clear();
+}
+
+void ModelRegistry::clear()
+{
+    detachSharedBuffers(false);
+    m_models.clear();
+    m_uploads.clear();
+    m_vertexBytes = 0;
+    m_indexBytes = 0;
+}
+
+void ModelRegistry::setVertexFormat(VertexFormat format)
+{
+    clear();
+    m_format = format;
+}
+
+bool ModelRegistry::shareModels(const ModelRegistry &source)
+{
+    if (!source.m_uploads.isEmpty()) {
+        qWarning("ModelRegistry: cannot share models that are still uploading");
+        return false;
+    }
+
+    clear();
+    m_vertexBuffer.destroy();
+    m_indexBuffer.destroy();
+    m_format = source.m_format;
+    m_vertexBuffer = source.m_vertexBuffer;
+    m_indexBuffer = source.m_indexBuffer;
+    m_vertexCapacity = source.m_vertexCapacity;
+    m_vertexBytes = source.m_vertexBytes;
+    m_indexCapacity = source.m_indexCapacity;
+    m_indexBytes = source.m_indexBytes;
+    m_models = source.m_models;
+    m_sharedBuffers = true;
+
+    // Vertex array objects are not shared between contexts.
+    QOpenGLVertexArrayObject::Binder vaoBinder(&m_vao);
+    setupVertexArray();
+    return true;
+}
+
+// Swaps shared buffers for ones of our own before anything gets written
+// to them, with a GPU copy of the shared models if we keep them.
+void ModelRegistry::detachSharedBuffers(bool keepModels)
+{
+    if (!m_sharedBuffers)
+        return;
+    m_sharedBuffers = false;
+
+    QOpenGLBuffer *buffers[] = { &m_vertexBuffer, &m_indexBuffer };
+    const int usedBytes[] = { keepModels ? m_vertexBytes : 0, keepModels ? m_indexBytes : 0 };
+    for (int i = 0; i < 2; ++i) {
+        QOpenGLBuffer own(buffers[i]->type());
+        own.setUsagePattern(QOpenGLBuffer::StaticDraw);
+        own.create();
+        own.bind();
+        own.allocate(usedBytes[i]);
+        if (usedBytes[i] > 0)
+            copyBuffer(*buffers[i], own, 0, usedBytes[i]);
+        *buffers[i] = own;
+    }
+    m_vertexCapacity = usedBytes[0];
+    m_indexCapacity = usedBytes[1];
+}
+
+int ModelRegistry::vertexStride() const
+{
+    return m_format == VertexFormat::Packed ? PackedMesh::VertexStride : 6 * sizeof(GLfloat);
+}
+
+void ModelRegistry::copyBuffer(QOpenGLBuffer &source, QOpenGLBuffer &destination, int offset, int size)
+{
+    glBindBuffer(GL_COPY_READ_BUFFER, source.bufferId());
+    glBindBuffer(GL_COPY_WRITE_BUFFER, destination.bufferId());
+    glCopyBufferSubData(GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER, 0, offset, size);
+    glBindBuffer(GL_COPY_READ_BUFFER, 0);
+    glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+}
+
+void ModelRegistry::reserve(QOpenGLBuffer &buffer, int *capacity, int used, int required)
+{
+    if (required <= *capacity)
+        return;
+
+    const int grownCapacity = qMax(required, qMax(2 * *capacity, *capacity + MinimumGrowth));
+    QOpenGLBuffer grown(buffer.type());
+    grown.setUsagePattern(QOpenGLBuffer::StaticDraw);
+    grown.create();
+    grown.bind();
+    grown.allocate(grownCapacity);
+    if (used > 0)
+        copyBuffer(buffer, grown, 0, used);
+    buffer.destroy();
+    buffer = grown;
+    *capacity = grownCapacity;
+}
+
+ModelRegistry::ModelData ModelRegistry::prepareModel(const ObjectModelRenerable &objectModel, VertexFormat format)
+{
+    // Read in place, out of the cache mapping where the model has one.
+    const MeshSpan<GLfloat> positions = objectModel.vertexSpan();
+    const MeshSpan<GLfloat> normals = objectModel.normalSpan();
+    const MeshSpan<GLuint> indices = objectModel.indexSpan();
+    const int vertexCount = positions.size / 3;
+    const bool hasNormals = !normals.isEmpty();
+
+    ModelData data;
+    data.format = format;
+    data.vertexCount = vertexCount;
+    if (format == VertexFormat::Packed) {
+        const PackedMesh mesh = PackedMesh::pack(positions.data,
+                                                 hasNormals ? normals.data : nullptr,
+                                                 vertexCount,
+                                                 indices.data, indices.size);
+        data.vertexData = mesh.vertexData;
+        data.indexData = mesh.indexData;
+        data.indexType = mesh.indexType;
+        data.boundsMin = mesh.boundsMin;
+        data.boundsScale = mesh.boundsScale;
+    } else {
+        // Position and normal are interleaved in the arena.
+        data.vertexData.resize(vertexCount * 6 * sizeof(GLfloat));
+        GLfloat *vertex = reinterpret_cast<GLfloat *>(data.vertexData.data());
+        for (int i = 0; i < vertexCount; ++i, vertex += 6) {
+            for (int c = 0; c < 3; ++c) {
+                vertex[c] = positions.data[3 * i + c];
+                vertex[3 + c] = hasNormals ? normals.data[3 * i + c] : 0.0f;
+            }
+        }
+        // Copied, the data may outlive objectModel.
+        data.indexData = QByteArray(reinterpret_cast<const char *>(indices.data), indices.size * sizeof(GLuint));
+        data.indexType = GL_UNSIGNED_INT;
+    }
+    data.levelCount = objectModel.levelCount();
+    data.subMeshes.resize(objectModel.subMeshCount() * data.levelCount);
+    std::copy(objectModel.subMeshData(), objectModel.subMeshData() + data.subMeshes.size(), data.subMeshes.begin());
+
+    // Centered on the bounding box, not minimal but good enough for
+    // estimating the size on screen.
+    QVector3D minimum, maximum;
+    for (int i = 0; i < vertexCount; ++i) {
+        const QVector3D p(positions.data[3 * i], positions.data[3 * i + 1], positions.data[3 * i + 2]);
+        for (int c = 0; c < 3; ++c) {
+            minimum[c] = i == 0 ? p[c] : qMin(minimum[c], p[c]);
+            maximum[c] = i == 0 ? p[c] : qMax(maximum[c], p[c]);
+        }
+    }
+    data.sphereCenter = (minimum + maximum) / 2.0f;
+    for (int i = 0; i < vertexCount; ++i) {
+        const QVector3D p(positions.data[3 * i], positions.data[3 * i + 1], positions.data[3 * i + 2]);
+        data.sphereRadius = qMax(data.sphereRadius, (p - data.sphereCenter).length());
+    }
+    return data;
+}
+
+int ModelRegistry::addModel(const ObjectModelRenerable &objectModel)
+{
+    return addModel(prepareModel(objectModel, m_format));
+}
+
+// Reserves room for data at the end of the arena and registers the model,
+// the caller fills in the buffers. Needs our VAO to be bound.
+int ModelRegistry::placeModel(const ModelData &data)
+{
+    detachSharedBuffers(true);
+
+    Model model;
+    model.vertexCount = data.vertexCount;
+    model.indexType = data.indexType;
+    model.boundsMin = data.boundsMin;
+    model.boundsScale = data.boundsScale;
+    model.sphereCenter = data.sphereCenter;
+    model.sphereRadius = data.sphereRadius;
+
+    const int indexOffset = (m_indexBytes + 3) & ~3;
+    reserve(m_vertexBuffer, &m_vertexCapacity, m_vertexBytes, m_vertexBytes + data.vertexData.size());
+    reserve(m_indexBuffer, &m_indexCapacity, m_indexBytes, indexOffset + data.indexData.size());
+
+    model.baseVertex = m_vertexBytes / vertexStride();
+    const int indexSize = model.indexType == GL_UNSIGNED_SHORT ? sizeof(GLushort) : sizeof(GLuint);
+    model.indexOffset = indexOffset;
+    model.indexCount = data.indexData.size() / indexSize;
+    const int subMeshCount = data.subMeshes.size() / data.levelCount;
+    model.baseVertices.fill(model.baseVertex, subMeshCount);
+    model.levels.resize(data.levelCount);
+    for (int i = 0; i < data.subMeshes.size(); ++i) {
+        const SubMesh &subMesh = data.subMeshes.at(i);
+        Model::Level &level = model.levels[i / subMeshCount];
+        level.indexCounts.append(subMesh.indexCount);
+        level.indexOffsets.append(reinterpret_cast<const void *>(qintptr(indexOffset + subMesh.firstIndex * indexSize)));
+        level.triangleCount += subMesh.indexCount / 3;
+    }
+
+    m_vertexBytes += data.vertexData.size();
+    m_indexBytes = indexOffset + data.indexData.size();
+    setupVertexArray();
+
+    m_models.append(model);
+    return m_models.size() - 1;
+}
+
+int ModelRegistry::addModel(const ModelData &data, QOpenGLBuffer *vertexSource, QOpenGLBuffer *indexSource)
+{
+    if (data.format != m_format) {
+        qWarning("ModelRegistry: model data was prepared for another vertex format");
+        return -1;
+    }
+
+    // Index buffer bindings are VAO state, keep them in our own VAO.
+    QOpenGLVertexArrayObject::Binder vaoBinder(&m_vao);
+    const int modelId = placeModel(data);
+    Model &model = m_models[modelId];
+    const int vertexOffset = model.baseVertex * vertexStride();
+    if (vertexSource && indexSource) {
+        copyBuffer(*vertexSource, m_vertexBuffer, vertexOffset, data.vertexData.size());
+        copyBuffer(*indexSource, m_indexBuffer, model.indexOffset, data.indexData.size());
+    } else {
+        m_vertexBuffer.bind();
+        m_vertexBuffer.write(vertexOffset, data.vertexData.constData(), data.vertexData.size());
+        m_indexBuffer.bind();
+        m_indexBuffer.write(model.indexOffset, data.indexData.constData(), data.indexData.size());
+    }
+    model.uploadedIndexCount = model.indexCount;
+    return modelId;
+}
+
+int ModelRegistry::addModelProgressive(const ModelData &data)
+{
+    if (data.format != m_format) {
+        qWarning("ModelRegistry: model data was prepared for another vertex format");
+        return -1;
+    }
+
+    QOpenGLVertexArrayObject::Binder vaoBinder(&m_vao);
+    PendingUpload upload;
+    upload.modelId = placeModel(data);
+    // Shares the arrays with data, nothing is copied on the CPU.
+    upload.data = data;
+    m_uploads.append(upload);
+    return upload.modelId;
+}
+
+// The ranges written here are not drawn from yet, so the driver need not
+// synchronize with the GPU. Falls back to glBufferSubData where mapping
+// is not supported.
+void ModelRegistry::writeRange(QOpenGLBuffer &buffer, int offset, const char *data, int size)
+{
+    buffer.bind();
+    void *mapped = buffer.mapRange(offset, size, QOpenGLBuffer::RangeWrite | QOpenGLBuffer::RangeInvalidate
+                                   | QOpenGLBuffer::RangeUnsynchronized);
+    if (mapped) {
+        memcpy(mapped, data, size);
+        buffer.unmap();
+    } else {
+        buffer.write(offset, data, size);
+    }
+}
+
+// Indices go up in chunks, each after the vertices it refers to. Meshes
+// reordered for vertex fetch (see MeshOptimizer) use their vertices in
+// order, so those follow the indices closely and the model fills in
+// from the first chunk on.
+bool ModelRegistry::uploadPending(int byteBudget)
+{
+    if (m_uploads.isEmpty())
+        return false;
+
+    QOpenGLVertexArrayObject::Binder vaoBinder(&m_vao);
+    while (!m_uploads.isEmpty() && byteBudget > 0) {
+        PendingUpload &upload = m_uploads.first();
+        Model &model = m_models[upload.modelId];
+        const ModelData &data = upload.data;
+        const int stride = vertexStride();
+        const int vertexOffset = model.baseVertex * stride;
+        const int indexSize = model.indexType == GL_UNSIGNED_SHORT ? sizeof(GLushort) : sizeof(GLuint);
+
+        int requiredVertexBytes = data.vertexData.size();
+        int chunkEnd = model.indexCount;
+        if (upload.indexCount < model.indexCount) {
+            const int chunkSize = qMax(3, byteBudget / 2 / indexSize / 3 * 3);
+            chunkEnd = qMin(model.indexCount, upload.indexCount + chunkSize);
+            GLuint maxIndex = 0;
+            for (int i = upload.indexCount; i < chunkEnd; ++i) {
+                const GLuint index = indexSize == sizeof(GLushort)
+                        ? reinterpret_cast<const GLushort *>(data.indexData.constData())[i]
+                        : reinterpret_cast<const GLuint *>(data.indexData.constData())[i];
+                maxIndex = qMax(maxIndex, index);
+            }
+            requiredVertexBytes = qMax(upload.vertexBytes, int(maxIndex + 1) * stride);
+        }
+
+        if (upload.vertexBytes < requiredVertexBytes) {
+            const int size = qMin(requiredVertexBytes - upload.vertexBytes, byteBudget);
+            writeRange(m_vertexBuffer, vertexOffset + upload.vertexBytes,
+                       data.vertexData.constData() + upload.vertexBytes, size);
+            upload.vertexBytes += size;
+            byteBudget -= size;
+            if (upload.vertexBytes < requiredVertexBytes)
+                break;
+        }
+
+        if (upload.indexCount < model.indexCount) {
+            const int size = (chunkEnd - upload.indexCount) * indexSize;
+            writeRange(m_indexBuffer, model.indexOffset + upload.indexCount * indexSize,
+                       data.indexData.constData() + upload.indexCount * indexSize, size);
+            upload.indexCount = chunkEnd;
+            model.uploadedIndexCount = chunkEnd;
+            byteBudget -= size;
+        }
+
+        if (model.isUploaded() && upload.vertexBytes == data.vertexData.size())
+            m_uploads.removeFirst();
+    }
+    return !m_uploads.isEmpty();
+}
+
+qint64 ModelRegistry::modelGpuBytes(int modelId) const
+{
+    const Model &model = m_models.at(modelId);
+    const int indexSize = model.indexType == GL_UNSIGNED_SHORT ? sizeof(GLushort) : sizeof(GLuint);
+    return qint64(model.vertexCount) * vertexStride() + qint64(model.indexCount) * indexSize;
+}
+
+qint64 ModelRegistry::modelCpuBytes(int modelId) const
+{
+    for (const PendingUpload &upload : m_uploads) {
+        if (upload.modelId == modelId)
+            return upload.data.cpuBytes();
+    }
+    return 0;
+}
+
+void ModelRegistry::setupVertexArray()
+{
+    m_vertexBuffer.bind();
+    glEnableVertexAttribArray(PROGRAM_VERTEX_ATTRIBUTE);
+    glEnableVertexAttribArray(PROGRAM_NORMAL_ATTRIBUTE);
+    if (m_format == VertexFormat::Packed) {
+        glVertexAttribPointer(PROGRAM_VERTEX_ATTRIBUTE, 3, GL_UNSIGNED_SHORT, GL_TRUE, PackedMesh::VertexStride,
+                              reinterpret_cast<void *>(PackedMesh::PositionOffset));
+        glVertexAttribPointer(PROGRAM_NORMAL_ATTRIBUTE, 2, GL_SHORT, GL_TRUE, PackedMesh::VertexStride,
+                              reinterpret_cast<void *>(PackedMesh::NormalOffset));
+    } else {
+        glVertexAttribPointer(PROGRAM_VERTEX_ATTRIBUTE, 3, GL_FLOAT, GL_FALSE, 6 * sizeof(GLfloat), 0);
+        glVertexAttribPointer(PROGRAM_NORMAL_ATTRIBUTE, 3, GL_FLOAT, GL_FALSE, 6 * sizeof(GLfloat),
+                              reinterpret_cast<void *>(3 * sizeof(GLfloat)));
+    }
+    m_indexBuffer.bind();
+}
+
+void ModelRegistry::bind()
+{
+    if (m_vao.isCreated())
+        m_vao.bind();
+    else
+        setupVertexArray();
+}
+
+void ModelRegistry::release()
+{
+    if (m_vao.isCreated())
+        m_vao.release();
+}
+
+// Level 0 comes first in the index data, so the uploaded prefix is
+// always part of the full mesh.
+void ModelRegistry::drawUploadedPrefix(const Model &model, int instanceCount)
+{
+    const Model::Level &lod = model.levels.first();
+    const int indexSize = model.indexType == GL_UNSIGNED_SHORT ? sizeof(GLushort) : sizeof(GLuint);
+    for (int i = 0; i < lod.indexCounts.size(); ++i) {
+        const int firstIndex = int((qintptr(lod.indexOffsets.at(i)) - model.indexOffset) / indexSize);
+        const GLsizei count = qBound(0, model.uploadedIndexCount - firstIndex, int(lod.indexCounts.at(i)));
+        if (count == 0)
+            continue;
+        if (instanceCount > 0) {
+            glDrawElementsInstancedBaseVertex(GL_TRIANGLES, count, model.indexType, lod.indexOffsets.at(i),
+                                              instanceCount, model.baseVertices.at(i));
+        } else {
+            glDrawElementsBaseVertex(GL_TRIANGLES, count, model.indexType, lod.indexOffsets.at(i),
+                                     model.baseVertices.at(i));
+        }
+    }
+}
+
+void ModelRegistry::drawModel(int modelId, int level)
+{
+    const Model &model = m_models.at(modelId);
+    if (!model.isUploaded()) {
+        drawUploadedPrefix(model, 0);
+        return;
+    }
+    const Model::Level &lod = model.levels.at(level);
+    if (m_multiDrawElementsBaseVertex) {
+        m_multiDrawElementsBaseVertex(GL_TRIANGLES, lod.indexCounts.constData(), model.indexType,
+                                      lod.indexOffsets.constData(), lod.indexCounts.size(),
+                                      model.baseVertices.constData());
+        return;
+    }
+    for (int i = 0; i < lod.indexCounts.size(); ++i) {
+        glDrawElementsBaseVertex(GL_TRIANGLES, lod.indexCounts.at(i), model.indexType,
+                                 lod.indexOffsets.at(i), model.baseVertices.at(i));
+    }
+}
+
+void ModelRegistry::drawModelInstanced(int modelId, int instanceCount, int level)
+{
+    const Model &model = m_models.at(modelId);
+    if (!model.isUploaded()) {
+        drawUploadedPrefix(model, instanceCount);
+        return;
+    }
+    const Model::Level &lod = model.levels.at(level);
+    for (int i = 0; i < lod.indexCounts.size(); ++i) {
+        glDrawElementsInstancedBaseVertex(GL_TRIANGLES, lod.indexCounts.at(i), model.indexType,
+                                          lod.indexOffsets.at(i), instanceCount, model.baseVertices.at(i));
+    }
+}
@@ -0,0 +1,214 @@
+/****************************************************************************
+**
+** Copyright (C) 2016 The Qt Company Ltd.
+** Contact: https://www.qt.io/licensing/
+**
+** This file is part of the examples of the Qt Toolkit.
+**
+** $QT_BEGIN_LICENSE:BSD$
+** Commercial License Usage
+** Licensees holding valid commercial Qt licenses may use this file in
+** accordance with the commercial license agreement provided with the
+** Software or, alternatively, in accordance with the terms contained in
+** a written agreement between you and The Qt Company. For licensing terms
+** and conditions see https://www.qt.io/terms-conditions. For further
+** information use the contact form at https://www.qt.io/contact-us.
+**
+** BSD License Usage
+** Alternatively, you may use this file under the terms of the BSD license
+** as follows:
+**
+** "Redistribution and use in source and binary forms, with or without
+** modification, are permitted provided that the following conditions are
+** met:
+**   * Redistributions of source code must retain the above copyright
+**     notice, this list of conditions and the following disclaimer.
+**   * Redistributions in binary form must reproduce the above copyright
+**     notice, this list of conditions and the following disclaimer in
+**     the documentation and/or other materials provided with the
+**     distribution.
+**   * Neither the name of The Qt Company Ltd nor the names of its
+**     contributors may be used to endorse or promote products derived
+**     from this software without specific prior written permission.
+**
+**
+** THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+** "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+** LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+** A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+** OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+** SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+** LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+** DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+** THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+** (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+** OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE."
+**
+** $QT_END_LICENSE$
+**
+****************************************************************************/
+
+#ifndef MODELREGISTRY_H
+#define MODELREGISTRY_H
+
+#include "objectmodelrenderable.h"
+#include "packedmesh.h"
+
+#include <QOpenGLExtraFunctions>
+#include <QOpenGLBuffer>
+#include <QOpenGLVertexArrayObject>
+#include <QVector>
+#include <QVector3D>
+
+// Holds every mesh of any number of models in one vertex and one index
+// buffer. Models are appended to the buffers and remembered by their
+// offsets, so drawing any of them only needs the single VAO of the
+// registry and one multi-draw call per model, with a base vertex instead
+// of rebinding buffers.
+class ModelRegistry : protected QOpenGLExtraFunctions
+{
+public:
+    struct Model
+    {
+        GLint baseVertex = 0;
+        int vertexCount = 0;
+        GLenum indexType = GL_UNSIGNED_INT;
+        // Packed vertices decode as boundsMin + unorm * boundsScale.
+        QVector3D boundsMin;
+        QVector3D boundsScale;
+        // Encloses the model, for picking a level of detail.
+        QVector3D sphereCenter;
+        float sphereRadius = 0.0f;
+        // From the full mesh on, one entry per sub mesh in each, laid out
+        // for glMultiDrawElementsBaseVertex.
+        struct Level
+        {
+            QVector<GLsizei> indexCounts;
+            QVector<const void *> indexOffsets;
+            int triangleCount = 0;
+        };
+        QVector<Level> levels;
+        QVector<GLint> baseVertices;
+        // Byte offset of the indices in the arena, and how many of them
+        // are there. While a progressive upload is running only the
+        // uploaded prefix of the full mesh is drawn.
+        int indexOffset = 0;
+        int indexCount = 0;
+        int uploadedIndexCount = 0;
+
+        bool isUploaded() const { return uploadedIndexCount == indexCount; }
+    };
+
+    // Everything addModel() needs from the CPU, in the layout of the
+    // arena. Preparing it needs no context and may happen on any thread.
+    struct ModelData
+    {
+        VertexFormat format = VertexFormat::Float32;
+        int vertexCount = 0;
+        QByteArray vertexData;
+        QByteArray indexData;
+        GLenum indexType = GL_UNSIGNED_INT;
+        QVector3D boundsMin;
+        QVector3D boundsScale;
+        QVector3D sphereCenter;
+        float sphereRadius = 0.0f;
+        // All levels of detail, one after the other.
+        QVector<SubMesh> subMeshes;
+        int levelCount = 1;
+
+        // Drops the arrays, sizes and bounds stay.
+        void releaseCpuData()
+        {
+            vertexData = QByteArray();
+            indexData = QByteArray();
+        }
+        qint64 cpuBytes() const { return vertexData.size() + indexData.size(); }
+    };
+
+    explicit ModelRegistry(VertexFormat format = VertexFormat::Float32);
+    ~ModelRegistry();
+
+    // Everything below needs the context of the registry to be current.
+    void create();
+    void destroy();
+    void clear();
+    // Drops all models, the ones added afterwards use format.
+    void setVertexFormat(VertexFormat format);
+    // Drops our models and draws the ones of source instead, straight out
+    // of its buffers, through a VAO of our own. The contexts have to
+    // share and source must not add models while we draw, growing its
+    // arena replaces the buffers. Adding a model here copies the shared
+    // ones into buffers of our own first.
+    bool shareModels(const ModelRegistry &source);
+    bool sharesBuffers() const { return m_sharedBuffers; }
+
+    static ModelData prepareModel(const ObjectModelRenerable &model, VertexFormat format);
+
+    // Appends all meshes of model to the buffers, returns its id.
+    int addModel(const ObjectModelRenerable &model);
+    // Returns -1 if data was prepared for another format. With source
+    // buffers, data was already uploaded into them from a context sharing
+    // with ours and is only copied on the GPU.
+    int addModel(const ModelData &data, QOpenGLBuffer *vertexSource = nullptr, QOpenGLBuffer *indexSource = nullptr);
+    // Only reserves room for the model, uploadPending() then fills it in
+    // over several frames. The model can be drawn right away and shows
+    // the triangles uploaded so far.
+    int addModelProgressive(const ModelData &data);
+    // Writes up to about byteBudget bytes of pending models through
+    // mapped buffer ranges. Returns whether uploads are left.
+    bool uploadPending(int byteBudget);
+    int pendingUploadCount() const { return m_uploads.size(); }
+
+    // Bytes a model takes in the arena, and CPU bytes kept until its
+    // progressive upload is done.
+    qint64 modelGpuBytes(int modelId) const;
+    qint64 modelCpuBytes(int modelId) const;
+    // Allocated size of both buffers, including room not used yet.
+    qint64 arenaBytes() const { return qint64(m_vertexCapacity) + m_indexCapacity; }
+    int modelCount() const { return m_models.size(); }
+    const Model &model(int modelId) const { return m_models.at(modelId); }
+    VertexFormat vertexFormat() const { return m_format; }
+
+    // Drawing has to happen between bind() and release().
+    void bind();
+    void release();
+    void drawModel(int modelId, int level = 0);
+    void drawModelInstanced(int modelId, int instanceCount, int level = 0);
+
+private:
+    typedef void (QOPENGLF_APIENTRYP MultiDrawElementsBaseVertex)(GLenum mode, const GLsizei *count, GLenum type,
+                                                                  const void *const *indices, GLsizei drawcount,
+                                                                  const GLint *basevertex);
+
+    struct PendingUpload
+    {
+        int modelId;
+        ModelData data;
+        int vertexBytes = 0;
+        int indexCount = 0;
+    };
+
+    int placeModel(const ModelData &data);
+    void writeRange(QOpenGLBuffer &buffer, int offset, const char *data, int size);
+    void drawUploadedPrefix(const Model &model, int instanceCount);
+    void copyBuffer(QOpenGLBuffer &source, QOpenGLBuffer &destination, int offset, int size);
+    void reserve(QOpenGLBuffer &buffer, int *capacity, int used, int required);
+    void detachSharedBuffers(bool keepModels);
+    void setupVertexArray();
+    int vertexStride() const;
+
+    VertexFormat m_format;
+    QOpenGLVertexArrayObject m_vao;
+    QOpenGLBuffer m_vertexBuffer;
+    QOpenGLBuffer m_indexBuffer;
+    int m_vertexCapacity = 0;
+    int m_vertexBytes = 0;
+    int m_indexCapacity = 0;
+    int m_indexBytes = 0;
+    QVector<Model> m_models;
+    QVector<PendingUpload> m_uploads;
+    bool m_sharedBuffers = false;
+    MultiDrawElementsBaseVertex m_multiDrawElementsBaseVertex = nullptr;
+};
+
+#endif // MODELREGISTRY_H
@@ -49,25 +49,235 @@
 ****************************************************************************/
 
 #include "objectmodelrenderable.h"
+#include "meshcache.h"
+#include "meshoptimizer.h"
+#include "meshsimplifier.h"
+#include "profiler.h"
 #include <assimp/postprocess.h>
 #include <assimp/Importer.hpp>
 #include <qmath.h>
+#include <QDebug>
+#include <algorithm>
 
-ObjectModelRenerable::ObjectModelRenerable(const QString &objectModel)
+// Tangents used to be computed as well, but nothing ever read them.
+const unsigned int ObjectModelRenerable::ImportFlags = aiProcess_GenSmoothNormals |
+                                                       aiProcess_Triangulate |
+                                                       aiProcess_JoinIdenticalVertices |
+                                                       aiProcess_SortByPType;
+
+ObjectModelRenerable::ObjectModelRenerable(const QString &objectModel, bool useCache, bool optimizeIndices)
 {
+    ProfileScope profile("model load");
+    const QByteArray cacheKey = useCache ? MeshCache::key(objectModel, ImportFlags, optimizeIndices) : QByteArray();
+    if (!cacheKey.isEmpty()) {
+        m_cache = MeshCache::map(cacheKey);
+        if (m_cache.isValid())
+            return;
+    }
+
     Assimp::Importer importer;
-    const aiScene* scene = importer.ReadFile(objectModel.toStdString(),
-                                             aiProcess_GenSmoothNormals |
-                                             aiProcess_CalcTangentSpace |
-                                             aiProcess_Triangulate |
-                                             aiProcess_JoinIdenticalVertices |
-                                             aiProcess_SortByPType
-                                             );
-    processMesh(scene->mMeshes[0]);
+    const aiScene* scene = importer.ReadFile(objectModel.toStdString(), ImportFlags);
+    if (!scene || scene->mNumMeshes == 0) {
+        qWarning() << "Could not load object model" << objectModel << importer.GetErrorString();
+        return;
+    }
+    bool hasNormals = false;
+    for (uint i = 0; i < scene->mNumMeshes; ++i)
+        hasNormals |= scene->mMeshes[i]->HasNormals();
+    for (uint i = 0; i < scene->mNumMeshes; ++i)
+        processMesh(scene->mMeshes[i], hasNormals);
+    generateLevels();
+    if (optimizeIndices)
+        this->optimizeIndices(objectModel);
+
+    if (!cacheKey.isEmpty()) {
+        MeshCache::store(cacheKey, m_vertices.constData(),
+                         m_normals.isEmpty() ? nullptr : m_normals.constData(),
+                         m_vertices.size() / 3, m_indices.constData(), m_indices.size(),
+                         m_subMeshes.constData(), m_subMeshes.size(), m_levelCount);
+    }
+}
+
+ObjectModelRenerable::ObjectModelRenerable(const QVector<GLfloat> &vertices, const QVector<GLfloat> &normals,
+                                           const QVector<GLuint> &indices)
+    : m_vertices(vertices),
+      m_normals(normals),
+      m_indices(indices)
+{
+    SubMesh subMesh;
+    subMesh.firstIndex = 0;
+    subMesh.indexCount = quint32(indices.size());
+    m_subMeshes.push_back(subMesh);
+}
+
+void ObjectModelRenerable::releaseCpuData()
+{
+    // Swapping with empty arrays frees the memory, clear() would keep it
+    // reserved.
+    QVector<GLfloat>().swap(m_vertices);
+    QVector<GLfloat>().swap(m_normals);
+    QVector<GLuint>().swap(m_indices);
+    QVector<SubMesh>().swap(m_subMeshes);
+    m_levelCount = 1;
+    m_cache = MeshCacheMapping();
+}
+
+qint64 ObjectModelRenerable::cpuBytes() const
+{
+    return qint64(m_vertices.capacity() + m_normals.capacity()) * sizeof(GLfloat)
+            + qint64(m_indices.capacity()) * sizeof(GLuint)
+            + qint64(m_subMeshes.capacity()) * sizeof(SubMesh);
+}
+
+qint64 ObjectModelRenerable::mappedBytes() const
+{
+    return m_cache.isValid() ? m_cache.file->size() : 0;
+}
+
+QVector<GLfloat> ObjectModelRenerable::getVertices() const
+{
+    if (!m_cache.isValid())
+        return m_vertices;
+    QVector<GLfloat> vertices(verticesCount());
+    std::copy(m_cache.vertices, m_cache.vertices + vertices.size(), vertices.begin());
+    return vertices;
+}
+
+QVector<GLfloat> ObjectModelRenerable::getNormals() const
+{
+    if (!m_cache.isValid())
+        return m_normals;
+    QVector<GLfloat> normals(normalsCount());
+    if (m_cache.normals)
+        std::copy(m_cache.normals, m_cache.normals + normals.size(), normals.begin());
+    return normals;
+}
+
+QVector<GLuint> ObjectModelRenerable::getIndices() const
+{
+    if (!m_cache.isValid())
+        return m_indices;
+    QVector<GLuint> indices(indicesCount());
+    std::copy(m_cache.indices, m_cache.indices + indices.size(), indices.begin());
+    return indices;
+}
+
+const GLfloat *ObjectModelRenerable::vertexData() const
+{
+    return m_cache.isValid() ? m_cache.vertices : m_vertices.constData();
+}
+
+const GLfloat *ObjectModelRenerable::normalData() const
+{
+    return m_cache.isValid() ? m_cache.normals : m_normals.constData();
+}
+
+const GLuint *ObjectModelRenerable::indexData() const
+{
+    return m_cache.isValid() ? m_cache.indices : m_indices.constData();
+}
+
+int ObjectModelRenerable::verticesCount() const
+{
+    return m_cache.isValid() ? m_cache.vertexCount * 3 : m_vertices.size();
+}
+
+int ObjectModelRenerable::normalsCount() const
+{
+    if (m_cache.isValid())
+        return m_cache.normals ? m_cache.vertexCount * 3 : 0;
+    return m_normals.size();
+}
+
+int ObjectModelRenerable::indicesCount() const
+{
+    return m_cache.isValid() ? m_cache.indexCount : m_indices.size();
 }
 
-void ObjectModelRenerable::processMesh(aiMesh *mesh)
+const SubMesh *ObjectModelRenerable::subMeshData(int level) const
 {
+    const SubMesh *subMeshes = m_cache.isValid() ? m_cache.subMeshes : m_subMeshes.constData();
+    return subMeshes + level * subMeshCount();
+}
+
+int ObjectModelRenerable::subMeshCount() const
+{
+    if (m_cache.isValid())
+        return m_cache.subMeshCount / m_cache.levelCount;
+    return m_subMeshes.size() / m_levelCount;
+}
+
+int ObjectModelRenerable::levelCount() const
+{
+    return m_cache.isValid() ? m_cache.levelCount : m_levelCount;
+}
+
+// Appends decimated copies of all sub meshes to the indices, until a
+// level hardly gets smaller than the one before.
+void ObjectModelRenerable::generateLevels()
+{
+    static const int MinimumTriangleCount = 64;
+
+    const int subMeshCount = m_subMeshes.size();
+    const int vertexCount = m_vertices.size() / 3;
+    int previousIndexCount = m_indices.size();
+    while (m_levelCount < MaxLevelCount && previousIndexCount / 3 > MinimumTriangleCount) {
+        const int previousLevel = (m_levelCount - 1) * subMeshCount;
+        QVector<SubMesh> level;
+        QVector<GLuint> levelIndices;
+        for (int i = 0; i < subMeshCount; ++i) {
+            const SubMesh &source = m_subMeshes.at(previousLevel + i);
+            const QVector<GLuint> simplified = MeshSimplifier::simplify(
+                        m_vertices.constData(), vertexCount,
+                        m_indices.constData() + source.firstIndex, source.indexCount,
+                        source.indexCount / 2);
+            SubMesh subMesh;
+            subMesh.firstIndex = m_indices.size() + levelIndices.size();
+            subMesh.indexCount = simplified.size();
+            levelIndices += simplified;
+            level.push_back(subMesh);
+        }
+        if (levelIndices.size() > previousIndexCount * 9 / 10)
+            break;
+
+        m_indices += levelIndices;
+        m_subMeshes += level;
+        previousIndexCount = levelIndices.size();
+        ++m_levelCount;
+    }
+}
+
+// Assimp keeps the face order of the file, which for scanned and CAD
+// meshes tends to jump all over the model. Every level of every sub mesh
+// is reordered on its own, the vertices then follow the full mesh.
+void ObjectModelRenerable::optimizeIndices(const QString &objectModel)
+{
+    ProfileScope profile("index optimization");
+    const int vertexCount = m_vertices.size() / 3;
+    // The full mesh comes first, the ACMR is reported for it.
+    const SubMesh &lastSubMesh = m_subMeshes.at(subMeshCount() - 1);
+    const int fullIndexCount = lastSubMesh.firstIndex + lastSubMesh.indexCount;
+    const float acmrBefore = MeshOptimizer::acmr(m_indices.constData(), fullIndexCount, vertexCount);
+
+    for (const SubMesh &subMesh : qAsConst(m_subMeshes)) {
+        GLuint *indices = m_indices.data() + subMesh.firstIndex;
+        MeshOptimizer::optimizeVertexCache(indices, subMesh.indexCount, vertexCount);
+        MeshOptimizer::optimizeOverdraw(indices, subMesh.indexCount, m_vertices.constData(), vertexCount);
+    }
+    MeshOptimizer::optimizeVertexFetch(m_vertices, m_normals, m_indices);
+
+    const float acmrAfter = MeshOptimizer::acmr(m_indices.constData(), fullIndexCount, vertexCount);
+    qInfo().nospace() << "Optimized " << objectModel << ", ACMR " << acmrBefore << " -> " << acmrAfter;
+}
+
+// Appends mesh to the vertices and indices of the model. Indices refer to
+// the vertices of the whole model, not just the ones of mesh.
+void ObjectModelRenerable::processMesh(aiMesh *mesh, bool withNormals)
+{
+    const GLuint firstVertex = m_vertices.size() / 3;
+    SubMesh subMesh;
+    subMesh.firstIndex = m_indices.size();
+
     // Get Vertices
     if (mesh->mNumVertices > 0)
     {
@@ -81,7 +291,8 @@ void ObjectModelRenerable::processMesh(aiMesh *mesh)
         }
     }
 
-    // Get Normals
+    // Get Normals, meshes without any get zero normals so the normals of
+    // the model stay aligned with its vertices.
     if (mesh->HasNormals())
     {
         for (uint ii = 0; ii < mesh->mNumVertices; ++ii)
@@ -92,6 +303,10 @@ void ObjectModelRenerable::processMesh(aiMesh *mesh)
             m_normals.push_back(vec.z);
         };
     }
+    else if (withNormals)
+    {
+        m_normals.insert(m_normals.size(), 3 * mesh->mNumVertices, 0.0f);
+    }
 
     // Get mesh indexes
     for (uint t = 0; t < mesh->mNumFaces; ++t)
@@ -102,9 +317,11 @@ void ObjectModelRenerable::processMesh(aiMesh *mesh)
             continue;
         }
 
-        m_indices.push_back(face->mIndices[0]);
-        m_indices.push_back(face->mIndices[1]);
-        m_indices.push_back(face->mIndices[2]);
+        m_indices.push_back(firstVertex + face->mIndices[0]);
+        m_indices.push_back(firstVertex + face->mIndices[1]);
+        m_indices.push_back(firstVertex + face->mIndices[2]);
     }
 
+    subMesh.indexCount = m_indices.size() - subMesh.firstIndex;
+    m_subMeshes.push_back(subMesh);
 }
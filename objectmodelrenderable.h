@@ -51,6 +51,8 @@
 #ifndef LOGO_H
 #define LOGO_H
 
+#include "meshcache.h"
+
 #include <assimp/mesh.h>
 #include <assimp/scene.h>
 
@@ -59,23 +61,80 @@
 #include <QVector3D>
 #include <QString>
 
+// A read-only view of contiguous mesh data. Valid as long as the model
+// it came from is alive and has not released its CPU data.
+template <typename T>
+struct MeshSpan
+{
+    MeshSpan(const T *data = nullptr, int size = 0) : data(data), size(size) {}
+
+    const T *data;
+    int size;
+
+    const T *begin() const { return data; }
+    const T *end() const { return data + size; }
+    bool isEmpty() const { return size == 0; }
+};
+
 class ObjectModelRenerable
 {
 public:
-    ObjectModelRenerable(const QString &objectModel);
-    QVector<GLfloat> getVertices() { return m_vertices; }
-    QVector<GLfloat> getNormals() { return m_normals; }
-    QVector<GLuint> getIndices() { return m_indices; }
-    int verticesCount() const { return m_vertices.size(); }
-    int normalsCount() const { return m_normals.size(); }
-    int indicesCount() const { return m_indices.size(); }
+    // Flags the model is imported with, part of the mesh cache key.
+    static const unsigned int ImportFlags;
+    // Imported models get up to this many levels of detail, each with
+    // about half the triangles of the previous one.
+    static const int MaxLevelCount = 5;
+
+    // Unless useCache is false the processed mesh is mapped from the
+    // MeshCache, and only imported (and then cached) if it is not in there.
+    // Unless optimizeIndices is false imported meshes are reordered for
+    // the vertex cache and against overdraw, see MeshOptimizer.
+    ObjectModelRenerable(const QString &objectModel, bool useCache = true, bool optimizeIndices = true);
+    // A single mesh from memory, e.g. a synthetic one. normals may be empty.
+    ObjectModelRenerable(const QVector<GLfloat> &vertices, const QVector<GLfloat> &normals,
+                         const QVector<GLuint> &indices);
+    // Copies, prefer the spans below for reading.
+    QVector<GLfloat> getVertices() const;
+    QVector<GLfloat> getNormals() const;
+    // Indices of all levels of detail, see subMeshData().
+    QVector<GLuint> getIndices() const;
+    // The same without copying, out of the cache mapping or the arrays.
+    MeshSpan<GLfloat> vertexSpan() const { return MeshSpan<GLfloat>(vertexData(), verticesCount()); }
+    MeshSpan<GLfloat> normalSpan() const { return MeshSpan<GLfloat>(normalData(), normalsCount()); }
+    MeshSpan<GLuint> indexSpan() const { return MeshSpan<GLuint>(indexData(), indicesCount()); }
+    // Raw data for uploading, without copying it out of the cache mapping.
+    const GLfloat *vertexData() const;
+    const GLfloat *normalData() const;
+    const GLuint *indexData() const;
+    int verticesCount() const;
+    int normalsCount() const;
+    int indicesCount() const;
+    // One entry per mesh of the model file, in file order. Level 0 is the
+    // mesh as imported, the coarser levels are decimated versions of it
+    // that index the same vertices.
+    const SubMesh *subMeshData(int level = 0) const;
+    int subMeshCount() const;
+    int levelCount() const;
+    bool isCached() const { return m_cache.isValid(); }
+
+    // Frees the arrays, or unmaps the cache entry, once the model has
+    // been uploaded. The model is empty afterwards.
+    void releaseCpuData();
+    // Bytes of the arrays on the heap, and of the mapped cache entry.
+    qint64 cpuBytes() const;
+    qint64 mappedBytes() const;
 
 private:
-    void processMesh(aiMesh *mesh);
+    void processMesh(aiMesh *mesh, bool withNormals);
+    void generateLevels();
+    void optimizeIndices(const QString &objectModel);
 
     QVector<GLfloat> m_vertices;
     QVector<GLfloat> m_normals;
     QVector<GLuint> m_indices;
+    QVector<SubMesh> m_subMeshes;
+    int m_levelCount = 1;
+    MeshCacheMapping m_cache;
 };
 
 #endif // LOGO_H
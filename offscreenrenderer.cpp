@@ -0,0 +1,459 @@
+/****************************************************************************
+**
+** Copyright (C) 2016 The Qt Company Ltd.
+** Contact: https://www.qt.io/licensing/
+**
+** This file is part of the examples of the Qt Toolkit.
+**
+** $QT_BEGIN_LICENSE:BSD$
+** Commercial License Usage
+** Licensees holding valid commercial Qt licenses may use this file in
+** accordance with the commercial license agreement provided with the
+** Software or, alternatively, in accordance with the terms contained in
+** a written agreement between you and The Qt Company. For licensing terms
+** and conditions see https://www.qt.io/terms-conditions. For further
+** information use the contact form at https://www.qt.io/contact-us.
+**
+** BSD License Usage
+** Alternatively, you may use this file under the terms of the BSD license
+** as follows:
+**
+** "Redistribution and use in source and binary forms, with or without
+** modification, are permitted provided that the following conditions are
+** met:
+**   * Redistributions of source code must retain the above copyright
+**     notice, this list of conditions and the following disclaimer.
+**   * Redistributions in binary form must reproduce the above copyright
+**     notice, this list of conditions and the following disclaimer in
+**     the documentation and/or other materials provided with the
+**     distribution.
+**   * Neither the name of The Qt Company Ltd nor the names of its
+**     contributors may be used to endorse or promote products derived
+**     from this software without specific prior written permission.
+**
+**
+** THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+** "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+** LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+** A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+** OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+** SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+** LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+** DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+** THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+** (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+** OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE."
+**
+** $QT_END_LICENSE$
+**
+****************************************************************************/
+
+#include "offscreenrenderer.h"
+#include "backgroundbandreader.h"
+#include "profiler.h"
+
+#include <QOffscreenSurface>
+#include <QOpenGLContext>
+#include <QOpenGLExtraFunctions>
+#include <QOpenGLFramebufferObject>
+#include <QSurfaceFormat>
+#include <QThread>
+#include <QDebug>
+
+OffscreenRenderer::OffscreenRenderer(const QSize &size, AntialiasingMode antialiasing)
+    : m_size(size),
+      m_antialiasing(antialiasing),
+      m_prefetchCount(2 * QThread::idealThreadCount())
+{
+}
+
+OffscreenRenderer::~OffscreenRenderer()
+{
+    if (m_context && makeCurrent()) {
+        m_renderer.cleanup();
+        m_fxaa.destroy();
+        if (m_readbackRing)
+            m_readbackRing->destroy();
+        delete m_fbo;
+        delete m_resolveFbo;
+        delete m_targetsFbo;
+        doneCurrent();
+    }
+    delete m_readbackRing;
+    delete m_context;
+    delete m_surface;
+}
+
+bool OffscreenRenderer::create(QOpenGLContext *shareContext)
+{
+    // We render into our own framebuffer object, a multisampled default
+    // framebuffer would only cost time under software rasterization.
+    QSurfaceFormat format = QSurfaceFormat::defaultFormat();
+    format.setSamples(0);
+    format.setDepthBufferSize(24);
+
+    m_surface = new QOffscreenSurface;
+    m_surface->setFormat(format);
+    m_surface->create();
+
+    m_context = new QOpenGLContext;
+    m_context->setFormat(format);
+    m_context->setShareContext(shareContext);
+    if (!m_context->create() || !makeCurrent()) {
+        qWarning() << "OffscreenRenderer: could not create an OpenGL context";
+        return false;
+    }
+    if (shareContext && !QOpenGLContext::areSharing(m_context, shareContext)) {
+        qWarning() << "OffscreenRenderer: could not share with the given context";
+        doneCurrent();
+        return false;
+    }
+
+    if (!createFbos()) {
+        doneCurrent();
+        return false;
+    }
+
+    m_renderer.initialize();
+    doneCurrent();
+    return true;
+}
+
+bool OffscreenRenderer::createFbos()
+{
+    delete m_fbo;
+    delete m_resolveFbo;
+    m_resolveFbo = nullptr;
+
+    QOpenGLFramebufferObjectFormat fboFormat;
+    fboFormat.setAttachment(QOpenGLFramebufferObject::CombinedDepthStencil);
+    fboFormat.setSamples(antialiasingSamples(m_antialiasing));
+    m_fbo = new QOpenGLFramebufferObject(m_size, fboFormat);
+    if (!m_fbo->isValid()) {
+        qWarning() << "OffscreenRenderer: framebuffer object of size" << m_size << "is incomplete";
+        return false;
+    }
+    if (m_antialiasing != AntialiasingMode::None)
+        m_resolveFbo = new QOpenGLFramebufferObject(m_size);
+    if (m_antialiasing != AntialiasingMode::None && !m_fxaa.isCreated())
+        m_fxaa.create();
+    return true;
+}
+
+void OffscreenRenderer::setAntialiasing(AntialiasingMode mode)
+{
+    if (mode == m_antialiasing)
+        return;
+    m_antialiasing = mode;
+    if (m_context && makeCurrent()) {
+        createFbos();
+        doneCurrent();
+    }
+}
+
+bool OffscreenRenderer::isValid() const
+{
+    return m_fbo && m_fbo->isValid();
+}
+
+bool OffscreenRenderer::makeCurrent()
+{
+    return m_context->makeCurrent(m_surface);
+}
+
+void OffscreenRenderer::doneCurrent()
+{
+    m_context->doneCurrent();
+}
+
+void OffscreenRenderer::setClearColor(const QColor &color)
+{
+    m_renderer.setClearColor(color);
+}
+
+void OffscreenRenderer::setObjectModel(const ObjectModelRenerable &objectModel)
+{
+    if (!isValid() || !makeCurrent())
+        return;
+    m_renderer.setObjectModel(objectModel);
+    m_defaultObjects = m_renderer.sceneObjects();
+    doneCurrent();
+}
+
+int OffscreenRenderer::addObjectModel(const ObjectModelRenerable &objectModel)
+{
+    if (!isValid() || !makeCurrent())
+        return -1;
+    const int modelId = m_renderer.addObjectModel(objectModel);
+    doneCurrent();
+    return modelId;
+}
+
+bool OffscreenRenderer::shareModels(const OffscreenRenderer &source)
+{
+    if (!isValid() || !makeCurrent())
+        return false;
+    const bool shared = m_renderer.shareModels(source.m_renderer);
+    if (shared)
+        m_defaultObjects = source.m_defaultObjects;
+    doneCurrent();
+    return shared;
+}
+
+void OffscreenRenderer::finish()
+{
+    if (!isValid() || !makeCurrent())
+        return;
+    m_context->functions()->glFinish();
+    m_renderer.collectGpuTimings();
+    doneCurrent();
+}
+
+// Returns the framebuffer object holding the single sampled result.
+QOpenGLFramebufferObject *OffscreenRenderer::resolve()
+{
+    if (!m_resolveFbo)
+        return m_fbo;
+    if (m_antialiasing == AntialiasingMode::Fxaa) {
+        m_resolveFbo->bind();
+        m_fxaa.draw(m_fbo->texture(), m_size);
+        m_fbo->bind();
+    } else {
+        QOpenGLFramebufferObject::blitFramebuffer(m_resolveFbo, m_fbo);
+    }
+    return m_resolveFbo;
+}
+
+MemoryReport OffscreenRenderer::memoryReport() const
+{
+    MemoryReport report;
+    m_renderer.reportMemory(&report);
+    // RGBA8 color and a packed depth stencil attachment.
+    if (m_fbo)
+        report.add("framebuffer", "render", 0, MemoryReport::framebufferBytes(m_size, 8, m_fbo->format().samples()));
+    if (m_resolveFbo)
+        report.add("framebuffer", "resolve", 0, MemoryReport::framebufferBytes(m_size, 4));
+    // Color, depth and mask, normals as RGBA32F, depth stencil.
+    if (m_targetsFbo)
+        report.add("framebuffer", "targets", 0, MemoryReport::framebufferBytes(m_size, 4 + 4 + 4 + 16 + 4));
+    if (m_readbackRing)
+        report.add("readback", "pixel buffer ring", 0, m_readbackRing->gpuBytes());
+    return report;
+}
+
+void OffscreenRenderer::setReadbackMode(ReadbackMode mode, int ringSize)
+{
+    m_readbackMode = mode;
+    if (m_readbackRing && m_readbackRing->ringSize() == ringSize)
+        return;
+    if (m_readbackRing && m_readbackRing->isCreated()) {
+        // Its buffers and fences can only go with the context current.
+        if (!m_context || !makeCurrent()) {
+            qWarning() << "OffscreenRenderer: could not make the context current, keeping the readback ring";
+            return;
+        }
+        m_readbackRing->destroy();
+        doneCurrent();
+    }
+    delete m_readbackRing;
+    m_readbackRing = new PixelReadbackRing(ringSize);
+}
+
+// Time spent here is decoding that did not keep up with rendering.
+static QImage nextBackground(BackgroundImageSource *backgroundSource)
+{
+    ProfileScope profile("decode wait");
+    return backgroundSource->next();
+}
+
+void OffscreenRenderer::renderJob(const RenderJob &job, BackgroundImageSource *backgroundSource)
+{
+    if (!job.background.isNull())
+        m_renderer.setBackgroundImage(job.background);
+    else if (!job.backgroundFile.isEmpty())
+        m_renderer.setPreparedBackgroundImage(nextBackground(backgroundSource));
+    else
+        m_renderer.setBackgroundImage(QImage());
+
+    const bool useDefault = job.objects.isEmpty() && job.instanceGroups.isEmpty();
+    m_renderer.setSceneObjects(useDefault ? m_defaultObjects : job.objects);
+    m_renderer.setInstanceGroups(job.instanceGroups);
+    m_renderer.setPose(job.pose);
+    m_renderer.setIntrinsics(job.intrinsics);
+    m_context->functions()->glViewport(0, 0, m_size.width(), m_size.height());
+    m_renderer.render(m_size);
+}
+
+void OffscreenRenderer::render(const QVector<RenderJob> &jobs, const FrameCallback &callback)
+{
+    if (!isValid() || !makeCurrent())
+        return;
+
+    // Background files are decoded on the thread pool while we render.
+    QStringList backgroundFiles;
+    for (const RenderJob &job : jobs) {
+        if (job.background.isNull() && !job.backgroundFile.isEmpty())
+            backgroundFiles << job.backgroundFile;
+    }
+    BackgroundImageSource backgroundSource(backgroundFiles, m_prefetchCount);
+
+    m_fbo->bind();
+    if (m_readbackMode == PixelBufferReadback) {
+        if (!m_readbackRing->isCreated())
+            m_readbackRing->create(m_size);
+        m_readbackRing->setConsumer(callback);
+        // Rendering upside down gives us top-down rows without a copy.
+        m_renderer.setFlipVertical(true);
+        for (int i = 0; i < jobs.size(); ++i) {
+            renderJob(jobs.at(i), &backgroundSource);
+            QOpenGLFramebufferObject *source = resolve();
+            if (source != m_fbo)
+                source->bind();
+            m_readbackRing->readPixels(i);
+            if (source != m_fbo)
+                m_fbo->bind();
+        }
+        m_readbackRing->flush();
+        m_readbackRing->setConsumer(PixelReadbackRing::Consumer());
+        m_renderer.setFlipVertical(false);
+    } else {
+        for (int i = 0; i < jobs.size(); ++i) {
+            renderJob(jobs.at(i), &backgroundSource);
+            QImage image;
+            {
+                ProfileScope profile("readback");
+                image = resolve()->toImage();
+            }
+            callback(i, image);
+        }
+    }
+    m_fbo->release();
+    doneCurrent();
+}
+
+// Every band of tiles takes the next rows of the background from one
+// BackgroundBandReader, scaled to imageSize like a background drawn over
+// the whole image would be. Binary PPM and PGM files are streamed row by
+// row, other formats are decoded in full once per job.
+void OffscreenRenderer::renderTiled(const RenderJob &job, const QSize &imageSize, const TileCallback &callback)
+{
+    if (!isValid() || !makeCurrent())
+        return;
+
+    const bool useDefault = job.objects.isEmpty() && job.instanceGroups.isEmpty();
+    m_renderer.setSceneObjects(useDefault ? m_defaultObjects : job.objects);
+    m_renderer.setInstanceGroups(job.instanceGroups);
+    m_renderer.setPose(job.pose);
+    m_renderer.setIntrinsics(job.intrinsics);
+
+    BackgroundBandReader backgroundReader;
+    bool hasBackground = false;
+    if (!job.background.isNull())
+        hasBackground = backgroundReader.open(job.background, imageSize);
+    else if (!job.backgroundFile.isEmpty())
+        hasBackground = backgroundReader.open(job.backgroundFile, imageSize);
+
+    m_fbo->bind();
+    for (int y = 0; y < imageSize.height(); y += m_size.height()) {
+        const int bandHeight = qMin(m_size.height(), imageSize.height() - y);
+        const QImage band = hasBackground ? backgroundReader.readBand(bandHeight) : QImage();
+        for (int x = 0; x < imageSize.width(); x += m_size.width()) {
+            const QRect tile(x, y, qMin(m_size.width(), imageSize.width() - x), bandHeight);
+            // Edge tiles go into the top left of a texture of the
+            // framebuffer size, which is allocated once for all tiles.
+            m_renderer.setBackgroundImage(band.isNull() ? QImage() : band.copy(x, 0, tile.width(), tile.height()),
+                                          m_size);
+            m_renderer.setTile(tile);
+            // Edge tiles only use the bottom left of the framebuffer.
+            m_context->functions()->glViewport(0, 0, tile.width(), tile.height());
+            m_renderer.render(imageSize);
+
+            QImage image;
+            {
+                ProfileScope profile("readback");
+                image = resolve()->toImage();
+            }
+            callback(tile, image.copy(0, m_size.height() - tile.height(), tile.width(), tile.height()));
+        }
+    }
+    m_renderer.setTile(QRect());
+    m_fbo->release();
+    doneCurrent();
+}
+
+bool OffscreenRenderer::createTargetsFbo()
+{
+    m_targetsFbo = new QOpenGLFramebufferObject(m_size, QOpenGLFramebufferObject::CombinedDepthStencil);
+    m_targetsFbo->addColorAttachment(m_size, GL_R32F);
+    m_targetsFbo->addColorAttachment(m_size, GL_R32F);
+    m_targetsFbo->addColorAttachment(m_size, GL_RGBA32F);
+    if (!m_targetsFbo->isValid()) {
+        qWarning() << "OffscreenRenderer: multiple target framebuffer object is incomplete";
+        delete m_targetsFbo;
+        m_targetsFbo = nullptr;
+        return false;
+    }
+    return true;
+}
+
+QVector<float> OffscreenRenderer::readTarget(int target, GLenum format, int channels)
+{
+    QOpenGLExtraFunctions *f = m_context->extraFunctions();
+    QVector<float> values(m_size.width() * m_size.height() * channels);
+    f->glReadBuffer(GL_COLOR_ATTACHMENT0 + target);
+    f->glPixelStorei(GL_PACK_ALIGNMENT, 4);
+    f->glReadPixels(0, 0, m_size.width(), m_size.height(), format, GL_FLOAT, values.data());
+    f->glReadBuffer(GL_COLOR_ATTACHMENT0);
+    return values;
+}
+
+void OffscreenRenderer::renderTargets(const QVector<RenderJob> &jobs, const TargetsCallback &callback)
+{
+    if (!isValid() || !makeCurrent())
+        return;
+    if (!m_targetsFbo && !createTargetsFbo()) {
+        doneCurrent();
+        return;
+    }
+
+    QStringList backgroundFiles;
+    for (const RenderJob &job : jobs) {
+        if (job.background.isNull() && !job.backgroundFile.isEmpty())
+            backgroundFiles << job.backgroundFile;
+    }
+    BackgroundImageSource backgroundSource(backgroundFiles, m_prefetchCount);
+
+    m_targetsFbo->bind();
+    // Upside down, so the float targets read back top-down as well.
+    m_renderer.setFlipVertical(true);
+    m_renderer.setMultipleTargets(true);
+    for (int i = 0; i < jobs.size(); ++i) {
+        renderJob(jobs.at(i), &backgroundSource);
+        RenderTargets targets;
+        targets.depth = readTarget(SceneRenderer::DepthTarget, GL_RED, 1);
+        targets.mask = readTarget(SceneRenderer::MaskTarget, GL_RED, 1);
+        targets.normals = readTarget(SceneRenderer::NormalTarget, GL_RGB, 3);
+        if (m_resolveFbo) {
+            m_resolveFbo->bind();
+            m_fxaa.draw(m_targetsFbo->textures().at(SceneRenderer::ColorTarget), m_size);
+            targets.color = m_resolveFbo->toImage(false);
+            m_targetsFbo->bind();
+        } else {
+            targets.color = m_targetsFbo->toImage(false, SceneRenderer::ColorTarget);
+        }
+        callback(i, targets);
+    }
+    m_renderer.setMultipleTargets(false);
+    m_renderer.setFlipVertical(false);
+    m_targetsFbo->release();
+    doneCurrent();
+}
+
+QImage OffscreenRenderer::render(const RenderJob &job)
+{
+    QImage image;
+    render(QVector<RenderJob>() << job, [&image](int, const QImage &result) {
+        image = result.copy();
+    });
+    return image;
+}
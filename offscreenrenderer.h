@@ -0,0 +1,196 @@
+/****************************************************************************
+**
+** Copyright (C) 2016 The Qt Company Ltd.
+** Contact: https://www.qt.io/licensing/
+**
+** This file is part of the examples of the Qt Toolkit.
+**
+** $QT_BEGIN_LICENSE:BSD$
+** Commercial License Usage
+** Licensees holding valid commercial Qt licenses may use this file in
+** accordance with the commercial license agreement provided with the
+** Software or, alternatively, in accordance with the terms contained in
+** a written agreement between you and The Qt Company. For licensing terms
+** and conditions see https://www.qt.io/terms-conditions. For further
+** information use the contact form at https://www.qt.io/contact-us.
+**
+** BSD License Usage
+** Alternatively, you may use this file under the terms of the BSD license
+** as follows:
+**
+** "Redistribution and use in source and binary forms, with or without
+** modification, are permitted provided that the following conditions are
+** met:
+**   * Redistributions of source code must retain the above copyright
+**     notice, this list of conditions and the following disclaimer.
+**   * Redistributions in binary form must reproduce the above copyright
+**     notice, this list of conditions and the following disclaimer in
+**     the documentation and/or other materials provided with the
+**     distribution.
+**   * Neither the name of The Qt Company Ltd nor the names of its
+**     contributors may be used to endorse or promote products derived
+**     from this software without specific prior written permission.
+**
+**
+** THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+** "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+** LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+** A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+** OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+** SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+** LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+** DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+** THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+** (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+** OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE."
+**
+** $QT_END_LICENSE$
+**
+****************************************************************************/
+
+#ifndef OFFSCREENRENDERER_H
+#define OFFSCREENRENDERER_H
+
+#include "scenerenderer.h"
+#include "antialiasing.h"
+#include "pixelreadbackring.h"
+#include "backgroundimagesource.h"
+
+#include <QImage>
+#include <qopengl.h>
+#include <QMatrix4x4>
+#include <QRect>
+#include <QSize>
+#include <QString>
+#include <QVector>
+
+#include <functional>
+
+QT_FORWARD_DECLARE_CLASS(QOffscreenSurface)
+QT_FORWARD_DECLARE_CLASS(QOpenGLContext)
+QT_FORWARD_DECLARE_CLASS(QOpenGLFramebufferObject)
+
+// One composite to render. If background is null the image is loaded
+// from backgroundFile, so job lists stay small for long dataset runs.
+// Without objects or instance groups the model given to setObjectModel()
+// is drawn at pose.
+struct RenderJob
+{
+    QImage background;
+    QString backgroundFile;
+    QMatrix4x4 pose;
+    CameraIntrinsics intrinsics;
+    QVector<SceneObject> objects;
+    QVector<InstanceGroup> instanceGroups;
+};
+
+// Everything a multiple target render produces for one job, rows
+// top-down. See SceneRenderer::OutputTarget for what the values mean.
+struct RenderTargets
+{
+    QImage color;
+    QVector<float> depth;
+    QVector<float> mask;
+    // Three floats per pixel.
+    QVector<float> normals;
+};
+
+// Renders composites into a framebuffer object of a QOffscreenSurface.
+// No window is ever created and the event loop is not involved, so it runs
+// on headless machines (e.g. -platform offscreen on Mesa llvmpipe). The
+// object must be created and destroyed in the GUI thread because of
+// QOffscreenSurface. Rendering may happen on another thread once context()
+// was moved there, see RendererPool.
+class OffscreenRenderer
+{
+public:
+    typedef std::function<void(int jobIndex, const QImage &image)> FrameCallback;
+    typedef std::function<void(int jobIndex, const RenderTargets &targets)> TargetsCallback;
+    typedef std::function<void(const QRect &tile, const QImage &image)> TileCallback;
+
+    enum ReadbackMode {
+        // QOpenGLFramebufferObject::toImage() after every job.
+        SynchronousReadback,
+        // Through a PixelReadbackRing; the callback runs a few jobs late and
+        // its image is only valid during the call.
+        PixelBufferReadback
+    };
+
+    explicit OffscreenRenderer(const QSize &size, AntialiasingMode antialiasing = AntialiasingMode::None);
+    ~OffscreenRenderer();
+
+    // With shareContext, buffers and textures are shared with it.
+    bool create(QOpenGLContext *shareContext = nullptr);
+    bool isValid() const;
+    QSize size() const { return m_size; }
+    // Applies to the color images only, depth, mask and normals of
+    // renderTargets() are never antialiased. There the color target only
+    // gets FXAA, MSAA modes included, as it shares its geometry pass with
+    // the float targets. Can be switched between render calls.
+    void setAntialiasing(AntialiasingMode mode);
+    AntialiasingMode antialiasing() const { return m_antialiasing; }
+    QOpenGLContext *context() const { return m_context; }
+
+    void setClearColor(const QColor &color);
+    void setObjectModel(const ObjectModelRenerable &objectModel);
+    // Returns the id jobs refer to in their SceneObjects.
+    int addObjectModel(const ObjectModelRenerable &objectModel);
+    void setVertexFormat(VertexFormat format) { m_renderer.setVertexFormat(format); }
+    // Off draws every model at full detail, as CpuRasterizer does.
+    void setLodEnabled(bool enabled) { m_renderer.setLodEnabled(enabled); }
+    // Draws the models of source from its buffers, replacing ours. source
+    // has to be created as shareContext of ours, or the other way round.
+    bool shareModels(const OffscreenRenderer &source);
+    void setReadbackMode(ReadbackMode mode, int ringSize = 3);
+    // Number of background files decoded ahead of the job being rendered.
+    void setPrefetchCount(int count) { m_prefetchCount = count; }
+    // Waits until everything submitted so far has executed, and collects
+    // the GPU timings of it.
+    void finish();
+    ReadbackMode readbackMode() const { return m_readbackMode; }
+    // Everything the renderer holds, framebuffer objects included.
+    MemoryReport memoryReport() const;
+
+    // Renders all jobs back to back and passes every finished image to
+    // callback, in job order.
+    void render(const QVector<RenderJob> &jobs, const FrameCallback &callback);
+    QImage render(const RenderJob &job);
+    // Renders job as one image of imageSize, which may well exceed the
+    // viewport and framebuffer limits of the GL implementation, in tiles
+    // of size(). Tiles come row by row, top-down, the ones at the right
+    // and bottom edge may be smaller. Memory stays bounded by size() and
+    // one band of background rows as long as the background is a binary
+    // PPM or PGM file, see BackgroundBandReader. Other background files
+    // are decoded in full. FXAA does not see across tile edges.
+    void renderTiled(const RenderJob &job, const QSize &imageSize, const TileCallback &callback);
+    // Same, but color, depth, instance mask and normals come out of one
+    // geometry pass into multiple targets. Always reads back synchronously.
+    void renderTargets(const QVector<RenderJob> &jobs, const TargetsCallback &callback);
+
+private:
+    bool makeCurrent();
+    void doneCurrent();
+    void renderJob(const RenderJob &job, BackgroundImageSource *backgroundSource);
+    bool createFbos();
+    bool createTargetsFbo();
+    QOpenGLFramebufferObject *resolve();
+    QVector<float> readTarget(int target, GLenum format, int channels);
+
+    QSize m_size;
+    AntialiasingMode m_antialiasing;
+    QOffscreenSurface *m_surface = nullptr;
+    QOpenGLContext *m_context = nullptr;
+    QOpenGLFramebufferObject *m_fbo = nullptr;
+    // Single sampled result of antialiasing m_fbo, unless it is off.
+    QOpenGLFramebufferObject *m_resolveFbo = nullptr;
+    FxaaPass m_fxaa;
+    // Created on first use of renderTargets().
+    QOpenGLFramebufferObject *m_targetsFbo = nullptr;
+    SceneRenderer m_renderer;
+    QVector<SceneObject> m_defaultObjects;
+    ReadbackMode m_readbackMode = SynchronousReadback;
+    PixelReadbackRing *m_readbackRing = nullptr;
+    int m_prefetchCount;
+};
+
+#endif // OFFSCREENRENDERER_H
@@ -0,0 +1,135 @@
+/****************************************************************************
+**
+** Copyright (C) 2016 The Qt Company Ltd.
+** Contact: https://www.qt.io/licensing/
+**
+** This file is part of the examples of the Qt Toolkit.
+**
+** $QT_BEGIN_LICENSE:BSD$
+** Commercial License Usage
+** Licensees holding valid commercial Qt licenses may use this file in
+** accordance with the commercial license agreement provided with the
+** Software or, alternatively, in accordance with the terms contained in
+** a written agreement between you and The Qt Company. For licensing terms
+** and conditions see https://www.qt.io/terms-conditions. For further
+** information use the contact form at https://www.qt.io/contact-us.
+**
+** BSD License Usage
+** Alternatively, you may use this file under the terms of the BSD license
+** as follows:
+**
+** "Redistribution and use in source and binary forms, with or without
+** modification, are permitted provided that the following conditions are
+** met:
+**   * Redistributions of source code must retain the above copyright
+**     notice, this list of conditions and the following disclaimer.
+**   * Redistributions in binary form must reproduce the above copyright
+**     notice, this list of conditions and the following disclaimer in
+**     the documentation and/or other materials provided with the
+**     distribution.
+**   * Neither the name of The Qt Company Ltd nor the names of its
+**     contributors may be used to endorse or promote products derived
+**     from this software without specific prior written permission.
+**
+**
+** THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+** "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+** LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+** A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+** OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+** SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+** LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+** DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+** THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+** (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+** OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE."
+**
+** $QT_END_LICENSE$
+**
+****************************************************************************/
+
+#include "packedmesh.h"
+
+#include <qmath.h>
+#include <limits>
+
+static qint16 packSnorm(float value)
+{
+    return qint16(qRound(qBound(-1.0f, value, 1.0f) * 32767.0f));
+}
+
+static quint16 packUnorm(float value)
+{
+    return quint16(qRound(qBound(0.0f, value, 1.0f) * 65535.0f));
+}
+
+// Octahedral normal encoding, see Cigolle et al., "A Survey of Efficient
+// Representations for Independent Unit Vectors". The vertex shader of
+// SceneRenderer holds the matching decodeNormal().
+static void encodeNormal(float x, float y, float z, qint16 *encoded)
+{
+    const float l1 = qAbs(x) + qAbs(y) + qAbs(z);
+    if (l1 == 0.0f) {
+        encoded[0] = encoded[1] = 0;
+        return;
+    }
+    float u = x / l1;
+    float v = y / l1;
+    if (z < 0.0f) {
+        const float fu = (1.0f - qAbs(v)) * (u >= 0.0f ? 1.0f : -1.0f);
+        const float fv = (1.0f - qAbs(u)) * (v >= 0.0f ? 1.0f : -1.0f);
+        u = fu;
+        v = fv;
+    }
+    encoded[0] = packSnorm(u);
+    encoded[1] = packSnorm(v);
+}
+
+PackedMesh PackedMesh::pack(const GLfloat *vertices, const GLfloat *normals, int vertexCount,
+                            const GLuint *indices, int indexCount)
+{
+    PackedMesh mesh;
+    mesh.vertexCount = vertexCount;
+    mesh.indexCount = indexCount;
+
+    float minimum[3] = { 0.0f, 0.0f, 0.0f };
+    float maximum[3] = { 0.0f, 0.0f, 0.0f };
+    for (int c = 0; c < 3 && vertexCount > 0; ++c) {
+        minimum[c] = maximum[c] = vertices[c];
+        for (int i = 1; i < vertexCount; ++i) {
+            minimum[c] = qMin(minimum[c], vertices[3 * i + c]);
+            maximum[c] = qMax(maximum[c], vertices[3 * i + c]);
+        }
+    }
+    mesh.boundsMin = QVector3D(minimum[0], minimum[1], minimum[2]);
+    mesh.boundsScale = QVector3D(maximum[0] - minimum[0], maximum[1] - minimum[1], maximum[2] - minimum[2]);
+
+    mesh.vertexData.resize(vertexCount * VertexStride);
+    uchar *vertex = reinterpret_cast<uchar *>(mesh.vertexData.data());
+    for (int i = 0; i < vertexCount; ++i, vertex += VertexStride) {
+        quint16 *position = reinterpret_cast<quint16 *>(vertex + PositionOffset);
+        for (int c = 0; c < 3; ++c) {
+            const float extent = maximum[c] - minimum[c];
+            position[c] = extent > 0.0f ? packUnorm((vertices[3 * i + c] - minimum[c]) / extent) : 0;
+        }
+        position[3] = 0;
+
+        qint16 *normal = reinterpret_cast<qint16 *>(vertex + NormalOffset);
+        if (normals)
+            encodeNormal(normals[3 * i], normals[3 * i + 1], normals[3 * i + 2], normal);
+        else
+            normal[0] = normal[1] = 0;
+    }
+
+    if (vertexCount <= std::numeric_limits<quint16>::max() + 1) {
+        mesh.indexType = GL_UNSIGNED_SHORT;
+        mesh.indexData.resize(indexCount * sizeof(quint16));
+        quint16 *shortIndices = reinterpret_cast<quint16 *>(mesh.indexData.data());
+        for (int i = 0; i < indexCount; ++i)
+            shortIndices[i] = quint16(indices[i]);
+    } else {
+        mesh.indexType = GL_UNSIGNED_INT;
+        mesh.indexData = QByteArray(reinterpret_cast<const char *>(indices), indexCount * sizeof(GLuint));
+    }
+    return mesh;
+}
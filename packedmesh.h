@@ -0,0 +1,89 @@
+/****************************************************************************
+**
+** Copyright (C) 2016 The Qt Company Ltd.
+** Contact: https://www.qt.io/licensing/
+**
+** This file is part of the examples of the Qt Toolkit.
+**
+** $QT_BEGIN_LICENSE:BSD$
+** Commercial License Usage
+** Licensees holding valid commercial Qt licenses may use this file in
+** accordance with the commercial license agreement provided with the
+** Software or, alternatively, in accordance with the terms contained in
+** a written agreement between you and The Qt Company. For licensing terms
+** and conditions see https://www.qt.io/terms-conditions. For further
+** information use the contact form at https://www.qt.io/contact-us.
+**
+** BSD License Usage
+** Alternatively, you may use this file under the terms of the BSD license
+** as follows:
+**
+** "Redistribution and use in source and binary forms, with or without
+** modification, are permitted provided that the following conditions are
+** met:
+**   * Redistributions of source code must retain the above copyright
+**     notice, this list of conditions and the following disclaimer.
+**   * Redistributions in binary form must reproduce the above copyright
+**     notice, this list of conditions and the following disclaimer in
+**     the documentation and/or other materials provided with the
+**     distribution.
+**   * Neither the name of The Qt Company Ltd nor the names of its
+**     contributors may be used to endorse or promote products derived
+**     from this software without specific prior written permission.
+**
+**
+** THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+** "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+** LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+** A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+** OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+** SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+** LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+** DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+** THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+** (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+** OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE."
+**
+** $QT_END_LICENSE$
+**
+****************************************************************************/
+
+#ifndef PACKEDMESH_H
+#define PACKEDMESH_H
+
+#include <qopengl.h>
+#include <QByteArray>
+#include <QVector3D>
+
+// Vertex layouts object meshes can be uploaded in.
+enum class VertexFormat {
+    // Separate float32 position and normal buffers, 24 bytes per vertex.
+    Float32,
+    // Interleaved 12 bytes per vertex: positions as 16 bit unorm relative
+    // to the mesh bounds, normals octahedral encoded as 2 x 16 bit snorm.
+    Packed
+};
+
+// A mesh in the packed layout, ready for upload. Indices are 16 bit
+// whenever the vertex count allows it.
+struct PackedMesh
+{
+    static const int VertexStride = 12;
+    static const int PositionOffset = 0;
+    static const int NormalOffset = 8;
+
+    QByteArray vertexData;
+    QByteArray indexData;
+    GLenum indexType = GL_UNSIGNED_INT;
+    int vertexCount = 0;
+    int indexCount = 0;
+    // Positions decode as boundsMin + unorm * boundsScale.
+    QVector3D boundsMin;
+    QVector3D boundsScale;
+
+    // normals may be null.
+    static PackedMesh pack(const GLfloat *vertices, const GLfloat *normals, int vertexCount,
+                           const GLuint *indices, int indexCount);
+};
+
+#endif // PACKEDMESH_H
@@ -0,0 +1,158 @@
+/****************************************************************************
+**
+** Copyright (C) 2016 The Qt Company Ltd.
+** Contact: https://www.qt.io/licensing/
+**
+** This file is part of the examples of the Qt Toolkit.
+**
+** $QT_BEGIN_LICENSE:BSD$
+** Commercial License Usage
+** Licensees holding valid commercial Qt licenses may use this file in
+** accordance with the commercial license agreement provided with the
+** Software or, alternatively, in accordance with the terms contained in
+** a written agreement between you and The Qt Company. For licensing terms
+** and conditions see https://www.qt.io/terms-conditions. For further
+** information use the contact form at https://www.qt.io/contact-us.
+**
+** BSD License Usage
+** Alternatively, you may use this file under the terms of the BSD license
+** as follows:
+**
+** "Redistribution and use in source and binary forms, with or without
+** modification, are permitted provided that the following conditions are
+** met:
+**   * Redistributions of source code must retain the above copyright
+**     notice, this list of conditions and the following disclaimer.
+**   * Redistributions in binary form must reproduce the above copyright
+**     notice, this list of conditions and the following disclaimer in
+**     the documentation and/or other materials provided with the
+**     distribution.
+**   * Neither the name of The Qt Company Ltd nor the names of its
+**     contributors may be used to endorse or promote products derived
+**     from this software without specific prior written permission.
+**
+**
+** THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+** "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+** LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+** A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+** OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+** SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+** LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+** DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+** THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+** (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+** OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE."
+**
+** $QT_END_LICENSE$
+**
+****************************************************************************/
+
+#include "pixelreadbackring.h"
+#include "profiler.h"
+
+PixelReadbackRing::PixelReadbackRing(int ringSize)
+    : m_ringSize(qMax(1, ringSize))
+{
+}
+
+PixelReadbackRing::~PixelReadbackRing()
+{
+    // Buffers are released through destroy() while the context is current.
+}
+
+void PixelReadbackRing::create(const QSize &size)
+{
+    initializeOpenGLFunctions();
+    destroy();
+
+    m_size = size;
+    m_next = 0;
+    m_slots.resize(m_ringSize);
+    for (Slot &slot : m_slots) {
+        slot.buffer = QOpenGLBuffer(QOpenGLBuffer::PixelPackBuffer);
+        slot.buffer.setUsagePattern(QOpenGLBuffer::StreamRead);
+        slot.buffer.create();
+        slot.buffer.bind();
+        slot.buffer.allocate(size.width() * size.height() * 4);
+        slot.buffer.release();
+    }
+}
+
+void PixelReadbackRing::destroy()
+{
+    for (Slot &slot : m_slots) {
+        if (slot.fence)
+            glDeleteSync(slot.fence);
+        slot.buffer.destroy();
+    }
+    m_slots.clear();
+}
+
+void PixelReadbackRing::readPixels(int frameIndex)
+{
+    ProfileScope profile("readback");
+    Q_ASSERT(isCreated());
+    Slot &slot = m_slots[m_next];
+    if (slot.frameIndex >= 0)
+        deliver(slot);
+
+    slot.buffer.bind();
+    glPixelStorei(GL_PACK_ALIGNMENT, 4);
+    glReadPixels(0, 0, m_size.width(), m_size.height(), GL_RGBA, GL_UNSIGNED_BYTE, 0);
+    slot.buffer.release();
+    slot.fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+    slot.frameIndex = frameIndex;
+
+    m_next = (m_next + 1) % m_slots.size();
+}
+
+void PixelReadbackRing::poll()
+{
+    // Slots are handed out in submission order, starting at the oldest.
+    for (int i = 0; i < m_slots.size(); ++i) {
+        Slot &slot = m_slots[(m_next + i) % m_slots.size()];
+        if (slot.frameIndex < 0)
+            continue;
+        const GLenum status = glClientWaitSync(slot.fence, 0, 0);
+        if (status != GL_ALREADY_SIGNALED && status != GL_CONDITION_SATISFIED)
+            return;
+        deliver(slot);
+    }
+}
+
+void PixelReadbackRing::flush()
+{
+    for (int i = 0; i < m_slots.size(); ++i) {
+        Slot &slot = m_slots[(m_next + i) % m_slots.size()];
+        if (slot.frameIndex >= 0)
+            deliver(slot);
+    }
+}
+
+void PixelReadbackRing::deliver(Slot &slot)
+{
+    ProfileScope profile("readback deliver");
+    // Mapping waits for the copy anyway, the explicit wait flushes the
+    // command stream so we never block on commands that were not sent.
+    glClientWaitSync(slot.fence, GL_SYNC_FLUSH_COMMANDS_BIT, GLuint64(1000000000));
+    glDeleteSync(slot.fence);
+    slot.fence = 0;
+
+    const int frameIndex = slot.frameIndex;
+    slot.frameIndex = -1;
+
+    slot.buffer.bind();
+    const int byteCount = m_size.width() * m_size.height() * 4;
+    const uchar *data = static_cast<const uchar *>(slot.buffer.mapRange(0, byteCount, QOpenGLBuffer::RangeRead));
+    if (data && m_consumer) {
+        const QImage image(data, m_size.width(), m_size.height(), m_size.width() * 4, QImage::Format_RGBA8888);
+        if (m_mirrored)
+            m_consumer(frameIndex, image.mirrored());
+        else
+            m_consumer(frameIndex, image);
+    }
+    if (data)
+        slot.buffer.unmap();
+    slot.buffer.release();
+}
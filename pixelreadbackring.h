@@ -0,0 +1,117 @@
+/****************************************************************************
+**
+** Copyright (C) 2016 The Qt Company Ltd.
+** Contact: https://www.qt.io/licensing/
+**
+** This file is part of the examples of the Qt Toolkit.
+**
+** $QT_BEGIN_LICENSE:BSD$
+** Commercial License Usage
+** Licensees holding valid commercial Qt licenses may use this file in
+** accordance with the commercial license agreement provided with the
+** Software or, alternatively, in accordance with the terms contained in
+** a written agreement between you and The Qt Company. For licensing terms
+** and conditions see https://www.qt.io/terms-conditions. For further
+** information use the contact form at https://www.qt.io/contact-us.
+**
+** BSD License Usage
+** Alternatively, you may use this file under the terms of the BSD license
+** as follows:
+**
+** "Redistribution and use in source and binary forms, with or without
+** modification, are permitted provided that the following conditions are
+** met:
+**   * Redistributions of source code must retain the above copyright
+**     notice, this list of conditions and the following disclaimer.
+**   * Redistributions in binary form must reproduce the above copyright
+**     notice, this list of conditions and the following disclaimer in
+**     the documentation and/or other materials provided with the
+**     distribution.
+**   * Neither the name of The Qt Company Ltd nor the names of its
+**     contributors may be used to endorse or promote products derived
+**     from this software without specific prior written permission.
+**
+**
+** THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+** "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+** LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+** A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+** OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+** SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+** LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+** DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+** THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+** (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+** OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE."
+**
+** $QT_END_LICENSE$
+**
+****************************************************************************/
+
+#ifndef PIXELREADBACKRING_H
+#define PIXELREADBACKRING_H
+
+#include <QOpenGLExtraFunctions>
+#include <QOpenGLBuffer>
+#include <QImage>
+#include <QSize>
+#include <QVector>
+
+#include <functional>
+
+// Reads frames back through a ring of pixel pack buffers. glReadPixels
+// only queues a copy into the next buffer, the buffer is mapped once the
+// ring wraps around, so readback of frame k overlaps with rendering of
+// frames k + 1 .. k + N - 1 instead of stalling the pipeline.
+class PixelReadbackRing : protected QOpenGLExtraFunctions
+{
+public:
+    // The image points into mapped GL memory and is only valid during
+    // the call, copy it to keep it.
+    typedef std::function<void(int frameIndex, const QImage &image)> Consumer;
+
+    explicit PixelReadbackRing(int ringSize = 3);
+    ~PixelReadbackRing();
+
+    // Everything below needs the context the ring was created in.
+    void create(const QSize &size);
+    void destroy();
+    bool isCreated() const { return !m_slots.isEmpty(); }
+    QSize size() const { return m_size; }
+    int ringSize() const { return m_ringSize; }
+    qint64 gpuBytes() const { return qint64(m_slots.size()) * m_size.width() * m_size.height() * 4; }
+
+    void setConsumer(const Consumer &consumer) { m_consumer = consumer; }
+    // Rows come out of GL bottom-up. Renderers that draw upside down
+    // already get top-down rows; everyone else can have them mirrored,
+    // which costs one copy per frame.
+    void setMirrored(bool mirrored) { m_mirrored = mirrored; }
+
+    // Queues a readback of the currently bound read framebuffer. If every
+    // buffer is in flight the oldest one is handed to the consumer first.
+    void readPixels(int frameIndex);
+    // Hands all frames that are finished on the GPU to the consumer
+    // without waiting for the others.
+    void poll();
+    // Waits for and hands over every frame still in flight.
+    void flush();
+
+private:
+    struct Slot
+    {
+        QOpenGLBuffer buffer;
+        GLsync fence = 0;
+        int frameIndex = -1;
+    };
+
+    void deliver(Slot &slot);
+
+    int m_ringSize;
+    int m_next = 0;
+    QSize m_size;
+    bool m_mirrored = false;
+    QVector<Slot> m_slots;
+    Consumer m_consumer;
+};
+
+#endif // PIXELREADBACKRING_H
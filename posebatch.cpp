@@ -0,0 +1,169 @@
+/****************************************************************************
+**
+** Copyright (C) 2016 The Qt Company Ltd.
+** Contact: https://www.qt.io/licensing/
+**
+** This file is part of the examples of the Qt Toolkit.
+**
+** $QT_BEGIN_LICENSE:BSD$
+** Commercial License Usage
+** Licensees holding valid commercial Qt licenses may use this file in
+** accordance with the commercial license agreement provided with the
+** Software or, alternatively, in accordance with the terms contained in
+** a written agreement between you and The Qt Company. For licensing terms
+** and conditions see https://www.qt.io/terms-conditions. For further
+** information use the contact form at https://www.qt.io/contact-us.
+**
+** BSD License Usage
+** Alternatively, you may use this file under the terms of the BSD license
+** as follows:
+**
+** "Redistribution and use in source and binary forms, with or without
+** modification, are permitted provided that the following conditions are
+** met:
+**   * Redistributions of source code must retain the above copyright
+**     notice, this list of conditions and the following disclaimer.
+**   * Redistributions in binary form must reproduce the above copyright
+**     notice, this list of conditions and the following disclaimer in
+**     the documentation and/or other materials provided with the
+**     distribution.
+**   * Neither the name of The Qt Company Ltd nor the names of its
+**     contributors may be used to endorse or promote products derived
+**     from this software without specific prior written permission.
+**
+**
+** THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+** "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+** LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+** A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+** OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+** SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+** LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+** DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+** THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+** (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+** OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE."
+**
+** $QT_END_LICENSE$
+**
+****************************************************************************/
+
+#include "posebatch.h"
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define POSEBATCH_SSE2
+#include <emmintrin.h>
+#endif
+
+namespace {
+
+#ifdef POSEBATCH_SSE2
+
+inline __m128 cross(__m128 a, __m128 b)
+{
+    const __m128 aYzx = _mm_shuffle_ps(a, a, _MM_SHUFFLE(3, 0, 2, 1));
+    const __m128 bYzx = _mm_shuffle_ps(b, b, _MM_SHUFFLE(3, 0, 2, 1));
+    const __m128 c = _mm_sub_ps(_mm_mul_ps(a, bYzx), _mm_mul_ps(aYzx, b));
+    return _mm_shuffle_ps(c, c, _MM_SHUFFLE(3, 0, 2, 1));
+}
+
+// viewProjection holds four columns, view the first three.
+void computeModel(const __m128 *viewProjection, const __m128 *view, const float *model, float *out)
+{
+    const __m128 mask = _mm_castsi128_ps(_mm_setr_epi32(-1, -1, -1, 0));
+    __m128 modelView[3];
+    for (int column = 0; column < 4; ++column) {
+        const float *m = model + 4 * column;
+        const __m128 x = _mm_set1_ps(m[0]);
+        const __m128 y = _mm_set1_ps(m[1]);
+        const __m128 z = _mm_set1_ps(m[2]);
+        const __m128 w = _mm_set1_ps(m[3]);
+        const __m128 mvp = _mm_add_ps(_mm_add_ps(_mm_mul_ps(viewProjection[0], x), _mm_mul_ps(viewProjection[1], y)),
+                                      _mm_add_ps(_mm_mul_ps(viewProjection[2], z), _mm_mul_ps(viewProjection[3], w)));
+        _mm_storeu_ps(out + 4 * column, mvp);
+        if (column < 3) {
+            const __m128 mv = _mm_add_ps(_mm_add_ps(_mm_mul_ps(view[0], x), _mm_mul_ps(view[1], y)),
+                                         _mm_mul_ps(view[2], z));
+            modelView[column] = _mm_and_ps(mv, mask);
+        }
+    }
+
+    // The columns of the inverse transpose are the cross products of the
+    // model view columns divided by the determinant.
+    __m128 n0 = cross(modelView[1], modelView[2]);
+    __m128 n1 = cross(modelView[2], modelView[0]);
+    __m128 n2 = cross(modelView[0], modelView[1]);
+    __m128 det = _mm_mul_ps(modelView[0], n0);
+    det = _mm_add_ps(det, _mm_shuffle_ps(det, det, _MM_SHUFFLE(2, 3, 0, 1)));
+    det = _mm_add_ps(det, _mm_shuffle_ps(det, det, _MM_SHUFFLE(1, 0, 3, 2)));
+    if (_mm_cvtss_f32(det) == 0.0f) {
+        // Like QMatrix4x4::normalMatrix() for singular matrices.
+        n0 = _mm_setr_ps(1.0f, 0.0f, 0.0f, 0.0f);
+        n1 = _mm_setr_ps(0.0f, 1.0f, 0.0f, 0.0f);
+        n2 = _mm_setr_ps(0.0f, 0.0f, 1.0f, 0.0f);
+    } else {
+        const __m128 inverseDet = _mm_div_ps(_mm_set1_ps(1.0f), det);
+        n0 = _mm_mul_ps(n0, inverseDet);
+        n1 = _mm_mul_ps(n1, inverseDet);
+        n2 = _mm_mul_ps(n2, inverseDet);
+    }
+    _mm_storeu_ps(out + 16, n0);
+    _mm_storeu_ps(out + 20, n1);
+    _mm_storeu_ps(out + 24, n2);
+}
+
+#else
+
+// viewProjection and view are column-major.
+void computeModel(const float *viewProjection, const float *view, const float *model, float *out)
+{
+    float modelView[3][3];
+    for (int column = 0; column < 4; ++column) {
+        const float *m = model + 4 * column;
+        for (int row = 0; row < 4; ++row) {
+            out[4 * column + row] = viewProjection[row] * m[0] + viewProjection[4 + row] * m[1]
+                    + viewProjection[8 + row] * m[2] + viewProjection[12 + row] * m[3];
+            if (column < 3 && row < 3)
+                modelView[column][row] = view[row] * m[0] + view[4 + row] * m[1] + view[8 + row] * m[2];
+        }
+    }
+
+    float n[3][3];
+    for (int i = 0; i < 3; ++i) {
+        const float *a = modelView[(i + 1) % 3];
+        const float *b = modelView[(i + 2) % 3];
+        n[i][0] = a[1] * b[2] - a[2] * b[1];
+        n[i][1] = a[2] * b[0] - a[0] * b[2];
+        n[i][2] = a[0] * b[1] - a[1] * b[0];
+    }
+    const float det = modelView[0][0] * n[0][0] + modelView[0][1] * n[0][1] + modelView[0][2] * n[0][2];
+    for (int column = 0; column < 3; ++column) {
+        float *normal = out + PoseBatch::MvpFloats + 4 * column;
+        for (int row = 0; row < 3; ++row)
+            normal[row] = det == 0.0f ? (row == column ? 1.0f : 0.0f) : n[column][row] / det;
+        normal[3] = 0.0f;
+    }
+}
+
+#endif
+
+}
+
+void PoseBatch::compute(const QMatrix4x4 &viewProjection, const QMatrix4x4 &view, const float *models,
+                        int modelStride, int count, float *out, int outStride)
+{
+#ifdef POSEBATCH_SSE2
+    __m128 viewProjectionColumns[4];
+    __m128 viewColumns[3];
+    for (int column = 0; column < 4; ++column) {
+        viewProjectionColumns[column] = _mm_loadu_ps(viewProjection.constData() + 4 * column);
+        if (column < 3)
+            viewColumns[column] = _mm_loadu_ps(view.constData() + 4 * column);
+    }
+    for (int i = 0; i < count; ++i, models += modelStride, out += outStride)
+        computeModel(viewProjectionColumns, viewColumns, models, out);
+#else
+    for (int i = 0; i < count; ++i, models += modelStride, out += outStride)
+        computeModel(viewProjection.constData(), view.constData(), models, out);
+#endif
+}
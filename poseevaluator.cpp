@@ -0,0 +1,494 @@
+/****************************************************************************
+**
+** Copyright (C) 2016 The Qt Company Ltd.
+** Contact: https://www.qt.io/licensing/
+**
+** This file is part of the examples of the Qt Toolkit.
+**
+** $QT_BEGIN_LICENSE:BSD$
+** Commercial License Usage
+** Licensees holding valid commercial Qt licenses may use this file in
+** accordance with the commercial license agreement provided with the
+** Software or, alternatively, in accordance with the terms contained in
+** a written agreement between you and The Qt Company. For licensing terms
+** and conditions see https://www.qt.io/terms-conditions. For further
+** information use the contact form at https://www.qt.io/contact-us.
+**
+** BSD License Usage
+** Alternatively, you may use this file under the terms of the BSD license
+** as follows:
+**
+** "Redistribution and use in source and binary forms, with or without
+** modification, are permitted provided that the following conditions are
+** met:
+**   * Redistributions of source code must retain the above copyright
+**     notice, this list of conditions and the following disclaimer.
+**   * Redistributions in binary form must reproduce the above copyright
+**     notice, this list of conditions and the following disclaimer in
+**     the documentation and/or other materials provided with the
+**     distribution.
+**   * Neither the name of The Qt Company Ltd nor the names of its
+**     contributors may be used to endorse or promote products derived
+**     from this software without specific prior written permission.
+**
+**
+** THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+** "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+** LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+** A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+** OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+** SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+** LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+** DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+** THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+** (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+** OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE."
+**
+** $QT_END_LICENSE$
+**
+****************************************************************************/
+
+#include "poseevaluator.h"
+#include "profiler.h"
+
+#include <QOffscreenSurface>
+#include <QOpenGLContext>
+#include <QOpenGLShaderProgram>
+#include <QSurfaceFormat>
+#include <QVector2D>
+#include <QDebug>
+
+#ifndef GL_SAMPLES_PASSED
+#define GL_SAMPLES_PASSED 0x8914
+#endif
+
+#define PROGRAM_VERTEX_ATTRIBUTE 0
+
+// Hypotheses submitted before their results are read back.
+static const int BatchSize = 256;
+
+// Stencil bits of the masks.
+static const GLuint GroundTruthBit = 0x1;
+static const GLuint EstimateBit = 0x2;
+// Where the surfaces of both are within the discrepancy tolerance.
+static const GLuint MatchBit = 0x4;
+
+static const char *vertexShaderObjectSource =
+        "attribute highp vec4 vertex;\n"
+        "uniform highp mat4 modelViewProjection;\n"
+        "uniform highp mat4 modelView;\n"
+        "varying highp float depth;\n"
+        "void main() {\n"
+        "   depth = -(modelView * vertex).z;\n"
+        "   gl_Position = modelViewProjection * vertex;\n"
+        "}\n";
+
+// Writes the distance along the optical axis. Fragments hidden in the test
+// image are dropped, when comparing also the ones too far from the ground
+// truth surface.
+static const char *fragmentShaderObjectSource =
+        "uniform sampler2D sceneDepth;\n"
+        "uniform sampler2D referenceDepth;\n"
+        "uniform bool useSceneDepth;\n"
+        "uniform bool compareWithReference;\n"
+        "uniform highp float visibilityTolerance;\n"
+        "uniform highp float discrepancyTolerance;\n"
+        "uniform highp vec2 imageSize;\n"
+        "varying highp float depth;\n"
+        "void main() {\n"
+        "   highp vec2 pixel = gl_FragCoord.xy / imageSize;\n"
+        "   if (useSceneDepth) {\n"
+        "       highp float scene = texture2D(sceneDepth, vec2(pixel.x, 1.0 - pixel.y)).r;\n"
+        "       if (scene > 0.0 && depth > scene + visibilityTolerance)\n"
+        "           discard;\n"
+        "   }\n"
+        "   if (compareWithReference && abs(depth - texture2D(referenceDepth, pixel).r) >= discrepancyTolerance)\n"
+        "       discard;\n"
+        "   gl_FragColor = vec4(depth, 0.0, 0.0, 1.0);\n"
+        "}\n";
+
+static const char *vertexShaderCountSource =
+        "attribute highp vec2 vertex;\n"
+        "void main() {\n"
+        "   gl_Position = vec4(vertex, 0.0, 1.0);\n"
+        "}\n";
+
+static const char *fragmentShaderCountSource =
+        "void main() {\n"
+        "   gl_FragColor = vec4(0.0);\n"
+        "}\n";
+
+// Every vertex becomes one point on the single pixel of the viewport.
+static const char *vertexShaderProjectionSource =
+        "attribute highp vec4 vertex;\n"
+        "uniform highp mat4 groundTruthMvp;\n"
+        "uniform highp mat4 estimateMvp;\n"
+        "uniform highp vec2 imageSize;\n"
+        "varying highp float distance;\n"
+        "highp vec2 project(highp mat4 mvp) {\n"
+        "   highp vec4 p = mvp * vertex;\n"
+        "   return (p.xy / p.w * 0.5 + 0.5) * imageSize;\n"
+        "}\n"
+        "void main() {\n"
+        "   distance = length(project(groundTruthMvp) - project(estimateMvp));\n"
+        "   gl_PointSize = 1.0;\n"
+        "   gl_Position = vec4(0.0, 0.0, 0.0, 1.0);\n"
+        "}\n";
+
+// Blended with GL_FUNC_ADD for RGB and GL_MAX for alpha: sum, count, -, max.
+static const char *fragmentShaderProjectionSource =
+        "varying highp float distance;\n"
+        "void main() {\n"
+        "   gl_FragColor = vec4(distance, 1.0, 0.0, distance);\n"
+        "}\n";
+
+PoseEvaluator::PoseEvaluator(const QSize &imageSize)
+    : m_size(imageSize),
+      m_quadBuffer(QOpenGLBuffer::VertexBuffer)
+{
+}
+
+PoseEvaluator::~PoseEvaluator()
+{
+    if (m_context && makeCurrent()) {
+        m_registry.destroy();
+        delete m_objectProgram;
+        delete m_countProgram;
+        delete m_projectionProgram;
+        m_quadVao.destroy();
+        m_quadBuffer.destroy();
+        const GLuint framebuffers[] = { m_maskFbo, m_compareFbo, m_reductionFbo };
+        glDeleteFramebuffers(3, framebuffers);
+        const GLuint textures[] = { m_depthTexture, m_sceneDepthTexture, m_reductionTexture };
+        glDeleteTextures(3, textures);
+        glDeleteRenderbuffers(1, &m_depthStencil);
+        if (!m_queries.isEmpty())
+            glDeleteQueries(m_queries.size(), m_queries.constData());
+        doneCurrent();
+    }
+    delete m_context;
+    delete m_surface;
+}
+
+bool PoseEvaluator::create()
+{
+    QSurfaceFormat format = QSurfaceFormat::defaultFormat();
+    format.setSamples(0);
+
+    m_surface = new QOffscreenSurface;
+    m_surface->setFormat(format);
+    m_surface->create();
+
+    m_context = new QOpenGLContext;
+    m_context->setFormat(format);
+    if (!m_context->create() || !makeCurrent()) {
+        qWarning() << "PoseEvaluator: could not create an OpenGL context";
+        return false;
+    }
+    if (m_context->isOpenGLES()) {
+        qWarning() << "PoseEvaluator: occlusion queries cannot count samples on OpenGL ES";
+        doneCurrent();
+        return false;
+    }
+
+    initializeOpenGLFunctions();
+    m_registry.create();
+    m_objectProgram = createProgram(vertexShaderObjectSource, fragmentShaderObjectSource);
+    m_objectProgram->bind();
+    m_objectProgram->setUniformValue("sceneDepth", 0);
+    m_objectProgram->setUniformValue("referenceDepth", 1);
+    m_objectProgram->setUniformValue("imageSize", QVector2D(m_size.width(), m_size.height()));
+    m_objectProgram->release();
+    m_modelViewProjectionLoc = m_objectProgram->uniformLocation("modelViewProjection");
+    m_modelViewLoc = m_objectProgram->uniformLocation("modelView");
+    m_compareLoc = m_objectProgram->uniformLocation("compareWithReference");
+
+    m_countProgram = createProgram(vertexShaderCountSource, fragmentShaderCountSource);
+
+    m_projectionProgram = createProgram(vertexShaderProjectionSource, fragmentShaderProjectionSource);
+    m_projectionProgram->bind();
+    m_projectionProgram->setUniformValue("imageSize", QVector2D(m_size.width(), m_size.height()));
+    m_projectionProgram->release();
+    m_groundTruthMvpLoc = m_projectionProgram->uniformLocation("groundTruthMvp");
+    m_estimateMvpLoc = m_projectionProgram->uniformLocation("estimateMvp");
+
+    // One quad covering the viewport, drawn as a triangle strip.
+    static const GLfloat quad[] = { -1.0f, -1.0f, 1.0f, -1.0f, -1.0f, 1.0f, 1.0f, 1.0f };
+    m_quadVao.create();
+    QOpenGLVertexArrayObject::Binder vaoBinder(&m_quadVao);
+    m_quadBuffer.create();
+    m_quadBuffer.bind();
+    m_quadBuffer.allocate(quad, sizeof(quad));
+    glEnableVertexAttribArray(PROGRAM_VERTEX_ATTRIBUTE);
+    glVertexAttribPointer(PROGRAM_VERTEX_ATTRIBUTE, 2, GL_FLOAT, GL_FALSE, 0, 0);
+    m_quadBuffer.release();
+
+    m_queries.resize(4 * BatchSize);
+    glGenQueries(m_queries.size(), m_queries.data());
+
+    const bool created = createFramebuffers();
+    doneCurrent();
+    return created;
+}
+
+QOpenGLShaderProgram *PoseEvaluator::createProgram(const char *vertexSource, const char *fragmentSource)
+{
+    QOpenGLShaderProgram *program = new QOpenGLShaderProgram;
+    program->addCacheableShaderFromSourceCode(QOpenGLShader::Vertex, vertexSource);
+    program->addCacheableShaderFromSourceCode(QOpenGLShader::Fragment, fragmentSource);
+    program->bindAttributeLocation("vertex", PROGRAM_VERTEX_ATTRIBUTE);
+    if (!program->link())
+        qWarning() << "PoseEvaluator: could not link a program" << program->log();
+    return program;
+}
+
+static GLuint createFloatTexture(QOpenGLExtraFunctions *f, GLenum internalFormat, GLenum format,
+                                 const QSize &size)
+{
+    GLuint texture;
+    f->glGenTextures(1, &texture);
+    f->glBindTexture(GL_TEXTURE_2D, texture);
+    f->glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+    f->glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+    f->glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+    f->glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+    f->glTexImage2D(GL_TEXTURE_2D, 0, internalFormat, size.width(), size.height(), 0, format, GL_FLOAT, nullptr);
+    f->glBindTexture(GL_TEXTURE_2D, 0);
+    return texture;
+}
+
+bool PoseEvaluator::createFramebuffers()
+{
+    m_depthTexture = createFloatTexture(this, GL_R32F, GL_RED, m_size);
+    glGenRenderbuffers(1, &m_depthStencil);
+    glBindRenderbuffer(GL_RENDERBUFFER, m_depthStencil);
+    glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH24_STENCIL8, m_size.width(), m_size.height());
+    glBindRenderbuffer(GL_RENDERBUFFER, 0);
+
+    glGenFramebuffers(1, &m_maskFbo);
+    glBindFramebuffer(GL_FRAMEBUFFER, m_maskFbo);
+    glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, m_depthTexture, 0);
+    glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_STENCIL_ATTACHMENT, GL_RENDERBUFFER, m_depthStencil);
+    bool complete = glCheckFramebufferStatus(GL_FRAMEBUFFER) == GL_FRAMEBUFFER_COMPLETE;
+
+    static const GLenum noColor = GL_NONE;
+    glGenFramebuffers(1, &m_compareFbo);
+    glBindFramebuffer(GL_FRAMEBUFFER, m_compareFbo);
+    glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_STENCIL_ATTACHMENT, GL_RENDERBUFFER, m_depthStencil);
+    glDrawBuffers(1, &noColor);
+    glReadBuffer(GL_NONE);
+    complete = complete && glCheckFramebufferStatus(GL_FRAMEBUFFER) == GL_FRAMEBUFFER_COMPLETE;
+
+    m_reductionTexture = createFloatTexture(this, GL_RGBA32F, GL_RGBA, QSize(BatchSize, 1));
+    glGenFramebuffers(1, &m_reductionFbo);
+    glBindFramebuffer(GL_FRAMEBUFFER, m_reductionFbo);
+    glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, m_reductionTexture, 0);
+    complete = complete && glCheckFramebufferStatus(GL_FRAMEBUFFER) == GL_FRAMEBUFFER_COMPLETE;
+
+    glBindFramebuffer(GL_FRAMEBUFFER, m_context->defaultFramebufferObject());
+    if (!complete) {
+        qWarning() << "PoseEvaluator: framebuffer objects of size" << m_size << "are incomplete";
+        const GLuint framebuffers[] = { m_maskFbo, m_compareFbo, m_reductionFbo };
+        glDeleteFramebuffers(3, framebuffers);
+        m_maskFbo = m_compareFbo = m_reductionFbo = 0;
+    }
+    return complete;
+}
+
+bool PoseEvaluator::makeCurrent()
+{
+    return m_context->makeCurrent(m_surface);
+}
+
+void PoseEvaluator::doneCurrent()
+{
+    m_context->doneCurrent();
+}
+
+int PoseEvaluator::addObjectModel(const ObjectModelRenerable &objectModel)
+{
+    if (!isValid() || !makeCurrent())
+        return -1;
+    const int modelId = m_registry.addModel(objectModel);
+    doneCurrent();
+    return modelId;
+}
+
+void PoseEvaluator::setSceneDepth(const QVector<float> &depth)
+{
+    m_hasSceneDepth = false;
+    if (depth.isEmpty())
+        return;
+    if (depth.size() != m_size.width() * m_size.height()) {
+        qWarning() << "PoseEvaluator: scene depth does not have" << m_size << "pixels";
+        return;
+    }
+    if (!isValid() || !makeCurrent())
+        return;
+    if (!m_sceneDepthTexture)
+        m_sceneDepthTexture = createFloatTexture(this, GL_R32F, GL_RED, m_size);
+    glBindTexture(GL_TEXTURE_2D, m_sceneDepthTexture);
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+    glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, m_size.width(), m_size.height(), GL_RED, GL_FLOAT, depth.constData());
+    glBindTexture(GL_TEXTURE_2D, 0);
+    m_hasSceneDepth = true;
+    doneCurrent();
+}
+
+void PoseEvaluator::drawObject(int modelId, const QMatrix4x4 &projection, const QMatrix4x4 &pose)
+{
+    const QMatrix4x4 modelView = SceneRenderer::viewMatrix(pose);
+    m_objectProgram->setUniformValue(m_modelViewProjectionLoc, projection * modelView);
+    m_objectProgram->setUniformValue(m_modelViewLoc, modelView);
+    m_registry.drawModel(modelId);
+}
+
+// Leaves the pixel counts of the ground truth mask, the estimate mask,
+// their intersection and the matching surfaces in the four queries.
+void PoseEvaluator::countMasks(const PoseHypothesis &hypothesis, const GLuint *queries)
+{
+    const QMatrix4x4 projection = SceneRenderer::projectionMatrix(hypothesis.intrinsics, m_size);
+
+    glBindFramebuffer(GL_FRAMEBUFFER, m_maskFbo);
+    glDepthMask(GL_TRUE);
+    glStencilMask(0xff);
+    glClearColor(0.0f, 0.0f, 0.0f, 0.0f);
+    glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT | GL_STENCIL_BUFFER_BIT);
+    glEnable(GL_DEPTH_TEST);
+    glDepthFunc(GL_LESS);
+    glEnable(GL_STENCIL_TEST);
+    glStencilOp(GL_KEEP, GL_KEEP, GL_REPLACE);
+
+    // Ground truth depth into the color target, its mask into the stencil.
+    m_registry.bind();
+    m_objectProgram->bind();
+    m_objectProgram->setUniformValue(m_compareLoc, false);
+    glStencilFunc(GL_ALWAYS, GroundTruthBit, 0xff);
+    glStencilMask(GroundTruthBit);
+    drawObject(hypothesis.modelId, projection, hypothesis.groundTruth);
+
+    // The estimate only goes to depth and stencil.
+    glBindFramebuffer(GL_FRAMEBUFFER, m_compareFbo);
+    glClear(GL_DEPTH_BUFFER_BIT);
+    glStencilFunc(GL_ALWAYS, EstimateBit, 0xff);
+    glStencilMask(EstimateBit);
+    drawObject(hypothesis.modelId, projection, hypothesis.estimate);
+
+    // Again, only its front surface passes now, marking pixels of both
+    // masks where it is close to the ground truth.
+    glDepthFunc(GL_LEQUAL);
+    glDepthMask(GL_FALSE);
+    glStencilFunc(GL_EQUAL, GroundTruthBit | EstimateBit | MatchBit, GroundTruthBit | EstimateBit);
+    glStencilMask(MatchBit);
+    m_objectProgram->setUniformValue(m_compareLoc, true);
+    drawObject(hypothesis.modelId, projection, hypothesis.estimate);
+    m_registry.release();
+
+    // Occlusion queries count pixels, not fragments, over one quad.
+    glDisable(GL_DEPTH_TEST);
+    glStencilOp(GL_KEEP, GL_KEEP, GL_KEEP);
+    glStencilMask(0);
+    m_countProgram->bind();
+    QOpenGLVertexArrayObject::Binder vaoBinder(&m_quadVao);
+    static const GLuint masks[] = { GroundTruthBit, EstimateBit, GroundTruthBit | EstimateBit, MatchBit };
+    for (int i = 0; i < 4; ++i) {
+        glStencilFunc(GL_EQUAL, masks[i], masks[i]);
+        glBeginQuery(GL_SAMPLES_PASSED, queries[i]);
+        glDrawArrays(GL_TRIANGLE_STRIP, 0, 4);
+        glEndQuery(GL_SAMPLES_PASSED);
+    }
+    glDisable(GL_STENCIL_TEST);
+    glDepthMask(GL_TRUE);
+}
+
+// Pixel i of the reduction target gets the errors of hypotheses[i].
+void PoseEvaluator::sumProjectionErrors(const PoseHypothesis *hypotheses, int count)
+{
+    glBindFramebuffer(GL_FRAMEBUFFER, m_reductionFbo);
+    glViewport(0, 0, BatchSize, 1);
+    glClearColor(0.0f, 0.0f, 0.0f, 0.0f);
+    glClear(GL_COLOR_BUFFER_BIT);
+    glEnable(GL_BLEND);
+    glBlendFunc(GL_ONE, GL_ONE);
+    glBlendEquationSeparate(GL_FUNC_ADD, GL_MAX);
+
+    m_projectionProgram->bind();
+    m_registry.bind();
+    for (int i = 0; i < count; ++i) {
+        const PoseHypothesis &hypothesis = hypotheses[i];
+        if (!hasModel(hypothesis.modelId))
+            continue;
+        const QMatrix4x4 projection = SceneRenderer::projectionMatrix(hypothesis.intrinsics, m_size);
+        m_projectionProgram->setUniformValue(m_groundTruthMvpLoc,
+                                             projection * SceneRenderer::viewMatrix(hypothesis.groundTruth));
+        m_projectionProgram->setUniformValue(m_estimateMvpLoc,
+                                             projection * SceneRenderer::viewMatrix(hypothesis.estimate));
+        const ModelRegistry::Model &model = m_registry.model(hypothesis.modelId);
+        glViewport(i, 0, 1, 1);
+        glDrawArrays(GL_POINTS, model.baseVertex, model.vertexCount);
+    }
+    m_registry.release();
+
+    glBlendEquation(GL_FUNC_ADD);
+    glDisable(GL_BLEND);
+}
+
+QVector<PoseMetrics> PoseEvaluator::evaluate(const QVector<PoseHypothesis> &hypotheses)
+{
+    QVector<PoseMetrics> metrics(hypotheses.size());
+    if (!isValid() || !makeCurrent())
+        return metrics;
+
+    m_objectProgram->bind();
+    m_objectProgram->setUniformValue("useSceneDepth", m_hasSceneDepth);
+    m_objectProgram->setUniformValue("visibilityTolerance", m_visibilityTolerance);
+    m_objectProgram->setUniformValue("discrepancyTolerance", m_discrepancyTolerance);
+    glActiveTexture(GL_TEXTURE0);
+    glBindTexture(GL_TEXTURE_2D, m_sceneDepthTexture);
+    glActiveTexture(GL_TEXTURE1);
+    glBindTexture(GL_TEXTURE_2D, m_depthTexture);
+    glActiveTexture(GL_TEXTURE0);
+
+    QVector<GLfloat> errors(4 * BatchSize);
+    for (int first = 0; first < hypotheses.size(); first += BatchSize) {
+        ProfileScope profile("pose evaluation");
+        const int count = qMin(BatchSize, hypotheses.size() - first);
+        glViewport(0, 0, m_size.width(), m_size.height());
+        for (int i = 0; i < count; ++i) {
+            const PoseHypothesis &hypothesis = hypotheses.at(first + i);
+            if (!hasModel(hypothesis.modelId)) {
+                qWarning() << "PoseEvaluator: no model" << hypothesis.modelId;
+                continue;
+            }
+            countMasks(hypothesis, m_queries.constData() + 4 * i);
+        }
+        sumProjectionErrors(hypotheses.constData() + first, count);
+
+        // The only readback: one pixel and four counts per hypothesis.
+        glPixelStorei(GL_PACK_ALIGNMENT, 4);
+        glReadPixels(0, 0, count, 1, GL_RGBA, GL_FLOAT, errors.data());
+        for (int i = 0; i < count; ++i) {
+            if (!hasModel(hypotheses.at(first + i).modelId))
+                continue;
+            GLuint pixels[4];
+            for (int k = 0; k < 4; ++k)
+                glGetQueryObjectuiv(m_queries.at(4 * i + k), GL_QUERY_RESULT, &pixels[k]);
+            const GLuint unionPixels = pixels[0] + pixels[1] - pixels[2];
+
+            PoseMetrics &result = metrics[first + i];
+            result.groundTruthPixels = pixels[0];
+            result.estimatePixels = pixels[1];
+            if (unionPixels > 0) {
+                result.maskIou = float(pixels[2]) / unionPixels;
+                result.vsd = 1.0f - float(pixels[3]) / unionPixels;
+            }
+            const GLfloat *error = errors.constData() + 4 * i;
+            result.meanProjectionError = error[1] > 0.0f ? error[0] / error[1] : 0.0f;
+            result.maxProjectionError = error[3];
+        }
+    }
+
+    glBindFramebuffer(GL_FRAMEBUFFER, m_context->defaultFramebufferObject());
+    doneCurrent();
+    return metrics;
+}
@@ -0,0 +1,171 @@
+/****************************************************************************
+**
+** Copyright (C) 2016 The Qt Company Ltd.
+** Contact: https://www.qt.io/licensing/
+**
+** This file is part of the examples of the Qt Toolkit.
+**
+** $QT_BEGIN_LICENSE:BSD$
+** Commercial License Usage
+** Licensees holding valid commercial Qt licenses may use this file in
+** accordance with the commercial license agreement provided with the
+** Software or, alternatively, in accordance with the terms contained in
+** a written agreement between you and The Qt Company. For licensing terms
+** and conditions see https://www.qt.io/terms-conditions. For further
+** information use the contact form at https://www.qt.io/contact-us.
+**
+** BSD License Usage
+** Alternatively, you may use this file under the terms of the BSD license
+** as follows:
+**
+** "Redistribution and use in source and binary forms, with or without
+** modification, are permitted provided that the following conditions are
+** met:
+**   * Redistributions of source code must retain the above copyright
+**     notice, this list of conditions and the following disclaimer.
+**   * Redistributions in binary form must reproduce the above copyright
+**     notice, this list of conditions and the following disclaimer in
+**     the documentation and/or other materials provided with the
+**     distribution.
+**   * Neither the name of The Qt Company Ltd nor the names of its
+**     contributors may be used to endorse or promote products derived
+**     from this software without specific prior written permission.
+**
+**
+** THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+** "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+** LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+** A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+** OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+** SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+** LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+** DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+** THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+** (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+** OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE."
+**
+** $QT_END_LICENSE$
+**
+****************************************************************************/
+
+#ifndef POSEEVALUATOR_H
+#define POSEEVALUATOR_H
+
+#include "scenerenderer.h"
+#include "modelregistry.h"
+
+#include <QOpenGLExtraFunctions>
+#include <QOpenGLBuffer>
+#include <QOpenGLVertexArrayObject>
+#include <QMatrix4x4>
+#include <QSize>
+#include <QVector>
+
+QT_FORWARD_DECLARE_CLASS(QOffscreenSurface)
+QT_FORWARD_DECLARE_CLASS(QOpenGLContext)
+QT_FORWARD_DECLARE_CLASS(QOpenGLShaderProgram)
+
+// An estimated pose and its ground truth, both model to camera R|t in
+// OpenCV convention as in BOP.
+struct PoseHypothesis
+{
+    int modelId = 0;
+    QMatrix4x4 groundTruth;
+    QMatrix4x4 estimate;
+    CameraIntrinsics intrinsics;
+};
+
+struct PoseMetrics
+{
+    // Intersection over union of the two (visible) masks.
+    float maskIou = 0.0f;
+    // Visible surface discrepancy: the share of the union of the visible
+    // masks where the surfaces are not within the discrepancy tolerance.
+    float vsd = 1.0f;
+    // Distance in pixels between the projections of every model vertex.
+    float meanProjectionError = 0.0f;
+    float maxProjectionError = 0.0f;
+    int groundTruthPixels = 0;
+    int estimatePixels = 0;
+};
+
+// Compares pose hypotheses on the GPU, without reading back images. Both
+// poses are rasterized into the stencil buffer of an offscreen framebuffer
+// and occlusion queries over a full screen quad count the pixels of the
+// masks, their intersection and where the depths agree. Projection errors
+// are summed into one float pixel per hypothesis with additive blending,
+// their maximum goes to alpha with GL_MAX. Per hypothesis only four query
+// results and one pixel come back, batches are read after all of their
+// hypotheses were submitted.
+//
+// Needs GL_SAMPLES_PASSED, which is desktop OpenGL only. Lives in the GUI
+// thread, like OffscreenRenderer.
+class PoseEvaluator : protected QOpenGLExtraFunctions
+{
+public:
+    explicit PoseEvaluator(const QSize &imageSize);
+    ~PoseEvaluator();
+
+    bool create();
+    bool isValid() const { return m_maskFbo != 0; }
+    QSize size() const { return m_size; }
+
+    // Returns the id hypotheses refer to.
+    int addObjectModel(const ObjectModelRenerable &objectModel);
+    // Depth of the test image in mm, rows top-down, 0 where unknown. With
+    // it, masks only keep what is visible in the test image, as the VSD of
+    // the BOP toolkit does. Without it, all of both objects count.
+    void setSceneDepth(const QVector<float> &depth);
+    // Defaults are the ones of the BOP challenge, in mm.
+    void setVisibilityTolerance(float tolerance) { m_visibilityTolerance = tolerance; }
+    void setDiscrepancyTolerance(float tolerance) { m_discrepancyTolerance = tolerance; }
+
+    QVector<PoseMetrics> evaluate(const QVector<PoseHypothesis> &hypotheses);
+
+private:
+    bool makeCurrent();
+    void doneCurrent();
+    bool createFramebuffers();
+    QOpenGLShaderProgram *createProgram(const char *vertexSource, const char *fragmentSource);
+    bool hasModel(int modelId) const { return modelId >= 0 && modelId < m_registry.modelCount(); }
+    void drawObject(int modelId, const QMatrix4x4 &projection, const QMatrix4x4 &pose);
+    void countMasks(const PoseHypothesis &hypothesis, const GLuint *queries);
+    void sumProjectionErrors(const PoseHypothesis *hypotheses, int count);
+
+    QSize m_size;
+    QOffscreenSurface *m_surface = nullptr;
+    QOpenGLContext *m_context = nullptr;
+    ModelRegistry m_registry;
+
+    // One program for all object passes, so the depth of the estimate
+    // comes out the same when it is drawn again with GL_LEQUAL.
+    QOpenGLShaderProgram *m_objectProgram = nullptr;
+    int m_modelViewProjectionLoc = -1;
+    int m_modelViewLoc = -1;
+    int m_compareLoc = -1;
+    QOpenGLShaderProgram *m_countProgram = nullptr;
+    QOpenGLShaderProgram *m_projectionProgram = nullptr;
+    int m_groundTruthMvpLoc = -1;
+    int m_estimateMvpLoc = -1;
+    QOpenGLVertexArrayObject m_quadVao;
+    QOpenGLBuffer m_quadBuffer;
+
+    // Ground truth depth goes to m_depthTexture through m_maskFbo. The
+    // compare pass samples it, so it draws into m_compareFbo, which has the
+    // same depth stencil buffer but no color.
+    GLuint m_depthTexture = 0;
+    GLuint m_depthStencil = 0;
+    GLuint m_maskFbo = 0;
+    GLuint m_compareFbo = 0;
+    GLuint m_sceneDepthTexture = 0;
+    bool m_hasSceneDepth = false;
+    // One RGBA32F pixel per hypothesis of a batch.
+    GLuint m_reductionTexture = 0;
+    GLuint m_reductionFbo = 0;
+    QVector<GLuint> m_queries;
+
+    float m_visibilityTolerance = 15.0f;
+    float m_discrepancyTolerance = 20.0f;
+};
+
+#endif // POSEEVALUATOR_H
@@ -0,0 +1,320 @@
+/****************************************************************************
+**
+** Copyright (C) 2016 The Qt Company Ltd.
+** Contact: https://www.qt.io/licensing/
+**
+** This file is part of the examples of the Qt Toolkit.
+**
+** $QT_BEGIN_LICENSE:BSD$
+** Commercial License Usage
+** Licensees holding valid commercial Qt licenses may use this file in
+** accordance with the commercial license agreement provided with the
+** Software or, alternatively, in accordance with the terms contained in
+** a written agreement between you and The Qt Company. For licensing terms
+** and conditions see https://www.qt.io/terms-conditions. For further
+** information use the contact form at https://www.qt.io/contact-us.
+**
+** BSD License Usage
+** Alternatively, you may use this file under the terms of the BSD license
+** as follows:
+**
+** "Redistribution and use in source and binary forms, with or without
+** modification, are permitted provided that the following conditions are
+** met:
+**   * Redistributions of source code must retain the above copyright
+**     notice, this list of conditions and the following disclaimer.
+**   * Redistributions in binary form must reproduce the above copyright
+**     notice, this list of conditions and the following disclaimer in
+**     the documentation and/or other materials provided with the
+**     distribution.
+**   * Neither the name of The Qt Company Ltd nor the names of its
+**     contributors may be used to endorse or promote products derived
+**     from this software without specific prior written permission.
+**
+**
+** THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+** "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+** LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+** A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+** OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+** SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+** LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+** DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+** THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+** (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+** OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE."
+**
+** $QT_END_LICENSE$
+**
+****************************************************************************/
+
+#include "profiler.h"
+
+#include <QOpenGLContext>
+#include <QSaveFile>
+#include <QThread>
+#if !defined(QT_OPENGL_ES_2)
+#include <QOpenGLTimerQuery>
+#endif
+
+#include <algorithm>
+
+std::atomic<bool> Profiler::s_enabled(false);
+
+// Trace process ids, CPU threads and GPU contexts each count from 1.
+static const int CpuProcess = 1;
+static const int GpuProcess = 2;
+
+Profiler::Profiler()
+{
+    m_clock.start();
+}
+
+Profiler *Profiler::instance()
+{
+    static Profiler profiler;
+    return &profiler;
+}
+
+void Profiler::setEnabled(bool enabled)
+{
+    s_enabled.store(enabled, std::memory_order_relaxed);
+}
+
+void Profiler::addCpuEvent(const char *name, qint64 start, qint64 duration)
+{
+    const Qt::HANDLE threadId = QThread::currentThreadId();
+    QMutexLocker locker(&m_mutex);
+    int thread = m_threads.value(threadId);
+    if (!thread) {
+        thread = m_threads.size() + 1;
+        m_threads.insert(threadId, thread);
+    }
+    addEvent(name, start, duration, thread, false);
+}
+
+void Profiler::addGpuEvent(const char *name, qint64 start, qint64 duration, const void *context)
+{
+    QMutexLocker locker(&m_mutex);
+    int track = m_gpuTracks.value(context);
+    if (!track) {
+        track = m_gpuTracks.size() + 1;
+        m_gpuTracks.insert(context, track);
+    }
+    addEvent(name, start, duration, track, true);
+}
+
+// Needs m_mutex to be locked.
+void Profiler::addEvent(const char *name, qint64 start, qint64 duration, int thread, bool gpu)
+{
+    if (m_events.size() < MaxTraceEvents) {
+        Event event = { name, start, duration, thread, gpu };
+        m_events.append(event);
+    }
+
+    const QByteArray key = QByteArray::fromRawData(name, int(qstrlen(name)));
+    QVector<qint64> &history = m_history[key];
+    int &position = m_historyPosition[key];
+    if (history.size() < HistorySize)
+        history.append(duration);
+    else
+        history[position] = duration;
+    position = (position + 1) % HistorySize;
+}
+
+QVector<QByteArray> Profiler::stageNames() const
+{
+    QMutexLocker locker(&m_mutex);
+    QVector<QByteArray> names;
+    for (auto it = m_history.constBegin(); it != m_history.constEnd(); ++it)
+        names.append(it.key());
+    std::sort(names.begin(), names.end());
+    return names;
+}
+
+Profiler::Stats Profiler::stats(const QByteArray &name) const
+{
+    QVector<qint64> durations;
+    {
+        QMutexLocker locker(&m_mutex);
+        durations = m_history.value(name);
+    }
+
+    Stats stats;
+    stats.count = durations.size();
+    if (durations.isEmpty())
+        return stats;
+    std::sort(durations.begin(), durations.end());
+    const auto percentile = [&durations](double p) {
+        const int index = qMin(durations.size() - 1, int(p * durations.size()));
+        return durations.at(index) / 1e6;
+    };
+    stats.median = percentile(0.5);
+    stats.p90 = percentile(0.9);
+    stats.p99 = percentile(0.99);
+    stats.max = durations.last() / 1e6;
+    return stats;
+}
+
+QString Profiler::summary() const
+{
+    QString text;
+    for (const QByteArray &name : stageNames()) {
+        const Stats s = stats(name);
+        text += QString::asprintf("%-24s n=%5d  p50 %8.3f ms  p90 %8.3f ms  p99 %8.3f ms  max %8.3f ms\n",
+                                  name.constData(), s.count, s.median, s.p90, s.p99, s.max);
+    }
+    return text;
+}
+
+bool Profiler::writeTrace(const QString &fileName) const
+{
+    QByteArray json;
+    {
+        QMutexLocker locker(&m_mutex);
+        json.reserve(m_events.size() * 96 + 256);
+        json += "{\"traceEvents\":[\n";
+        json += "{\"name\":\"process_name\",\"ph\":\"M\",\"pid\":1,\"args\":{\"name\":\"CPU\"}},\n";
+        json += "{\"name\":\"process_name\",\"ph\":\"M\",\"pid\":2,\"args\":{\"name\":\"GPU\"}}";
+        for (int track = 1; track <= m_gpuTracks.size(); ++track) {
+            json += ",\n{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":2,\"tid\":";
+            json += QByteArray::number(track);
+            json += ",\"args\":{\"name\":\"context ";
+            json += QByteArray::number(track);
+            json += "\"}}";
+        }
+        for (const Event &event : m_events) {
+            // Trace events are in microseconds.
+            json += ",\n{\"name\":\"";
+            json += event.name;
+            json += "\",\"cat\":\"";
+            json += event.gpu ? "gpu" : "cpu";
+            json += "\",\"ph\":\"X\",\"pid\":";
+            json += QByteArray::number(event.gpu ? GpuProcess : CpuProcess);
+            json += ",\"tid\":";
+            json += QByteArray::number(event.thread);
+            json += ",\"ts\":";
+            json += QByteArray::number(event.start / 1000.0, 'f', 3);
+            json += ",\"dur\":";
+            json += QByteArray::number(event.duration / 1000.0, 'f', 3);
+            json += '}';
+        }
+        json += "\n]}\n";
+    }
+
+    QSaveFile file(fileName);
+    if (!file.open(QIODevice::WriteOnly)) {
+        qWarning("Profiler: cannot write %s", qPrintable(fileName));
+        return false;
+    }
+    file.write(json);
+    return file.commit();
+}
+
+void Profiler::clear()
+{
+    QMutexLocker locker(&m_mutex);
+    m_events.clear();
+    m_history.clear();
+    m_historyPosition.clear();
+}
+
+GpuStageTimer::GpuStageTimer(const char *name, int ringSize)
+    : m_name(name)
+{
+    m_slots.resize(ringSize);
+}
+
+GpuStageTimer::~GpuStageTimer()
+{
+    // Queries are released through destroy() while the context is current.
+}
+
+void GpuStageTimer::create()
+{
+#if !defined(QT_OPENGL_ES_2)
+    QOpenGLContext *context = QOpenGLContext::currentContext();
+    if (context->isOpenGLES() || (context->format().version() < qMakePair(3, 3)
+                                  && !context->hasExtension("GL_ARB_timer_query"))) {
+        return;
+    }
+    for (Slot &slot : m_slots) {
+        slot.query = new QOpenGLTimerQuery;
+        if (!slot.query->create()) {
+            destroy();
+            return;
+        }
+    }
+#endif
+}
+
+void GpuStageTimer::destroy()
+{
+#if !defined(QT_OPENGL_ES_2)
+    if (m_running)
+        end();
+    collectPending();
+    for (Slot &slot : m_slots) {
+        delete slot.query;
+        slot = Slot();
+    }
+#endif
+    m_running = false;
+}
+
+void GpuStageTimer::begin()
+{
+#if !defined(QT_OPENGL_ES_2)
+    if (!Profiler::isEnabled() || !m_slots.at(m_next).query)
+        return;
+    Slot &slot = m_slots[m_next];
+    // The ring is full, the oldest result has to be there by now.
+    if (slot.pending)
+        collect(slot);
+    slot.start = Profiler::instance()->now();
+    slot.query->begin();
+    m_running = true;
+#endif
+}
+
+void GpuStageTimer::end()
+{
+#if !defined(QT_OPENGL_ES_2)
+    if (!m_running)
+        return;
+    Slot &slot = m_slots[m_next];
+    slot.query->end();
+    slot.pending = true;
+    m_running = false;
+    m_next = (m_next + 1) % m_slots.size();
+
+    // Pick up whatever finished meanwhile, without waiting.
+    for (Slot &other : m_slots) {
+        if (other.pending && &other != &slot && other.query->isResultAvailable())
+            collect(other);
+    }
+#endif
+}
+
+void GpuStageTimer::collectPending()
+{
+#if !defined(QT_OPENGL_ES_2)
+    // Oldest first, m_next is the slot issued longest ago.
+    for (int i = 0; i < m_slots.size(); ++i) {
+        Slot &slot = m_slots[(m_next + i) % m_slots.size()];
+        if (slot.pending)
+            collect(slot);
+    }
+#endif
+}
+
+void GpuStageTimer::collect(Slot &slot)
+{
+#if !defined(QT_OPENGL_ES_2)
+    Profiler::instance()->addGpuEvent(m_name, slot.start, qint64(slot.query->waitForResult()),
+                                      QOpenGLContext::currentContext());
+    slot.pending = false;
+#else
+    Q_UNUSED(slot);
+#endif
+}
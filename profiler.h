@@ -0,0 +1,187 @@
+/****************************************************************************
+**
+** Copyright (C) 2016 The Qt Company Ltd.
+** Contact: https://www.qt.io/licensing/
+**
+** This file is part of the examples of the Qt Toolkit.
+**
+** $QT_BEGIN_LICENSE:BSD$
+** Commercial License Usage
+** Licensees holding valid commercial Qt licenses may use this file in
+** accordance with the commercial license agreement provided with the
+** Software or, alternatively, in accordance with the terms contained in
+** a written agreement between you and The Qt Company. For licensing terms
+** and conditions see https://www.qt.io/terms-conditions. For further
+** information use the contact form at https://www.qt.io/contact-us.
+**
+** BSD License Usage
+** Alternatively, you may use this file under the terms of the BSD license
+** as follows:
+**
+** "Redistribution and use in source and binary forms, with or without
+** modification, are permitted provided that the following conditions are
+** met:
+**   * Redistributions of source code must retain the above copyright
+**     notice, this list of conditions and the following disclaimer.
+**   * Redistributions in binary form must reproduce the above copyright
+**     notice, this list of conditions and the following disclaimer in
+**     the documentation and/or other materials provided with the
+**     distribution.
+**   * Neither the name of The Qt Company Ltd nor the names of its
+**     contributors may be used to endorse or promote products derived
+**     from this software without specific prior written permission.
+**
+**
+** THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+** "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+** LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+** A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+** OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+** SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+** LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+** DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+** THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+** (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+** OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE."
+**
+** $QT_END_LICENSE$
+**
+****************************************************************************/
+
+#ifndef PROFILER_H
+#define PROFILER_H
+
+#include <QByteArray>
+#include <QElapsedTimer>
+#include <QHash>
+#include <QMutex>
+#include <QString>
+#include <QVector>
+
+#include <atomic>
+
+QT_FORWARD_DECLARE_CLASS(QOpenGLTimerQuery)
+
+// Collects CPU and GPU stage timings of the whole process, keeps rolling
+// percentiles per stage and writes Chrome trace event JSON (load it in
+// chrome://tracing or Perfetto). Disabled by default; while disabled every
+// probe is one relaxed atomic load.
+class Profiler
+{
+public:
+    struct Stats
+    {
+        int count = 0;
+        // Milliseconds, over the last HistorySize samples of the stage.
+        double median = 0.0;
+        double p90 = 0.0;
+        double p99 = 0.0;
+        double max = 0.0;
+    };
+
+    static const int HistorySize = 1024;
+    // Trace events beyond this are dropped, percentiles keep updating.
+    static const int MaxTraceEvents = 1 << 20;
+
+    static Profiler *instance();
+    static bool isEnabled() { return s_enabled.load(std::memory_order_relaxed); }
+    void setEnabled(bool enabled);
+
+    // Nanoseconds since the profiler was created, the time base of events.
+    qint64 now() const { return m_clock.nsecsElapsed(); }
+    // name has to outlive the profiler, pass string literals.
+    void addCpuEvent(const char *name, qint64 start, qint64 duration);
+    // GPU events are placed at the time their commands were issued, on
+    // one trace track per context.
+    void addGpuEvent(const char *name, qint64 start, qint64 duration, const void *context);
+
+    QVector<QByteArray> stageNames() const;
+    Stats stats(const QByteArray &name) const;
+    QString summary() const;
+    bool writeTrace(const QString &fileName) const;
+    void clear();
+
+private:
+    struct Event
+    {
+        const char *name;
+        qint64 start;
+        qint64 duration;
+        int thread;
+        bool gpu;
+    };
+
+    Profiler();
+    void addEvent(const char *name, qint64 start, qint64 duration, int thread, bool gpu);
+
+    static std::atomic<bool> s_enabled;
+    QElapsedTimer m_clock;
+    mutable QMutex m_mutex;
+    QVector<Event> m_events;
+    QHash<Qt::HANDLE, int> m_threads;
+    QHash<const void *, int> m_gpuTracks;
+    QHash<QByteArray, QVector<qint64>> m_history;
+    QHash<QByteArray, int> m_historyPosition;
+};
+
+// Records the time until the end of the enclosing scope as a CPU event.
+class ProfileScope
+{
+public:
+    explicit ProfileScope(const char *name)
+        : m_name(Profiler::isEnabled() ? name : nullptr),
+          m_start(m_name ? Profiler::instance()->now() : 0)
+    {
+    }
+
+    ~ProfileScope()
+    {
+        if (m_name)
+            Profiler::instance()->addCpuEvent(m_name, m_start, Profiler::instance()->now() - m_start);
+    }
+
+private:
+    Q_DISABLE_COPY(ProfileScope)
+
+    const char *m_name;
+    qint64 m_start;
+};
+
+// Times one GPU stage with a small ring of QOpenGLTimerQuery objects, so
+// results are collected frames later instead of stalling the pipeline.
+// Only one stage can be timed at a time, GL_TIME_ELAPSED queries do not
+// nest. Needs desktop OpenGL 3.3 or ARB_timer_query, without it the timer
+// silently does nothing.
+class GpuStageTimer
+{
+public:
+    explicit GpuStageTimer(const char *name, int ringSize = 4);
+    ~GpuStageTimer();
+
+    // Need the context to be current.
+    void create();
+    // Collects the results still in flight first.
+    void destroy();
+    void begin();
+    void end();
+    // Waits for every result still in flight, e.g. at the end of a batch,
+    // whose last frames would be missing otherwise.
+    void collectPending();
+
+private:
+    struct Slot
+    {
+        QOpenGLTimerQuery *query = nullptr;
+        qint64 start = 0;
+        bool pending = false;
+    };
+
+    void collect(Slot &slot);
+
+    const char *m_name;
+    QVector<Slot> m_slots;
+    int m_next = 0;
+    bool m_running = false;
+};
+
+#endif // PROFILER_H
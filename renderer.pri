@@ -0,0 +1,54 @@
+# Rendering core shared by the demo and the benchmark.
+INCLUDEPATH += $$PWD
+DEPENDPATH += $$PWD
+
+HEADERS += \
+    $$PWD/objectmodelrenderable.h \
+    $$PWD/scenerenderer.h \
+    $$PWD/offscreenrenderer.h \
+    $$PWD/rendererpool.h \
+    $$PWD/pixelreadbackring.h \
+    $$PWD/backgroundimagesource.h \
+    $$PWD/backgroundbandreader.h \
+    $$PWD/backgroundtexturering.h \
+    $$PWD/meshcache.h \
+    $$PWD/packedmesh.h \
+    $$PWD/modelregistry.h \
+    $$PWD/modelloader.h \
+    $$PWD/renderqueue.h \
+    $$PWD/posebatch.h \
+    $$PWD/poseevaluator.h \
+    $$PWD/cpurasterizer.h \
+    $$PWD/profiler.h \
+    $$PWD/meshsimplifier.h \
+    $$PWD/meshoptimizer.h \
+    $$PWD/antialiasing.h \
+    $$PWD/memoryreport.h \
+    $$PWD/tiledimagewriter.h
+SOURCES += \
+    $$PWD/objectmodelrenderable.cpp \
+    $$PWD/scenerenderer.cpp \
+    $$PWD/offscreenrenderer.cpp \
+    $$PWD/rendererpool.cpp \
+    $$PWD/pixelreadbackring.cpp \
+    $$PWD/backgroundimagesource.cpp \
+    $$PWD/backgroundbandreader.cpp \
+    $$PWD/backgroundtexturering.cpp \
+    $$PWD/meshcache.cpp \
+    $$PWD/packedmesh.cpp \
+    $$PWD/modelregistry.cpp \
+    $$PWD/modelloader.cpp \
+    $$PWD/renderqueue.cpp \
+    $$PWD/posebatch.cpp \
+    $$PWD/poseevaluator.cpp \
+    $$PWD/cpurasterizer.cpp \
+    $$PWD/profiler.cpp \
+    $$PWD/meshsimplifier.cpp \
+    $$PWD/meshoptimizer.cpp \
+    $$PWD/antialiasing.cpp \
+    $$PWD/memoryreport.cpp \
+    $$PWD/tiledimagewriter.cpp
+
+LIBS += -L/usr/local/lib -lassimp
+
+INCLUDEPATH += /usr/local/include/assimp
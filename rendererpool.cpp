@@ -0,0 +1,290 @@
+/****************************************************************************
+**
+** Copyright (C) 2016 The Qt Company Ltd.
+** Contact: https://www.qt.io/licensing/
+**
+** This file is part of the examples of the Qt Toolkit.
+**
+** $QT_BEGIN_LICENSE:BSD$
+** Commercial License Usage
+** Licensees holding valid commercial Qt licenses may use this file in
+** accordance with the commercial license agreement provided with the
+** Software or, alternatively, in accordance with the terms contained in
+** a written agreement between you and The Qt Company. For licensing terms
+** and conditions see https://www.qt.io/terms-conditions. For further
+** information use the contact form at https://www.qt.io/contact-us.
+**
+** BSD License Usage
+** Alternatively, you may use this file under the terms of the BSD license
+** as follows:
+**
+** "Redistribution and use in source and binary forms, with or without
+** modification, are permitted provided that the following conditions are
+** met:
+**   * Redistributions of source code must retain the above copyright
+**     notice, this list of conditions and the following disclaimer.
+**   * Redistributions in binary form must reproduce the above copyright
+**     notice, this list of conditions and the following disclaimer in
+**     the documentation and/or other materials provided with the
+**     distribution.
+**   * Neither the name of The Qt Company Ltd nor the names of its
+**     contributors may be used to endorse or promote products derived
+**     from this software without specific prior written permission.
+**
+**
+** THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+** "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+** LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+** A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+** OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+** SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+** LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+** DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+** THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+** (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+** OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE."
+**
+** $QT_END_LICENSE$
+**
+****************************************************************************/
+
+#include "rendererpool.h"
+#include "profiler.h"
+
+#include <QImageReader>
+#include <QMap>
+#include <QMutex>
+#include <QOpenGLContext>
+#include <QThread>
+#include <QWaitCondition>
+
+#include <deque>
+#include <functional>
+#include <vector>
+
+namespace {
+
+class WorkerThread : public QThread
+{
+public:
+    explicit WorkerThread(const std::function<void()> &work) : m_work(work) {}
+
+protected:
+    void run() override { m_work(); }
+
+private:
+    std::function<void()> m_work;
+};
+
+struct WorkQueue
+{
+    QMutex mutex;
+    std::deque<int> jobs;
+};
+
+// Shared by the workers and the thread delivering results of one batch.
+struct Batch
+{
+    explicit Batch(int workerCount) : queues(workerCount) {}
+
+    // QMutex cannot be copied, which QVector needs.
+    std::vector<WorkQueue> queues;
+    QMutex mutex;
+    QWaitCondition resultReady;
+    QWaitCondition deliveryDone;
+    QMap<int, QImage> results;
+    int nextDelivery = 0;
+    int window = 0;
+
+    // Every queue is in job order. A worker takes the front of its own
+    // while that is within the window of delivery, otherwise it steals
+    // the lowest job any queue holds: results are delivered in order, so
+    // that is the one holding everybody up.
+    bool takeJob(int worker, int *job)
+    {
+        for (;;) {
+            int limit;
+            {
+                QMutexLocker locker(&mutex);
+                limit = nextDelivery + window;
+            }
+            int victim = -1;
+            int victimFront = 0;
+            for (int i = 0; i < int(queues.size()); ++i) {
+                const int queueIndex = (worker + i) % queues.size();
+                WorkQueue &queue = queues[queueIndex];
+                QMutexLocker locker(&queue.mutex);
+                if (queue.jobs.empty())
+                    continue;
+                const int front = queue.jobs.front();
+                if (queueIndex == worker && front < limit) {
+                    victim = queueIndex;
+                    victimFront = front;
+                    break;
+                }
+                if (victim < 0 || front < victimFront) {
+                    victim = queueIndex;
+                    victimFront = front;
+                }
+            }
+            if (victim < 0)
+                return false;
+            WorkQueue &queue = queues[victim];
+            QMutexLocker locker(&queue.mutex);
+            // Taken by its owner or another thief since we looked, the next
+            // job there may be beyond the window, so look again.
+            if (queue.jobs.empty() || queue.jobs.front() != victimFront)
+                continue;
+            *job = queue.jobs.front();
+            queue.jobs.pop_front();
+            return true;
+        }
+    }
+};
+
+}
+
+RendererPool::RendererPool(const QSize &size, int workerCount, AntialiasingMode antialiasing)
+    : m_size(size),
+      m_requestedWorkers(workerCount > 0 ? workerCount : QThread::idealThreadCount()),
+      m_antialiasing(antialiasing)
+{
+}
+
+RendererPool::~RendererPool()
+{
+    // The shared buffers belong to the first renderer, the others let go
+    // of them before it deletes them.
+    for (int i = m_workers.size() - 1; i >= 0; --i)
+        delete m_workers.at(i);
+}
+
+bool RendererPool::create()
+{
+    for (int i = 0; i < m_requestedWorkers; ++i) {
+        OffscreenRenderer *renderer = new OffscreenRenderer(m_size, m_antialiasing);
+        // Backgrounds are decoded by the workers themselves.
+        renderer->setPrefetchCount(1);
+        m_workers.append(renderer);
+        if (!renderer->create(i > 0 ? m_workers.first()->context() : nullptr))
+            return false;
+    }
+    return true;
+}
+
+void RendererPool::setClearColor(const QColor &color)
+{
+    for (OffscreenRenderer *renderer : qAsConst(m_workers))
+        renderer->setClearColor(color);
+}
+
+void RendererPool::setVertexFormat(VertexFormat format)
+{
+    if (m_workers.isEmpty())
+        return;
+    m_workers.first()->setVertexFormat(format);
+    m_modelsChanged = true;
+}
+
+void RendererPool::setObjectModel(const ObjectModelRenerable &objectModel)
+{
+    if (m_workers.isEmpty())
+        return;
+    m_workers.first()->setObjectModel(objectModel);
+    m_modelsChanged = true;
+}
+
+int RendererPool::addObjectModel(const ObjectModelRenerable &objectModel)
+{
+    if (m_workers.isEmpty())
+        return -1;
+    m_modelsChanged = true;
+    return m_workers.first()->addObjectModel(objectModel);
+}
+
+MemoryReport RendererPool::memoryReport() const
+{
+    MemoryReport report;
+    for (int i = 0; i < m_workers.size(); ++i) {
+        const MemoryReport workerReport = m_workers.at(i)->memoryReport();
+        for (const MemoryReport::Entry &entry : workerReport.entries()) {
+            report.add(entry.category, QString("worker %1 %2").arg(i).arg(entry.name),
+                       entry.cpuBytes, entry.gpuBytes);
+        }
+    }
+    return report;
+}
+
+void RendererPool::render(const QVector<RenderJob> &jobs, const FrameCallback &callback)
+{
+    if (m_workers.isEmpty() || !m_workers.first()->isValid())
+        return;
+
+    if (m_modelsChanged) {
+        // The first renderer is done with the uploads, so the others see
+        // complete buffers.
+        m_workers.first()->finish();
+        for (int i = 1; i < m_workers.size(); ++i)
+            m_workers.at(i)->shareModels(*m_workers.first());
+        m_modelsChanged = false;
+    }
+
+    const int workerCount = m_workers.size();
+    Batch batch(workerCount);
+    batch.window = m_lookahead * workerCount;
+    for (int i = 0; i < jobs.size(); ++i)
+        batch.queues[i % workerCount].jobs.push_back(i);
+
+    QThread *guiThread = QThread::currentThread();
+    QVector<QThread *> threads;
+    for (int worker = 0; worker < workerCount; ++worker) {
+        OffscreenRenderer *renderer = m_workers.at(worker);
+        QThread *thread = new WorkerThread([&batch, &jobs, renderer, worker, guiThread]() {
+            int jobIndex;
+            while (batch.takeJob(worker, &jobIndex)) {
+                {
+                    // Do not run further ahead of delivery than the window.
+                    QMutexLocker locker(&batch.mutex);
+                    while (jobIndex >= batch.nextDelivery + batch.window)
+                        batch.deliveryDone.wait(&batch.mutex);
+                }
+
+                RenderJob job = jobs.at(jobIndex);
+                if (job.background.isNull() && !job.backgroundFile.isEmpty()) {
+                    ProfileScope profile("image decode");
+                    job.background = QImageReader(job.backgroundFile).read();
+                }
+                const QImage image = renderer->render(job);
+
+                QMutexLocker locker(&batch.mutex);
+                batch.results.insert(jobIndex, image);
+                batch.resultReady.wakeAll();
+            }
+            // Only the thread a context lives in can hand it on.
+            renderer->context()->moveToThread(guiThread);
+        });
+        thread->setObjectName(QString("RendererPool worker %1").arg(worker));
+        renderer->context()->moveToThread(thread);
+        threads.append(thread);
+        thread->start();
+    }
+
+    for (int i = 0; i < jobs.size(); ++i) {
+        QImage image;
+        {
+            QMutexLocker locker(&batch.mutex);
+            while (!batch.results.contains(i))
+                batch.resultReady.wait(&batch.mutex);
+            image = batch.results.take(i);
+        }
+        callback(i, image);
+        QMutexLocker locker(&batch.mutex);
+        ++batch.nextDelivery;
+        batch.deliveryDone.wakeAll();
+    }
+
+    for (QThread *thread : qAsConst(threads)) {
+        thread->wait();
+        delete thread;
+    }
+}
@@ -0,0 +1,105 @@
+/****************************************************************************
+**
+** Copyright (C) 2016 The Qt Company Ltd.
+** Contact: https://www.qt.io/licensing/
+**
+** This file is part of the examples of the Qt Toolkit.
+**
+** $QT_BEGIN_LICENSE:BSD$
+** Commercial License Usage
+** Licensees holding valid commercial Qt licenses may use this file in
+** accordance with the commercial license agreement provided with the
+** Software or, alternatively, in accordance with the terms contained in
+** a written agreement between you and The Qt Company. For licensing terms
+** and conditions see https://www.qt.io/terms-conditions. For further
+** information use the contact form at https://www.qt.io/contact-us.
+**
+** BSD License Usage
+** Alternatively, you may use this file under the terms of the BSD license
+** as follows:
+**
+** "Redistribution and use in source and binary forms, with or without
+** modification, are permitted provided that the following conditions are
+** met:
+**   * Redistributions of source code must retain the above copyright
+**     notice, this list of conditions and the following disclaimer.
+**   * Redistributions in binary form must reproduce the above copyright
+**     notice, this list of conditions and the following disclaimer in
+**     the documentation and/or other materials provided with the
+**     distribution.
+**   * Neither the name of The Qt Company Ltd nor the names of its
+**     contributors may be used to endorse or promote products derived
+**     from this software without specific prior written permission.
+**
+**
+** THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+** "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+** LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+** A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+** OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+** SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+** LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+** DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+** THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+** (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+** OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE."
+**
+** $QT_END_LICENSE$
+**
+****************************************************************************/
+
+#ifndef RENDERERPOOL_H
+#define RENDERERPOOL_H
+
+#include "offscreenrenderer.h"
+
+#include <QVector>
+
+// Renders batches on several threads, each with an OffscreenRenderer and
+// a context of its own. One llvmpipe context does not scale to many
+// cores, many of them side by side do. Models are uploaded once, by the
+// first renderer, the others draw them from its buffers through the share
+// group. Jobs are dealt out round robin to per worker queues, a worker
+// that gets too far ahead of delivery, or runs dry, steals from the
+// others. Everything here has to be called on the GUI thread.
+class RendererPool
+{
+public:
+    typedef OffscreenRenderer::FrameCallback FrameCallback;
+
+    // A workerCount of 0 starts one worker per core.
+    explicit RendererPool(const QSize &size, int workerCount = 0,
+                          AntialiasingMode antialiasing = AntialiasingMode::None);
+    ~RendererPool();
+
+    bool create();
+    int workerCount() const { return m_workers.size(); }
+    QSize size() const { return m_size; }
+
+    void setClearColor(const QColor &color);
+    void setVertexFormat(VertexFormat format);
+    void setObjectModel(const ObjectModelRenerable &objectModel);
+    // Returns the id jobs refer to in their SceneObjects.
+    int addObjectModel(const ObjectModelRenerable &objectModel);
+    // Results rendered ahead of the one callback waits for at most, per
+    // worker. Bounds the memory of images waiting for delivery.
+    void setLookahead(int framesPerWorker) { m_lookahead = qMax(1, framesPerWorker); }
+    // Everything the renderers hold, the shared models once.
+    MemoryReport memoryReport() const;
+
+    // Renders all jobs on the workers. callback runs on the calling thread,
+    // in job order, while the workers go on rendering.
+    void render(const QVector<RenderJob> &jobs, const FrameCallback &callback);
+
+private:
+    QSize m_size;
+    int m_requestedWorkers;
+    AntialiasingMode m_antialiasing;
+    QVector<OffscreenRenderer *> m_workers;
+    // Set when models changed, the workers share them again before the
+    // next batch.
+    bool m_modelsChanged = false;
+    int m_lookahead = 4;
+};
+
+#endif // RENDERERPOOL_H
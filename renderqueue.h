@@ -0,0 +1,96 @@
+/****************************************************************************
+**
+** Copyright (C) 2016 The Qt Company Ltd.
+** Contact: https://www.qt.io/licensing/
+**
+** This file is part of the examples of the Qt Toolkit.
+**
+** $QT_BEGIN_LICENSE:BSD$
+** Commercial License Usage
+** Licensees holding valid commercial Qt licenses may use this file in
+** accordance with the commercial license agreement provided with the
+** Software or, alternatively, in accordance with the terms contained in
+** a written agreement between you and The Qt Company. For licensing terms
+** and conditions see https://www.qt.io/terms-conditions. For further
+** information use the contact form at https://www.qt.io/contact-us.
+**
+** BSD License Usage
+** Alternatively, you may use this file under the terms of the BSD license
+** as follows:
+**
+** "Redistribution and use in source and binary forms, with or without
+** modification, are permitted provided that the following conditions are
+** met:
+**   * Redistributions of source code must retain the above copyright
+**     notice, this list of conditions and the following disclaimer.
+**   * Redistributions in binary form must reproduce the above copyright
+**     notice, this list of conditions and the following disclaimer in
+**     the documentation and/or other materials provided with the
+**     distribution.
+**   * Neither the name of The Qt Company Ltd nor the names of its
+**     contributors may be used to endorse or promote products derived
+**     from this software without specific prior written permission.
+**
+**
+** THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+** "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+** LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+** A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+** OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+** SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+** LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+** DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+** THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+** (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+** OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE."
+**
+** $QT_END_LICENSE$
+**
+****************************************************************************/
+
+#ifndef RENDERQUEUE_H
+#define RENDERQUEUE_H
+
+#include <QVector>
+
+// The draws of one frame. Items carry the state they need as a key and
+// are sorted by it, so opaque items sharing a program and then a model
+// follow each other and the state only changes between runs. Blending is
+// not commutative, so blended items come after all opaque ones, in the
+// order they were added. Items with equal keys keep that order as well.
+class RenderQueue
+{
+public:
+    struct Item
+    {
+        quint64 key = 0;
+        int programFeatures = 0;
+        int modelId = 0;
+        // Value written to the instance mask.
+        int objectId = 0;
+        // Instanced items draw instanceCount instances from firstInstance,
+        // others have an instanceCount of 0.
+        int firstInstance = 0;
+        int instanceCount = 0;
+        // Level of detail of the model to draw.
+        int level = 0;
+        // Where the PoseBatch entry of items drawn without instancing is
+        // in the matrices of the frame.
+        int matrixOffset = 0;
+    };
+
+    static quint64 sortKey(int programFeatures, int modelId);
+    // Key of a blended item, the submissionIndex-th one added.
+    static quint64 blendedSortKey(int submissionIndex);
+
+    void clear() { m_items.clear(); }
+    void add(const Item &item) { m_items.append(item); }
+    void sort();
+    bool isEmpty() const { return m_items.isEmpty(); }
+    const QVector<Item> &items() const { return m_items; }
+
+private:
+    QVector<Item> m_items;
+};
+
+#endif // RENDERQUEUE_H
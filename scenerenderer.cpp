@@ -0,0 +1,857 @@
+/****************************************************************************
+**
+** Copyright (C) 2016 The Qt Company Ltd.
+** Contact: https://www.qt.io/licensing/
+**
+** This file is part of the examples of the Qt Toolkit.
+**
+** $QT_BEGIN_LICENSE:BSD$
+** Commercial License Usage
+** Licensees holding valid commercial Qt licenses may use this file in
+** accordance with the commercial license agreement provided with the
+** Software or, alternatively, in accordance with the terms contained in
+** a written agreement between you and The Qt Company. For licensing terms
+** and conditions see https://www.qt.io/terms-conditions. For further
+** information use the contact form at https://www.qt.io/contact-us.
+**
+** BSD License Usage
+** Alternatively, you may use this file under the terms of the BSD license
+** as follows:
+**
+** "Redistribution and use in source and binary forms, with or without
+** modification, are permitted provided that the following conditions are
+** met:
+**   * Redistributions of source code must retain the above copyright
+**     notice, this list of conditions and the following disclaimer.
+**   * Redistributions in binary form must reproduce the above copyright
+**     notice, this list of conditions and the following disclaimer in
+**     the documentation and/or other materials provided with the
+**     distribution.
+**   * Neither the name of The Qt Company Ltd nor the names of its
+**     contributors may be used to endorse or promote products derived
+**     from this software without specific prior written permission.
+**
+**
+** THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+** "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+** LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+** A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+** OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+** SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+** LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+** DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+** THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+** (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+** OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE."
+**
+** $QT_END_LICENSE$
+**
+****************************************************************************/
+
+#include "scenerenderer.h"
+#include "modelloader.h"
+#include "posebatch.h"
+#include "profiler.h"
+#include <QOpenGLShaderProgram>
+#include <qmath.h>
+#include <QVector2D>
+#include <QDebug>
+#include <algorithm>
+#include <limits>
+
+#define PROGRAM_VERTEX_ATTRIBUTE 0
+#define PROGRAM_TEXCOORD_ATTRIBUTE 1
+#define PROGRAM_NORMAL_ATTRIBUTE 1
+// A mat4 attribute takes four consecutive locations, a mat3 three.
+#define PROGRAM_INSTANCE_MATRIX_ATTRIBUTE 2
+#define PROGRAM_INSTANCE_NORMAL_ATTRIBUTE 6
+#define PROGRAM_INSTANCE_COLOR_ATTRIBUTE 9
+
+// The PoseBatch entry of every instance followed by its color. All
+// attributes start at multiples of four floats.
+static const int InstanceFloats = PoseBatch::Stride + 4;
+static const int InstanceStride = InstanceFloats * sizeof(GLfloat);
+static const int InstanceAttributeCount = 8;
+
+static const char *vertexShaderBackgroundSource =
+        "attribute highp vec4 vertex;\n"
+        "attribute mediump vec4 texCoord;\n"
+        "varying mediump vec4 texc;\n"
+        "uniform mediump mat4 matrix;\n"
+        "uniform mediump vec2 texCoordScale;\n"
+        "void main(void)\n"
+        "{\n"
+        "    gl_Position = matrix * vertex;\n"
+        "    texc = vec4(texCoord.st * texCoordScale, texCoord.pq);\n"
+        "}\n";
+
+static const char *fragmentShaderBackgroundSource =
+        "uniform sampler2D texture;\n"
+        "varying mediump vec4 texc;\n"
+        "void main(void)\n"
+        "{\n"
+        "    gl_FragColor = texture2D(texture, texc.st);\n"
+        "}\n";
+
+// Variants of the object program are selected by prepending defines, see
+// SceneRenderer::objectProgram().
+static const char *vertexShaderObjectSource =
+        "#ifdef PACKED_VERTICES\n"
+        "attribute vec3 vertex;\n"
+        "attribute vec2 normal;\n"
+        "uniform vec3 meshOffset;\n"
+        "uniform vec3 meshScale;\n"
+        "vec3 decodeNormal(vec2 e) {\n"
+        "   vec3 n = vec3(e, 1.0 - abs(e.x) - abs(e.y));\n"
+        "   if (n.z < 0.0)\n"
+        "       n.xy = (1.0 - abs(n.yx)) * vec2(n.x >= 0.0 ? 1.0 : -1.0, n.y >= 0.0 ? 1.0 : -1.0);\n"
+        "   return normalize(n);\n"
+        "}\n"
+        "#else\n"
+        "attribute vec4 vertex;\n"
+        "attribute vec3 normal;\n"
+        "#endif\n"
+        "#ifdef INSTANCED\n"
+        "attribute mat4 instanceMatrix;\n"
+        "attribute mat3 instanceNormalMatrix;\n"
+        "attribute vec4 instanceColor;\n"
+        "varying vec4 instanceTint;\n"
+        "#endif\n"
+        "varying vec3 vert;\n"
+        "varying vec3 vertNormal;\n"
+        "uniform mat4 projectionMatrix;\n"
+        "uniform mat3 normalMatrix;\n"
+        "void main() {\n"
+        "#ifdef PACKED_VERTICES\n"
+        "   vec4 position = vec4(meshOffset + vertex * meshScale, 1.0);\n"
+        "   vec3 objectNormal = decodeNormal(normal);\n"
+        "#else\n"
+        "   vec4 position = vertex;\n"
+        "   vec3 objectNormal = normal;\n"
+        "#endif\n"
+        "   vert = position.xyz;\n"
+        "#ifdef INSTANCED\n"
+        "   vertNormal = instanceNormalMatrix * objectNormal;\n"
+        "   gl_Position = instanceMatrix * position;\n"
+        "   instanceTint = instanceColor;\n"
+        "#else\n"
+        "   vertNormal = normalMatrix * objectNormal;\n"
+        "   gl_Position = projectionMatrix * position;\n"
+        "#endif\n"
+        "}\n";
+
+static const char *fragmentShaderObjectSource =
+        "varying highp vec3 vert;\n"
+        "varying highp vec3 vertNormal;\n"
+        "#ifdef INSTANCED\n"
+        "varying highp vec4 instanceTint;\n"
+        "#endif\n"
+        "uniform highp vec3 lightPos;\n"
+        "#ifdef MULTIPLE_TARGETS\n"
+        "uniform highp float objectId;\n"
+        "uniform highp vec2 depthRange;\n"
+        "#endif\n"
+        "void main() {\n"
+        "   highp vec3 L = normalize(lightPos - vert);\n"
+        "   highp float NL = max(dot(normalize(vertNormal), L), 0.0);\n"
+        "#ifdef INSTANCED\n"
+        "   highp vec3 color = instanceTint.rgb;\n"
+        "   highp float alpha = instanceTint.a;\n"
+        "#else\n"
+        "   highp vec3 color = vec3(0.39, 1.0, 0.0);\n"
+        "   highp float alpha = 0.5;\n"
+        "#endif\n"
+        "   highp vec3 col = clamp(color * 0.2 + color * 0.8 * NL, 0.0, 1.0);\n"
+        "#ifdef MULTIPLE_TARGETS\n"
+        "   highp float n = depthRange.x;\n"
+        "   highp float f = depthRange.y;\n"
+        "   highp float ndcDepth = 2.0 * gl_FragCoord.z - 1.0;\n"
+        "   highp vec3 N = normalize(vertNormal);\n"
+        "   gl_FragData[0] = vec4(col, alpha);\n"
+        "   gl_FragData[1] = vec4(2.0 * n * f / (f + n - ndcDepth * (f - n)), 0.0, 0.0, 1.0);\n"
+        "   gl_FragData[2] = vec4(objectId, 0.0, 0.0, 1.0);\n"
+        "   gl_FragData[3] = vec4(N.x, -N.y, -N.z, 1.0);\n"
+        "#else\n"
+        "   gl_FragColor = vec4(col, alpha);\n"
+        "#endif\n"
+        "}\n";
+
+SceneRenderer::SceneRenderer()
+    : m_backgroundTimer("background pass"),
+      m_objectTimer("object pass")
+{
+}
+
+SceneRenderer::~SceneRenderer()
+{
+    // GL resources are released through cleanup(), which needs the
+    // context to be current and thus cannot run from here.
+}
+
+void SceneRenderer::initialize()
+{
+    initializeOpenGLFunctions();
+
+    glEnable(GL_DEPTH_TEST);
+    glEnable(GL_CULL_FACE);
+
+    makeBackgroundObject();
+    initializeBackgroundProgram();
+    setupBackgroundVertexBuffers();
+    m_backgroundTextures.create();
+
+    initializeObjectProgram();
+    m_modelRegistry.create();
+
+    m_instanceBuffer.setUsagePattern(QOpenGLBuffer::DynamicDraw);
+    m_instanceBuffer.create();
+
+    m_backgroundTimer.create();
+    m_objectTimer.create();
+}
+
+void SceneRenderer::cleanup()
+{
+    m_backgroundVao.destroy();
+    m_backgroundVbo.destroy();
+    m_backgroundTextures.destroy();
+    delete m_backgroundProgram;
+    m_backgroundProgram = nullptr;
+
+    m_modelRegistry.destroy();
+    m_objects.clear();
+    m_instanceBuffer.destroy();
+    m_instanceGroups.clear();
+    m_instanceModels.clear();
+    m_instanceData.clear();
+    m_objectMatrices.clear();
+    for (const ObjectProgram &program : qAsConst(m_objectPrograms))
+        delete program.program;
+    m_objectPrograms.clear();
+    m_renderQueue.clear();
+    m_renderQueueDirty = true;
+    m_backgroundTimer.destroy();
+    m_objectTimer.destroy();
+}
+
+QMatrix4x4 SceneRenderer::viewMatrix(const QMatrix4x4 &pose)
+{
+    // BOP poses use the OpenCV camera (y down, z forward), GL looks down -z.
+    QMatrix4x4 yz_flip;
+    yz_flip.setToIdentity();
+    yz_flip(1, 1) = -1;
+    yz_flip(2, 2) = -1;
+    return yz_flip * pose;
+}
+
+QMatrix4x4 SceneRenderer::projectionMatrix(const CameraIntrinsics &intrinsics, const QSize &imageSize)
+{
+    float w = (float) imageSize.width();
+    float h = (float) imageSize.height();
+    float nc = intrinsics.nearPlane;
+    float fc = intrinsics.farPlane;
+    float depth = (float) fc - nc;
+    float q = -(fc + nc) / depth;
+    float qn = -2 * (fc * nc) / depth;
+    return QMatrix4x4(2 * intrinsics.fx / w, -2 * intrinsics.skew / w, (-2 * intrinsics.cx + w) / w, 0,
+                      0, 2 * intrinsics.fy / h, (2 * intrinsics.cy - h) / h, 0,
+                      0,            0,                  q, qn,
+                      0,            0,                 -1, 0);
+}
+
+QMatrix4x4 SceneRenderer::tileMatrix(const QRect &tile, const QSize &imageSize)
+{
+    QMatrix4x4 matrix;
+    if (tile.isNull())
+        return matrix;
+
+    // Edges of the tile in normalized device coordinates, image rows run
+    // top-down. Scaling x and y along with the offset times w keeps the
+    // transform projective, it is the sub-frustum of the tile.
+    const float left = 2.0f * tile.x() / imageSize.width() - 1.0f;
+    const float right = 2.0f * (tile.x() + tile.width()) / imageSize.width() - 1.0f;
+    const float top = 1.0f - 2.0f * tile.y() / imageSize.height();
+    const float bottom = 1.0f - 2.0f * (tile.y() + tile.height()) / imageSize.height();
+    matrix(0, 0) = 2.0f / (right - left);
+    matrix(0, 3) = -(right + left) / (right - left);
+    matrix(1, 1) = 2.0f / (top - bottom);
+    matrix(1, 3) = -(top + bottom) / (top - bottom);
+    return matrix;
+}
+
+// All programs use cacheable shaders: link() loads a program binary from
+// the disk cache of Qt when there is one for the same sources (defines
+// included) and the same GL vendor, renderer and version, and compiles
+// and stores it otherwise. Short-lived batch contexts skip compiling.
+void SceneRenderer::initializeBackgroundProgram()
+{
+    m_backgroundProgram = new QOpenGLShaderProgram;
+    m_backgroundProgram->addCacheableShaderFromSourceCode(QOpenGLShader::Vertex, vertexShaderBackgroundSource);
+    m_backgroundProgram->addCacheableShaderFromSourceCode(QOpenGLShader::Fragment, fragmentShaderBackgroundSource);
+    m_backgroundProgram->bindAttributeLocation("vertex", PROGRAM_VERTEX_ATTRIBUTE);
+    m_backgroundProgram->bindAttributeLocation("texCoord", PROGRAM_TEXCOORD_ATTRIBUTE);
+    if (!m_backgroundProgram->link())
+        qWarning() << "SceneRenderer: could not link the background program" << m_backgroundProgram->log();
+
+    m_backgroundProgram->bind();
+    m_backgroundProgram->setUniformValue("texture", 0);
+    m_backgroundProgram->release();
+    m_backgroundMatrixLoc = m_backgroundProgram->uniformLocation("matrix");
+    m_backgroundTexCoordScaleLoc = m_backgroundProgram->uniformLocation("texCoordScale");
+
+    m_orthoMatrix.setToIdentity();
+    m_orthoMatrix.ortho(0, 1, 1, 0, 1.0f, 3.0f);
+    m_orthoMatrix.translate(0.0f, 0.0f, -2.0f);
+}
+
+void SceneRenderer::setupBackgroundVertexBuffers()
+{
+    m_backgroundProgram->bind();
+    m_backgroundVao.create();
+    QOpenGLVertexArrayObject::Binder vaoBinder(&m_backgroundVao);
+
+    // Setup our vertex buffer object.
+    m_backgroundVbo.create();
+    m_backgroundVbo.bind();
+    m_backgroundVbo.allocate(m_backgroundVertexData.constData(), m_backgroundVertexData.count() * sizeof(GLfloat));
+
+    glEnableVertexAttribArray(PROGRAM_VERTEX_ATTRIBUTE);
+    glEnableVertexAttribArray(PROGRAM_TEXCOORD_ATTRIBUTE);
+    glVertexAttribPointer(PROGRAM_VERTEX_ATTRIBUTE, 3, GL_FLOAT, GL_FALSE, 5 * sizeof(GLfloat), 0);
+    glVertexAttribPointer(PROGRAM_TEXCOORD_ATTRIBUTE, 2, GL_FLOAT, GL_FALSE, 5 * sizeof(GLfloat), reinterpret_cast<void *>(3 * sizeof(GLfloat)));
+    m_backgroundVbo.release();
+    m_backgroundProgram->release();
+}
+
+void SceneRenderer::makeBackgroundObject()
+{
+    static const int coords[4][3] = {
+         { +1, 0, 0 }, { 0, 0, 0 }, { 0, +1, 0 }, { +1, +1, 0 }
+    };
+
+    m_backgroundVertexData.clear();
+    for (int i = 0; i < 4; ++i) {
+        // vertex position
+        m_backgroundVertexData.append(coords[i][0]);
+        m_backgroundVertexData.append(coords[i][1]);
+        m_backgroundVertexData.append(coords[i][2]);
+        // texture coordinate, images are uploaded top row first so the
+        // vertical flip happens here instead of on the CPU
+        m_backgroundVertexData.append(i == 0 || i == 3);
+        m_backgroundVertexData.append(i == 2 || i == 3);
+    }
+}
+
+QImage SceneRenderer::prepareBackgroundImage(const QImage &image)
+{
+    return BackgroundTextureRing::uploadableImage(image);
+}
+
+void SceneRenderer::setBackgroundImage(const QImage &image, const QSize &textureSize)
+{
+    setPreparedBackgroundImage(prepareBackgroundImage(image), textureSize);
+}
+
+void SceneRenderer::setPreparedBackgroundImage(const QImage &image, const QSize &textureSize)
+{
+    if (image.isNull())
+        m_backgroundTextures.clear();
+    else
+        m_backgroundTextures.upload(image, textureSize);
+}
+
+void SceneRenderer::initializeObjectProgram()
+{
+    // The plain variant is needed right away, compile it up front.
+    objectProgram(0);
+}
+
+const SceneRenderer::ObjectProgram &SceneRenderer::objectProgram(int features)
+{
+    QHash<int, ObjectProgram>::const_iterator it = m_objectPrograms.constFind(features);
+    if (it != m_objectPrograms.constEnd())
+        return *it;
+
+    QByteArray defines;
+    if (features & PackedVerticesFeature)
+        defines += "#define PACKED_VERTICES\n";
+    if (features & InstancedFeature)
+        defines += "#define INSTANCED\n";
+    if (features & MultipleTargetsFeature)
+        defines += "#define MULTIPLE_TARGETS\n";
+
+    // Init objects shader program
+    QOpenGLShaderProgram *program = new QOpenGLShaderProgram;
+    program->addCacheableShaderFromSourceCode(QOpenGLShader::Vertex, defines + vertexShaderObjectSource);
+    program->addCacheableShaderFromSourceCode(QOpenGLShader::Fragment, defines + fragmentShaderObjectSource);
+    program->bindAttributeLocation("vertex", PROGRAM_VERTEX_ATTRIBUTE);
+    program->bindAttributeLocation("normal", PROGRAM_NORMAL_ATTRIBUTE);
+    if (features & InstancedFeature) {
+        program->bindAttributeLocation("instanceMatrix", PROGRAM_INSTANCE_MATRIX_ATTRIBUTE);
+        program->bindAttributeLocation("instanceNormalMatrix", PROGRAM_INSTANCE_NORMAL_ATTRIBUTE);
+        program->bindAttributeLocation("instanceColor", PROGRAM_INSTANCE_COLOR_ATTRIBUTE);
+    }
+    if (!program->link())
+        qWarning() << "SceneRenderer: could not link the object program" << defines << program->log();
+
+    ObjectProgram entry;
+    entry.program = program;
+    entry.projectionMatrixLoc = program->uniformLocation("projectionMatrix");
+    entry.normalMatrixLoc = program->uniformLocation("normalMatrix");
+    entry.meshOffsetLoc = program->uniformLocation("meshOffset");
+    entry.meshScaleLoc = program->uniformLocation("meshScale");
+    entry.objectIdLoc = program->uniformLocation("objectId");
+    entry.depthRangeLoc = program->uniformLocation("depthRange");
+
+    // Light position is fixed, uniforms keep their value in the program.
+    program->bind();
+    program->setUniformValue("lightPos", QVector3D(0, 0, 70));
+    program->release();
+
+    return *m_objectPrograms.insert(features, entry);
+}
+
+void SceneRenderer::collectGpuTimings()
+{
+    m_backgroundTimer.collectPending();
+    m_objectTimer.collectPending();
+}
+
+void SceneRenderer::setObjectModel(const ObjectModelRenerable &objectModel)
+{
+    m_modelRegistry.clear();
+    SceneObject object;
+    object.modelId = addObjectModel(objectModel);
+    m_objects = QVector<SceneObject>() << object;
+    m_renderQueueDirty = true;
+}
+
+void SceneRenderer::setSceneObjects(const QVector<SceneObject> &objects)
+{
+    m_objects = objects;
+    m_renderQueueDirty = true;
+}
+
+void SceneRenderer::setPose(const QMatrix4x4 &pose)
+{
+    m_pose = pose;
+    m_renderQueueDirty = true;
+}
+
+void SceneRenderer::setIntrinsics(const CameraIntrinsics &intrinsics)
+{
+    m_intrinsics = intrinsics;
+    m_renderQueueDirty = true;
+}
+
+void SceneRenderer::setTile(const QRect &tile)
+{
+    if (tile == m_tile)
+        return;
+    m_tile = tile;
+    m_renderQueueDirty = true;
+}
+
+void SceneRenderer::setMultipleTargets(bool enabled)
+{
+    if (enabled == m_multipleTargets)
+        return;
+    m_multipleTargets = enabled;
+    m_renderQueueDirty = true;
+}
+
+void SceneRenderer::setLodEnabled(bool enabled)
+{
+    if (enabled == m_lodEnabled)
+        return;
+    m_lodEnabled = enabled;
+    m_renderQueueDirty = true;
+}
+
+void SceneRenderer::setLodTrianglesPerPixel(float trianglesPerPixel)
+{
+    m_lodTrianglesPerPixel = trianglesPerPixel;
+    m_renderQueueDirty = true;
+}
+
+void SceneRenderer::setFlipVertical(bool flip)
+{
+    if (flip == m_flipVertical)
+        return;
+    m_flipVertical = flip;
+    m_renderQueueDirty = true;
+}
+
+int SceneRenderer::addObjectModel(const ObjectModelRenerable &objectModel)
+{
+    if (m_uploadBudget > 0)
+        return m_modelRegistry.addModelProgressive(ModelRegistry::prepareModel(objectModel, m_modelRegistry.vertexFormat()));
+    return m_modelRegistry.addModel(objectModel);
+}
+
+int SceneRenderer::addLoadedModel(LoadedModel &model)
+{
+    int modelId;
+    if (model.isUploaded()) {
+        modelId = m_modelRegistry.addModel(model.data, &model.vertexBuffer, &model.indexBuffer);
+        model.vertexBuffer.destroy();
+        model.indexBuffer.destroy();
+    } else if (m_uploadBudget > 0) {
+        modelId = m_modelRegistry.addModelProgressive(model.data);
+    } else {
+        modelId = m_modelRegistry.addModel(model.data);
+    }
+    // A progressive upload holds on to the arrays until it is done.
+    model.data.releaseCpuData();
+    return modelId;
+}
+
+bool SceneRenderer::shareModels(const SceneRenderer &source)
+{
+    if (!m_modelRegistry.shareModels(source.m_modelRegistry))
+        return false;
+    m_objects = source.m_objects;
+    m_renderQueueDirty = true;
+    setInstanceGroups(QVector<InstanceGroup>());
+    return true;
+}
+
+void SceneRenderer::reportMemory(MemoryReport *report) const
+{
+    // Shared models are reported by the renderer owning them.
+    if (!m_modelRegistry.sharesBuffers()) {
+        qint64 usedBytes = 0;
+        for (int modelId = 0; modelId < m_modelRegistry.modelCount(); ++modelId) {
+            const qint64 gpuBytes = m_modelRegistry.modelGpuBytes(modelId);
+            report->add("model", QString("#%1").arg(modelId), m_modelRegistry.modelCpuBytes(modelId), gpuBytes);
+            usedBytes += gpuBytes;
+        }
+        report->add("model arena", "unused", 0, m_modelRegistry.arenaBytes() - usedBytes);
+    }
+    report->add("background", "texture ring", 0, m_backgroundTextures.gpuBytes());
+    const qint64 instanceBytes = qint64(m_instanceData.capacity() + m_instanceModels.capacity()) * sizeof(GLfloat);
+    report->add("instances", "instance buffer", instanceBytes, qint64(m_instanceData.size()) * sizeof(GLfloat));
+}
+
+void SceneRenderer::setVertexFormat(VertexFormat format)
+{
+    if (format == m_modelRegistry.vertexFormat())
+        return;
+    m_modelRegistry.setVertexFormat(format);
+    m_objects.clear();
+    m_renderQueueDirty = true;
+    setInstanceGroups(QVector<InstanceGroup>());
+}
+
+void SceneRenderer::setInstanceGroups(const QVector<InstanceGroup> &groups)
+{
+    m_instanceGroups.clear();
+    m_instanceModels.clear();
+    m_instanceData.clear();
+    for (const InstanceGroup &group : groups) {
+        InstanceRange range;
+        range.modelId = group.modelId;
+        range.firstInstance = m_instanceModels.size() / 16;
+        range.instanceCount = group.instances.size();
+        range.blended = false;
+        for (const ObjectInstance &instance : group.instances) {
+            range.blended = range.blended || instance.color.w() < 1.0f;
+            const float *matrix = instance.modelMatrix.constData();
+            for (int i = 0; i < 16; ++i)
+                m_instanceModels.append(matrix[i]);
+        }
+        m_instanceGroups.append(range);
+    }
+
+    // The matrices in front of every color are filled in with the render
+    // queue, they depend on the camera.
+    m_instanceData.resize(m_instanceModels.size() / 16 * InstanceFloats);
+    GLfloat *color = m_instanceData.data() + PoseBatch::Stride;
+    for (const InstanceGroup &group : groups) {
+        for (const ObjectInstance &instance : group.instances) {
+            color[0] = instance.color.x();
+            color[1] = instance.color.y();
+            color[2] = instance.color.z();
+            color[3] = instance.color.w();
+            color += InstanceFloats;
+        }
+    }
+    m_instanceDataDirty = true;
+    m_renderQueueDirty = true;
+}
+
+void SceneRenderer::render(const QSize &imageSize)
+{
+    static const GLenum drawBuffers[TargetCount] = {
+        GL_COLOR_ATTACHMENT0, GL_COLOR_ATTACHMENT1, GL_COLOR_ATTACHMENT2, GL_COLOR_ATTACHMENT3
+    };
+    if (m_multipleTargets) {
+        // The auxiliary targets are cleared to zero, which reads as no
+        // object. Afterwards only the color target stays enabled until
+        // the objects get drawn, gl_FragColor of the background would
+        // go to all of them.
+        static const GLfloat zero[4] = { 0.0f, 0.0f, 0.0f, 0.0f };
+        glDrawBuffers(TargetCount, drawBuffers);
+        for (int target = DepthTarget; target < TargetCount; ++target)
+            glClearBufferfv(GL_COLOR, target, zero);
+        glDrawBuffers(1, drawBuffers);
+    }
+
+    if (hasPendingUploads()) {
+        ProfileScope profile("model upload");
+        const int pendingCount = m_modelRegistry.pendingUploadCount();
+        m_modelRegistry.uploadPending(m_uploadBudget > 0 ? m_uploadBudget : std::numeric_limits<int>::max());
+        // Finished models may get a coarser level of detail now.
+        if (m_modelRegistry.pendingUploadCount() != pendingCount)
+            m_renderQueueDirty = true;
+    }
+
+    glClearColor(m_clearColor.redF(), m_clearColor.greenF(), m_clearColor.blueF(), m_clearColor.alphaF());
+    glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+
+    // Flipping the image also flips the winding of every triangle.
+    QMatrix4x4 flip;
+    if (m_flipVertical) {
+        flip.scale(1.0f, -1.0f, 1.0f);
+        glFrontFace(GL_CW);
+    }
+
+    if (m_backgroundTextures.hasImage()) {
+        m_backgroundTimer.begin();
+        m_backgroundProgram->bind();
+        QOpenGLVertexArrayObject::Binder vaoBinder(&m_backgroundVao);
+
+        m_backgroundProgram->setUniformValue(m_backgroundMatrixLoc, flip * m_orthoMatrix);
+        // Only the top left of the texture is covered by smaller images.
+        const QSize textureSize = m_backgroundTextures.size();
+        const QSize backgroundSize = m_backgroundTextures.imageSize();
+        m_backgroundProgram->setUniformValue(m_backgroundTexCoordScaleLoc,
+                                             QVector2D(float(backgroundSize.width()) / textureSize.width(),
+                                                       float(backgroundSize.height()) / textureSize.height()));
+        m_backgroundTextures.bind();
+        glDrawArrays(GL_TRIANGLE_FAN, 0, 4);
+        m_backgroundProgram->release();
+        m_backgroundTimer.end();
+    }
+
+    if (m_objects.isEmpty() && m_instanceGroups.isEmpty()) {
+        glFrontFace(GL_CCW);
+        return;
+    }
+
+    glClear(GL_DEPTH_BUFFER_BIT);
+    glEnable(GL_BLEND);
+    glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+
+    if (m_multipleTargets) {
+        // Depth, mask and normals are data, not something to blend.
+        glDrawBuffers(TargetCount, drawBuffers);
+        for (int target = DepthTarget; target < TargetCount; ++target)
+            glDisablei(GL_BLEND, target);
+    }
+
+    if (m_renderQueueDirty || imageSize != m_renderQueueSize) {
+        ProfileScope profile("render queue build");
+        buildRenderQueue(flip * tileMatrix(m_tile, imageSize) * projectionMatrix(m_intrinsics, imageSize));
+        m_renderQueueSize = imageSize;
+        m_renderQueueDirty = false;
+    }
+    m_objectTimer.begin();
+    drawRenderQueue();
+    m_objectTimer.end();
+
+    if (m_multipleTargets)
+        glDrawBuffers(1, drawBuffers);
+    glDisable(GL_BLEND);
+    glFrontFace(GL_CCW);
+}
+
+// Only rebuilt when the scene or the camera changes, so repainting the
+// same scene does no matrix math at all.
+void SceneRenderer::buildRenderQueue(const QMatrix4x4 &projection)
+{
+    m_renderQueue.clear();
+    int format = m_modelRegistry.vertexFormat() == VertexFormat::Packed ? PackedVerticesFeature : 0;
+    if (m_multipleTargets)
+        format |= MultipleTargetsFeature;
+    const QMatrix4x4 view = viewMatrix(m_pose);
+    const QMatrix4x4 viewProjection = projection * view;
+
+    // Every matrix of the frame comes out of two PoseBatch runs, the one
+    // over the instances writes straight into the instance data.
+    QVector<GLfloat> objectModels(m_objects.size() * 16);
+    for (int i = 0; i < m_objects.size(); ++i)
+        std::copy_n(m_objects.at(i).modelMatrix.constData(), 16, objectModels.data() + 16 * i);
+    m_objectMatrices.resize(m_objects.size() * PoseBatch::Stride);
+    PoseBatch::compute(viewProjection, view, objectModels.constData(), 16, m_objects.size(), m_objectMatrices.data());
+    if (!m_instanceModels.isEmpty()) {
+        PoseBatch::compute(viewProjection, view, m_instanceModels.constData(), 16, m_instanceModels.size() / 16,
+                           m_instanceData.data(), InstanceFloats);
+        m_instanceDataDirty = true;
+    }
+
+    // Mask values count objects first, then instance groups, from 1 on.
+    int objectId = 0;
+    for (int i = 0; i < m_objects.size(); ++i) {
+        RenderQueue::Item item;
+        item.objectId = ++objectId;
+        item.programFeatures = format;
+        item.modelId = m_objects.at(i).modelId;
+        // The object program always draws at half alpha.
+        item.key = RenderQueue::blendedSortKey(objectId);
+        item.matrixOffset = i * PoseBatch::Stride;
+        item.level = selectLevel(item.modelId, m_objectMatrices.constData() + item.matrixOffset);
+        m_renderQueue.add(item);
+    }
+
+    for (const InstanceRange &range : m_instanceGroups) {
+        ++objectId;
+        if (range.instanceCount == 0)
+            continue;
+        RenderQueue::Item item;
+        item.objectId = objectId;
+        item.programFeatures = format | InstancedFeature;
+        item.modelId = range.modelId;
+        item.key = range.blended ? RenderQueue::blendedSortKey(objectId)
+                                : RenderQueue::sortKey(item.programFeatures, item.modelId);
+        item.firstInstance = range.firstInstance;
+        item.instanceCount = range.instanceCount;
+        // The whole group shares one level, fine enough for its largest
+        // instance on screen.
+        item.level = m_modelRegistry.model(item.modelId).levels.size() - 1;
+        for (int i = 0; i < range.instanceCount; ++i) {
+            const int instance = range.firstInstance + i;
+            item.level = qMin(item.level, selectLevel(item.modelId, m_instanceData.constData() + instance * InstanceFloats));
+        }
+        m_renderQueue.add(item);
+    }
+
+    m_renderQueue.sort();
+}
+
+// Estimates the projected area of the bounding sphere and picks the
+// coarsest level with enough triangles for it.
+int SceneRenderer::selectLevel(int modelId, const GLfloat *matrices) const
+{
+    const ModelRegistry::Model &model = m_modelRegistry.model(modelId);
+    if (!m_lodEnabled || model.levels.size() < 2 || !model.isUploaded())
+        return 0;
+
+    // Every projection here keeps the camera distance -z in clip space w.
+    const QVector3D &center = model.sphereCenter;
+    const float distance = matrices[3] * center.x() + matrices[7] * center.y() + matrices[11] * center.z()
+            + matrices[15];
+    // The normal matrix scales by the inverse of the model view, its
+    // shortest column by the inverse of the largest scale.
+    float inverseScale = std::numeric_limits<float>::max();
+    for (int column = 0; column < 3; ++column) {
+        const GLfloat *normal = matrices + PoseBatch::MvpFloats + 4 * column;
+        inverseScale = qMin(inverseScale, QVector3D(normal[0], normal[1], normal[2]).length());
+    }
+    if (inverseScale <= 0.0f)
+        return 0;
+    const float radius = model.sphereRadius / inverseScale;
+    if (distance <= radius || m_intrinsics.fy <= 0.0f)
+        return 0;
+
+    const float radiusPixels = radius * m_intrinsics.fy / distance;
+    const float wantedTriangles = float(M_PI) * radiusPixels * radiusPixels * m_lodTrianglesPerPixel;
+    int level = 0;
+    while (level + 1 < model.levels.size() && model.levels.at(level + 1).triangleCount >= wantedTriangles)
+        ++level;
+    return level;
+}
+
+void SceneRenderer::drawRenderQueue()
+{
+    m_modelRegistry.bind();
+    if (!m_instanceGroups.isEmpty()) {
+        // Bound after the registry, which may bind its own vertex buffer.
+        m_instanceBuffer.bind();
+        if (m_instanceDataDirty) {
+            m_instanceBuffer.allocate(m_instanceData.constData(), m_instanceData.size() * sizeof(GLfloat));
+            m_instanceDataDirty = false;
+        }
+    }
+
+    const ObjectProgram *program = nullptr;
+    int programFeatures = -1;
+    int modelId = -1;
+    for (const RenderQueue::Item &item : m_renderQueue.items()) {
+        if (item.programFeatures != programFeatures) {
+            if (program && (programFeatures & InstancedFeature))
+                setInstanceAttributesEnabled(false);
+            program = &objectProgram(item.programFeatures);
+            program->program->bind();
+            if (item.programFeatures & InstancedFeature)
+                setInstanceAttributesEnabled(true);
+            if (item.programFeatures & MultipleTargetsFeature) {
+                program->program->setUniformValue(program->depthRangeLoc,
+                                                  QVector2D(m_intrinsics.nearPlane, m_intrinsics.farPlane));
+            }
+            programFeatures = item.programFeatures;
+            modelId = -1;
+        }
+
+        if (item.modelId != modelId) {
+            if (programFeatures & PackedVerticesFeature) {
+                const ModelRegistry::Model &model = m_modelRegistry.model(item.modelId);
+                program->program->setUniformValue(program->meshOffsetLoc, model.boundsMin);
+                program->program->setUniformValue(program->meshScaleLoc, model.boundsScale);
+            }
+            modelId = item.modelId;
+        }
+
+        if (programFeatures & MultipleTargetsFeature)
+            program->program->setUniformValue(program->objectIdLoc, GLfloat(item.objectId));
+        if (item.instanceCount > 0) {
+            // Point the instance attributes at the first instance of the
+            // item: the columns of both matrices, then the color.
+            const qintptr offset = qintptr(item.firstInstance) * InstanceStride;
+            for (int column = 0; column < InstanceAttributeCount; ++column) {
+                const int attribute = PROGRAM_INSTANCE_MATRIX_ATTRIBUTE + column;
+                const bool normalColumn = attribute >= PROGRAM_INSTANCE_NORMAL_ATTRIBUTE
+                        && attribute < PROGRAM_INSTANCE_COLOR_ATTRIBUTE;
+                glVertexAttribPointer(attribute, normalColumn ? 3 : 4, GL_FLOAT, GL_FALSE, InstanceStride,
+                                      reinterpret_cast<void *>(offset + column * 4 * sizeof(GLfloat)));
+            }
+            m_modelRegistry.drawModelInstanced(item.modelId, item.instanceCount, item.level);
+        } else {
+            const GLfloat *matrices = m_objectMatrices.constData() + item.matrixOffset;
+            glUniformMatrix4fv(program->projectionMatrixLoc, 1, GL_FALSE, matrices);
+            // The uniform takes the normal matrix without padding.
+            const GLfloat *normal = matrices + PoseBatch::MvpFloats;
+            const GLfloat normalMatrix[9] = {
+                normal[0], normal[1], normal[2],
+                normal[4], normal[5], normal[6],
+                normal[8], normal[9], normal[10]
+            };
+            glUniformMatrix3fv(program->normalMatrixLoc, 1, GL_FALSE, normalMatrix);
+            m_modelRegistry.drawModel(item.modelId, item.level);
+        }
+    }
+    if (program) {
+        if (programFeatures & InstancedFeature)
+            setInstanceAttributesEnabled(false);
+        program->program->release();
+    }
+
+    if (!m_instanceGroups.isEmpty())
+        m_instanceBuffer.release();
+    m_modelRegistry.release();
+}
+
+// The registry VAO is shared with non-instanced drawing, so the instance
+// attributes are only enabled while an instanced program is bound.
+void SceneRenderer::setInstanceAttributesEnabled(bool enabled)
+{
+    for (int column = 0; column < InstanceAttributeCount; ++column) {
+        if (enabled) {
+            glEnableVertexAttribArray(PROGRAM_INSTANCE_MATRIX_ATTRIBUTE + column);
+            glVertexAttribDivisor(PROGRAM_INSTANCE_MATRIX_ATTRIBUTE + column, 1);
+        } else {
+            glVertexAttribDivisor(PROGRAM_INSTANCE_MATRIX_ATTRIBUTE + column, 0);
+            glDisableVertexAttribArray(PROGRAM_INSTANCE_MATRIX_ATTRIBUTE + column);
+        }
+    }
+}
@@ -0,0 +1,286 @@
+/****************************************************************************
+**
+** Copyright (C) 2016 The Qt Company Ltd.
+** Contact: https://www.qt.io/licensing/
+**
+** This file is part of the examples of the Qt Toolkit.
+**
+** $QT_BEGIN_LICENSE:BSD$
+** Commercial License Usage
+** Licensees holding valid commercial Qt licenses may use this file in
+** accordance with the commercial license agreement provided with the
+** Software or, alternatively, in accordance with the terms contained in
+** a written agreement between you and The Qt Company. For licensing terms
+** and conditions see https://www.qt.io/terms-conditions. For further
+** information use the contact form at https://www.qt.io/contact-us.
+**
+** BSD License Usage
+** Alternatively, you may use this file under the terms of the BSD license
+** as follows:
+**
+** "Redistribution and use in source and binary forms, with or without
+** modification, are permitted provided that the following conditions are
+** met:
+**   * Redistributions of source code must retain the above copyright
+**     notice, this list of conditions and the following disclaimer.
+**   * Redistributions in binary form must reproduce the above copyright
+**     notice, this list of conditions and the following disclaimer in
+**     the documentation and/or other materials provided with the
+**     distribution.
+**   * Neither the name of The Qt Company Ltd nor the names of its
+**     contributors may be used to endorse or promote products derived
+**     from this software without specific prior written permission.
+**
+**
+** THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+** "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+** LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+** A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+** OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+** SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+** LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+** DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+** THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+** (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+** OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE."
+**
+** $QT_END_LICENSE$
+**
+****************************************************************************/
+
+#ifndef SCENERENDERER_H
+#define SCENERENDERER_H
+
+#include "objectmodelrenderable.h"
+#include "backgroundtexturering.h"
+#include "packedmesh.h"
+#include "modelregistry.h"
+#include "renderqueue.h"
+#include "memoryreport.h"
+#include "profiler.h"
+
+#include <QOpenGLExtraFunctions>
+#include <QOpenGLVertexArrayObject>
+#include <QOpenGLBuffer>
+#include <QMatrix4x4>
+#include <QColor>
+#include <QImage>
+#include <QHash>
+#include <QRect>
+#include <QVector>
+#include <QVector4D>
+
+QT_FORWARD_DECLARE_CLASS(QOpenGLShaderProgram)
+
+struct LoadedModel;
+
+// Pinhole intrinsics as stored in the BOP / T-LESS ground truth files,
+// plus the clipping planes used for the GL projection.
+struct CameraIntrinsics
+{
+    float fx = 0.f;
+    float fy = 0.f;
+    float cx = 0.f;
+    float cy = 0.f;
+    float skew = 0.f;
+    float nearPlane = 100.f;
+    float farPlane = 1000.f;
+};
+
+// One model of the scene, modelMatrix places it relative to the pose
+// given to SceneRenderer::setPose(). BOP scenes with many objects use the
+// identity as pose and the per object R|t as modelMatrix.
+struct SceneObject
+{
+    int modelId = 0;
+    QMatrix4x4 modelMatrix;
+};
+
+// One of many poses of the same model drawn with a single instanced call.
+// modelMatrix works like the one of SceneObject.
+struct ObjectInstance
+{
+    QMatrix4x4 modelMatrix;
+    QVector4D color = QVector4D(0.39f, 1.0f, 0.0f, 0.5f);
+};
+
+struct InstanceGroup
+{
+    int modelId = 0;
+    QVector<ObjectInstance> instances;
+};
+
+// Draws the background image and the object model on top of it into the
+// currently bound framebuffer. GLWidget and OffscreenRenderer both use it,
+// so interactive and batch composites come out of the same code.
+class SceneRenderer : protected QOpenGLExtraFunctions
+{
+public:
+    SceneRenderer();
+    ~SceneRenderer();
+
+    // Everything below needs the context of the renderer to be current.
+    void initialize();
+    void cleanup();
+    // Waits for the GPU timings still in flight, see GpuStageTimer.
+    void collectGpuTimings();
+    // Images smaller than a valid textureSize go into the top left of a
+    // texture of that size, so images of varying size, like the tiles of
+    // OffscreenRenderer::renderTiled(), do not reallocate it.
+    void setBackgroundImage(const QImage &image, const QSize &textureSize = QSize());
+    // Takes an image that already went through prepareBackgroundImage(),
+    // e.g. one coming from a BackgroundImageSource.
+    void setPreparedBackgroundImage(const QImage &image, const QSize &textureSize = QSize());
+    // Replaces all models and the scene by objectModel alone.
+    void setObjectModel(const ObjectModelRenerable &objectModel);
+    // Adds a model to the registry without putting it into the scene.
+    int addObjectModel(const ObjectModelRenerable &objectModel);
+    // Same for a model from a ModelLoader sharing with our context. Its
+    // upload buffers and CPU arrays are released, returns -1 on a vertex
+    // format mismatch.
+    int addLoadedModel(LoadedModel &model);
+    // Replaces all models and the scene by the ones of source, drawn from
+    // its buffers. Our context has to share with the one of source, see
+    // ModelRegistry::shareModels().
+    bool shareModels(const SceneRenderer &source);
+    void setSceneObjects(const QVector<SceneObject> &objects);
+    const QVector<SceneObject> &sceneObjects() const { return m_objects; }
+    // Drawn after the scene objects, every group with one draw call
+    // and per instance matrices and colors in an instance buffer.
+    void setInstanceGroups(const QVector<InstanceGroup> &groups);
+    // With a budget > 0 models written from the CPU are uploaded in
+    // chunks of about that many bytes per rendered frame, and drawn with
+    // the triangles uploaded so far. Keep rendering frames while
+    // hasPendingUploads(). Off by default.
+    void setProgressiveUpload(int bytesPerFrame) { m_uploadBudget = bytesPerFrame; }
+    bool hasPendingUploads() const { return m_modelRegistry.pendingUploadCount() > 0; }
+    // Adds models, background textures and the instance buffer.
+    void reportMemory(MemoryReport *report) const;
+    // Layout models are uploaded in. Changing it drops all models.
+    void setVertexFormat(VertexFormat format);
+    void render(const QSize &imageSize);
+
+    void setClearColor(const QColor &color) { m_clearColor = color; }
+    // Model to camera transform (R|t) in OpenCV convention, as in BOP.
+    // Applies to all scene objects on top of their own modelMatrix.
+    void setPose(const QMatrix4x4 &pose);
+    void setIntrinsics(const CameraIntrinsics &intrinsics);
+    // Draws upside down, so rows read back with glReadPixels are top-down.
+    void setFlipVertical(bool flip);
+    // Draws only tile, in pixels of the image size given to render(),
+    // into a viewport of the size of the tile. Objects are projected
+    // through the sub-frustum of the tile, so tiles fit together pixel by
+    // pixel. The background is stretched over the tile, set the matching
+    // part of it. A null rect draws the whole image again.
+    void setTile(const QRect &tile);
+
+    // Attachments written when multiple targets are enabled.
+    enum OutputTarget {
+        ColorTarget,
+        // Distance along the optical axis, in model units (mm in BOP).
+        DepthTarget,
+        // 1 + index of the scene object, instance groups count on after
+        // the objects. One float channel each.
+        MaskTarget,
+        // Camera space normals in OpenCV convention.
+        NormalTarget,
+        TargetCount
+    };
+    // One geometry pass fills all OutputTargets. The bound framebuffer
+    // needs TargetCount color attachments, float ones for all but color,
+    // and the auxiliary targets are zero where no object is.
+    void setMultipleTargets(bool enabled);
+    // Models loaded with levels of detail are drawn with the coarsest
+    // level that still has trianglesPerPixel triangles per pixel of their
+    // projected bounding sphere. On by default.
+    void setLodEnabled(bool enabled);
+    void setLodTrianglesPerPixel(float trianglesPerPixel);
+
+    // Brings an image into the layout the background texture is uploaded
+    // from. Does not need a context, so it can run on decoding threads.
+    static QImage prepareBackgroundImage(const QImage &image);
+    static QMatrix4x4 viewMatrix(const QMatrix4x4 &pose);
+    static QMatrix4x4 projectionMatrix(const CameraIntrinsics &intrinsics, const QSize &imageSize);
+    // Maps the part of clip space covered by tile onto the whole of it.
+    static QMatrix4x4 tileMatrix(const QRect &tile, const QSize &imageSize);
+
+private:
+    enum ObjectProgramFeature {
+        PackedVerticesFeature = 0x1,
+        InstancedFeature = 0x2,
+        MultipleTargetsFeature = 0x4
+    };
+
+    // Uniform locations are looked up once, when the program is linked.
+    struct ObjectProgram
+    {
+        QOpenGLShaderProgram *program = nullptr;
+        int projectionMatrixLoc = -1;
+        int normalMatrixLoc = -1;
+        int meshOffsetLoc = -1;
+        int meshScaleLoc = -1;
+        int objectIdLoc = -1;
+        int depthRangeLoc = -1;
+    };
+
+    struct InstanceRange
+    {
+        int modelId;
+        int firstInstance;
+        int instanceCount;
+        // Some instance color is translucent.
+        bool blended;
+    };
+
+    void initializeBackgroundProgram();
+    void setupBackgroundVertexBuffers();
+    void makeBackgroundObject();
+    void initializeObjectProgram();
+    const ObjectProgram &objectProgram(int features);
+    void buildRenderQueue(const QMatrix4x4 &projection);
+    // matrices is a PoseBatch entry.
+    int selectLevel(int modelId, const GLfloat *matrices) const;
+    void drawRenderQueue();
+    void setInstanceAttributesEnabled(bool enabled);
+
+    QColor m_clearColor = Qt::black;
+    bool m_flipVertical = false;
+    QRect m_tile;
+    bool m_multipleTargets = false;
+    int m_uploadBudget = 0;
+    bool m_lodEnabled = true;
+    float m_lodTrianglesPerPixel = 1.0f;
+    GpuStageTimer m_backgroundTimer;
+    GpuStageTimer m_objectTimer;
+
+    // Background stuff
+    BackgroundTextureRing m_backgroundTextures;
+    QOpenGLShaderProgram *m_backgroundProgram = nullptr;
+    int m_backgroundMatrixLoc = -1;
+    int m_backgroundTexCoordScaleLoc = -1;
+    QOpenGLVertexArrayObject m_backgroundVao;
+    QOpenGLBuffer m_backgroundVbo;
+    QVector<GLfloat> m_backgroundVertexData;
+    QMatrix4x4 m_orthoMatrix;
+
+    // Object stuff
+    ModelRegistry m_modelRegistry;
+    QVector<SceneObject> m_objects;
+    QVector<InstanceRange> m_instanceGroups;
+    // Column-major model matrix of every instance.
+    QVector<GLfloat> m_instanceModels;
+    // What gets uploaded, see InstanceStride.
+    QVector<GLfloat> m_instanceData;
+    // PoseBatch entries of m_objects.
+    QVector<GLfloat> m_objectMatrices;
+    bool m_instanceDataDirty = false;
+    QOpenGLBuffer m_instanceBuffer;
+    QHash<int, ObjectProgram> m_objectPrograms;
+    RenderQueue m_renderQueue;
+    bool m_renderQueueDirty = true;
+    QSize m_renderQueueSize;
+    QMatrix4x4 m_pose;
+    CameraIntrinsics m_intrinsics;
+};
+
+#endif // SCENERENDERER_H
@@ -1,12 +1,8 @@
 HEADERS       = glwidget.h \
-                window.h \
-    objectmodelrenderable.h
+                window.h
 SOURCES       = glwidget.cpp \
                 main.cpp \
-                window.cpp \
-    objectmodelrenderable.cpp
+                window.cpp
 QT           += widgets
 
-LIBS += -L/usr/local/lib -lassimp
-
-INCLUDEPATH += /usr/local/include/assimp
+include(renderer.pri)
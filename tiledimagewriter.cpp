@@ -0,0 +1,112 @@
+/****************************************************************************
+**
+** Copyright (C) 2016 The Qt Company Ltd.
+** Contact: https://www.qt.io/licensing/
+**
+** This file is part of the examples of the Qt Toolkit.
+**
+** $QT_BEGIN_LICENSE:BSD$
+** Commercial License Usage
+** Licensees holding valid commercial Qt licenses may use this file in
+** accordance with the commercial license agreement provided with the
+** Software or, alternatively, in accordance with the terms contained in
+** a written agreement between you and The Qt Company. For licensing terms
+** and conditions see https://www.qt.io/terms-conditions. For further
+** information use the contact form at https://www.qt.io/contact-us.
+**
+** BSD License Usage
+** Alternatively, you may use this file under the terms of the BSD license
+** as follows:
+**
+** "Redistribution and use in source and binary forms, with or without
+** modification, are permitted provided that the following conditions are
+** met:
+**   * Redistributions of source code must retain the above copyright
+**     notice, this list of conditions and the following disclaimer.
+**   * Redistributions in binary form must reproduce the above copyright
+**     notice, this list of conditions and the following disclaimer in
+**     the documentation and/or other materials provided with the
+**     distribution.
+**   * Neither the name of The Qt Company Ltd nor the names of its
+**     contributors may be used to endorse or promote products derived
+**     from this software without specific prior written permission.
+**
+**
+** THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+** "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+** LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+** A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+** OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+** SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+** LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+** DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+** THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+** (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+** OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE."
+**
+** $QT_END_LICENSE$
+**
+****************************************************************************/
+
+#include "tiledimagewriter.h"
+#include "profiler.h"
+
+#include <QDebug>
+
+bool TiledImageWriter::open(const QString &fileName, const QSize &size)
+{
+    m_file.setFileName(fileName);
+    if (!m_file.open(QIODevice::WriteOnly)) {
+        qWarning() << "TiledImageWriter: could not open" << fileName;
+        return false;
+    }
+    m_size = size;
+    m_bandTop = 0;
+    m_bandHeight = 0;
+    m_bandWidth = 0;
+    const QByteArray header = QByteArray("P6\n") + QByteArray::number(size.width()) + ' '
+            + QByteArray::number(size.height()) + "\n255\n";
+    return m_file.write(header) == header.size();
+}
+
+bool TiledImageWriter::addTile(const QRect &tile, const QImage &image)
+{
+    if (m_bandWidth == 0) {
+        m_bandHeight = tile.height();
+        m_band.resize(m_size.width() * m_bandHeight * 3);
+    }
+    if (tile.y() != m_bandTop || tile.x() != m_bandWidth || tile.height() != m_bandHeight
+            || tile.right() >= m_size.width() || image.size() != tile.size()) {
+        qWarning() << "TiledImageWriter: tile" << tile << "does not follow the previous one";
+        return false;
+    }
+
+    ProfileScope profile("ppm write");
+    const QImage rgb = image.convertToFormat(QImage::Format_RGB888);
+    for (int row = 0; row < tile.height(); ++row) {
+        memcpy(m_band.data() + (row * m_size.width() + tile.x()) * 3,
+               rgb.constScanLine(row), tile.width() * 3);
+    }
+    m_bandWidth += tile.width();
+    return m_bandWidth < m_size.width() || flushBand();
+}
+
+bool TiledImageWriter::flushBand()
+{
+    const bool written = m_file.write(m_band) == m_band.size();
+    m_bandTop += m_bandHeight;
+    m_bandWidth = 0;
+    if (!written)
+        qWarning() << "TiledImageWriter: could not write to" << m_file.fileName();
+    return written;
+}
+
+bool TiledImageWriter::close()
+{
+    const bool complete = m_bandTop == m_size.height() && m_bandWidth == 0;
+    if (!complete)
+        qWarning() << "TiledImageWriter:" << m_file.fileName() << "is missing rows";
+    m_band = QByteArray();
+    m_file.close();
+    return complete && m_file.error() == QFileDevice::NoError;
+}